@@ -25,10 +25,25 @@ public class PanoramaCapture : ModuleRules
             {
                 "ApplicationCore",
                 "Json",
-                "JsonUtilities",
-                "ImageWrapper"
+                "JsonUtilities"
             });
 
+        // The PNG sequence writer drives deflate directly to compress row bands in parallel.
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+        // EXR sequence output writes through OpenEXR, which the engine ships for desktop platforms only.
+        bool bWithOpenEXR = Target.Platform.IsInGroup(UnrealPlatformGroup.Windows)
+            || Target.Platform == UnrealTargetPlatform.Mac
+            || Target.Platform.IsInGroup(UnrealPlatformGroup.Unix);
+        if (bWithOpenEXR)
+        {
+            AddEngineThirdPartyPrivateStaticDependencies(Target, "Imath", "UEOpenExr");
+
+            // OpenEXR reports errors by throwing.
+            bEnableExceptions = true;
+        }
+        PrivateDefinitions.Add("PANORAMA_WITH_OPENEXR=" + (bWithOpenEXR ? "1" : "0"));
+
         if (Target.Platform == UnrealTargetPlatform.Win64)
         {
             string ThirdPartyDir = Path.Combine(ModuleDirectory, "..", "..", "ThirdParty", "Win64");
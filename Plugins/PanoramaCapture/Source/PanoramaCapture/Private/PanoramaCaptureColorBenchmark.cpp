@@ -0,0 +1,411 @@
+#include "PanoramaCaptureColorBenchmark.h"
+#include "PanoramaCaptureColorConversion.h"
+#include "PanoramaCaptureColorKernels.h"
+#include "PanoramaCaptureLog.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Misc/AutomationTest.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+namespace
+{
+    struct FBenchmarkCase
+    {
+        const TCHAR* Name;
+        FIntPoint EyeResolution;
+        bool bStereo;
+    };
+
+    const FBenchmarkCase GBenchmarkCases[] = {
+        { TEXT("2K"), FIntPoint(2048, 1024), false },
+        { TEXT("4K"), FIntPoint(4096, 2048), false },
+        { TEXT("8K"), FIntPoint(7680, 3840), false },
+        { TEXT("8KStereo"), FIntPoint(7680, 3840), true }
+    };
+
+    struct FBenchmarkFrame
+    {
+        FIntPoint EyeResolution;
+        bool bStereo = false;
+        TArray<FFloat16Color> Eyes[2];
+    };
+
+    /** Output buffers of one converter run; whichever the converter filled is checksummed. */
+    struct FConvertedFrame
+    {
+        TArray<uint8> Bytes;
+        TArray<uint16> Words[2];
+
+        int64 GetAllocatedSize() const
+        {
+            return Bytes.GetAllocatedSize() + Words[0].GetAllocatedSize() + Words[1].GetAllocatedSize();
+        }
+
+        uint32 GetChecksum() const
+        {
+            uint32 Crc = FCrc::MemCrc32(Bytes.GetData(), Bytes.Num());
+            for (const TArray<uint16>& EyeWords : Words)
+            {
+                Crc = FCrc::MemCrc32(EyeWords.GetData(), EyeWords.Num() * sizeof(uint16), Crc);
+            }
+            return Crc;
+        }
+    };
+
+    using FConverterFunction = bool (*)(const FBenchmarkFrame&, const FConversionParallelism&, FConvertedFrame&);
+
+    struct FConverter
+    {
+        const TCHAR* Name;
+        FConverterFunction Run;
+    };
+
+    bool ConvertPayload(const FBenchmarkFrame& Frame, EPanoramaColorFormat ColorFormat, EPanoramaGamma GammaMode, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+    {
+        if (Frame.bStereo)
+        {
+            return ConvertStereoLinearToPayload(Frame.Eyes[0], Frame.Eyes[1], Frame.EyeResolution, EPanoramaStereoLayout::TopBottom, ColorFormat, GammaMode, EPanoramaYUVMatrix::Auto, Output.Bytes, Parallelism);
+        }
+        if (ColorFormat == EPanoramaColorFormat::BGRA8)
+        {
+            return ConvertLinearToBGRAPayload(Frame.Eyes[0], Frame.EyeResolution, GammaMode, Output.Bytes, Parallelism);
+        }
+        return ConvertLinearToPackedPlanar(Frame.Eyes[0], Frame.EyeResolution, ColorFormat, GammaMode, EPanoramaYUVMatrix::Auto, Output.Bytes, Parallelism);
+    }
+
+    const FConverter GConverters[] = {
+        { TEXT("NV12"), [](const FBenchmarkFrame& Frame, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+            {
+                return ConvertPayload(Frame, EPanoramaColorFormat::NV12, EPanoramaGamma::SRGB, Parallelism, Output);
+            } },
+        { TEXT("P010"), [](const FBenchmarkFrame& Frame, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+            {
+                return ConvertPayload(Frame, EPanoramaColorFormat::P010, EPanoramaGamma::SRGB, Parallelism, Output);
+            } },
+        { TEXT("P010-PQ"), [](const FBenchmarkFrame& Frame, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+            {
+                return ConvertPayload(Frame, EPanoramaColorFormat::P010, EPanoramaGamma::PQ, Parallelism, Output);
+            } },
+        { TEXT("BGRA8"), [](const FBenchmarkFrame& Frame, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+            {
+                return ConvertPayload(Frame, EPanoramaColorFormat::BGRA8, EPanoramaGamma::SRGB, Parallelism, Output);
+            } },
+        { TEXT("PNG16"), [](const FBenchmarkFrame& Frame, const FConversionParallelism& Parallelism, FConvertedFrame& Output)
+            {
+                const int32 NumEyes = Frame.bStereo ? 2 : 1;
+                for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+                {
+                    if (!ConvertLinearToRGBA16(Frame.Eyes[EyeIndex], Frame.EyeResolution, Output.Words[EyeIndex], Parallelism))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            } }
+    };
+
+    /** Deterministic frame: a hue sweep across, an exposure ramp from 1/16 to 16 down the rows, and per-pixel grain. */
+    void GenerateFrame(const FIntPoint& Resolution, int32 Seed, TArray<FFloat16Color>& OutPixels)
+    {
+        OutPixels.SetNumUninitialized(Resolution.X * Resolution.Y);
+        FFloat16Color* Pixels = OutPixels.GetData();
+        ParallelFor(Resolution.Y, [Pixels, Resolution, Seed](int32 Y)
+        {
+            FRandomStream Random(Seed * 65599 + Y);
+            const float Exposure = FMath::Pow(2.0f, 8.0f * static_cast<float>(Y) / Resolution.Y - 4.0f);
+            for (int32 X = 0; X < Resolution.X; ++X)
+            {
+                const float Hue = 360.0f * static_cast<float>(X) / Resolution.X;
+                const FLinearColor Base = FLinearColor(Hue, 0.8f, 1.0f).HSVToLinearRGB();
+                const float Grain = Exposure * (0.9f + 0.2f * Random.GetFraction());
+                Pixels[Y * Resolution.X + X] = FFloat16Color(FLinearColor(Base.R * Grain, Base.G * Grain, Base.B * Grain, 1.0f));
+            }
+        });
+    }
+
+    FString MakeResultKey(const FString& Case, const FString& Converter)
+    {
+        return Case + TEXT("/") + Converter;
+    }
+
+    bool LoadBaseline(const FString& Path, FString& OutInstructionSet, TMap<FString, TSharedPtr<FJsonObject>>& OutEntries)
+    {
+        FString Text;
+        if (!FFileHelper::LoadFileToString(Text, *Path))
+        {
+            return false;
+        }
+
+        TSharedPtr<FJsonObject> Root;
+        const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Text);
+        if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid())
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Color benchmark baseline %s is not valid JSON"), *Path);
+            return false;
+        }
+
+        OutInstructionSet = Root->GetStringField(TEXT("InstructionSet"));
+        const TArray<TSharedPtr<FJsonValue>>* Results = nullptr;
+        if (Root->TryGetArrayField(TEXT("Results"), Results))
+        {
+            for (const TSharedPtr<FJsonValue>& Value : *Results)
+            {
+                const TSharedPtr<FJsonObject> Entry = Value->AsObject();
+                if (Entry.IsValid())
+                {
+                    OutEntries.Add(MakeResultKey(Entry->GetStringField(TEXT("Case")), Entry->GetStringField(TEXT("Converter"))), Entry);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool SaveBaseline(const FString& Path, const TArray<FBenchmarkResult>& Results)
+    {
+        const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+        Root->SetStringField(TEXT("InstructionSet"), Kernels::LexToString(Kernels::GetActiveInstructionSet()));
+
+        TArray<TSharedPtr<FJsonValue>> Entries;
+        for (const FBenchmarkResult& Result : Results)
+        {
+            const TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+            Entry->SetStringField(TEXT("Case"), Result.Case);
+            Entry->SetStringField(TEXT("Converter"), Result.Converter);
+            Entry->SetNumberField(TEXT("MegapixelsPerSecond"), Result.MegapixelsPerSecond);
+            Entry->SetNumberField(TEXT("OutputBytes"), static_cast<double>(Result.OutputBytes));
+            Entry->SetNumberField(TEXT("Checksum"), static_cast<double>(Result.Checksum));
+            Entries.Add(MakeShared<FJsonValueObject>(Entry));
+        }
+        Root->SetArrayField(TEXT("Results"), Entries);
+
+        FString Text;
+        const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Text);
+        return FJsonSerializer::Serialize(Root, Writer) && FFileHelper::SaveStringToFile(Text, *Path);
+    }
+
+    void HandleBenchmarkCommand(const TArray<FString>& Args)
+    {
+        FBenchmarkOptions Options;
+        Options.BaselinePath = GetDefaultBenchmarkBaselinePath();
+        for (const FString& Arg : Args)
+        {
+            FString Key;
+            FString Value;
+            if (!Arg.Split(TEXT("="), &Key, &Value))
+            {
+                Key = Arg;
+            }
+
+            if (Key == TEXT("Iterations"))
+            {
+                Options.Iterations = FMath::Max(1, FCString::Atoi(*Value));
+            }
+            else if (Key == TEXT("Cases"))
+            {
+                Value.ParseIntoArray(Options.Cases, TEXT(","));
+            }
+            else if (Key == TEXT("Baseline"))
+            {
+                Options.BaselinePath = Value;
+            }
+            else if (Key == TEXT("SaveBaseline"))
+            {
+                Options.bSaveBaseline = true;
+            }
+            else if (Key == TEXT("Tolerance"))
+            {
+                Options.Tolerance = FMath::Max(0.0, FCString::Atod(*Value));
+            }
+            else if (Key == TEXT("Serial"))
+            {
+                Options.bParallel = false;
+            }
+            else
+            {
+                UE_LOG(LogPanoramaCapture, Warning, TEXT("Unknown color benchmark argument '%s'"), *Arg);
+            }
+        }
+
+        TArray<FBenchmarkResult> Results;
+        TArray<FString> Errors;
+        RunColorConversionBenchmark(Options, Results, Errors);
+        for (const FString& Error : Errors)
+        {
+            UE_LOG(LogPanoramaCapture, Error, TEXT("  %s"), *Error);
+        }
+        UE_LOG(LogPanoramaCapture, Display, TEXT("Color conversion benchmark %s"), Errors.Num() == 0 ? TEXT("PASSED") : TEXT("FAILED"));
+    }
+
+    FAutoConsoleCommand GBenchmarkColorConversionCommand(
+        TEXT("Panorama.BenchmarkColorConversion"),
+        TEXT("Benchmarks the CPU color converters on synthetic frames. Args: Iterations=N Cases=2K,4K,8K,8KStereo Baseline=Path SaveBaseline Tolerance=0.1 Serial"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(&HandleBenchmarkCommand));
+}
+
+FString GetDefaultBenchmarkBaselinePath()
+{
+    return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PanoramaCapture"), TEXT("ColorConversionBaseline.json"));
+}
+
+bool RunColorConversionBenchmark(const FBenchmarkOptions& Options, TArray<FBenchmarkResult>& OutResults, TArray<FString>& OutErrors)
+{
+    OutResults.Reset();
+    OutErrors.Reset();
+
+    FConversionParallelism Parallelism;
+    Parallelism.bEnabled = Options.bParallel;
+
+    const FString InstructionSet = Kernels::LexToString(Kernels::GetActiveInstructionSet());
+    FString BaselineInstructionSet;
+    TMap<FString, TSharedPtr<FJsonObject>> Baseline;
+    const bool bHasBaseline = !Options.bSaveBaseline && LoadBaseline(Options.BaselinePath, BaselineInstructionSet, Baseline);
+    const bool bCompareThroughput = bHasBaseline && BaselineInstructionSet == InstructionSet;
+    if (bHasBaseline && !bCompareThroughput)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Color benchmark baseline was recorded with %s kernels, running %s; comparing output only"), *BaselineInstructionSet, *InstructionSet);
+    }
+
+    UE_LOG(LogPanoramaCapture, Display, TEXT("Color conversion benchmark: %s kernels, %d iterations, %s"), *InstructionSet, Options.Iterations, Options.bParallel ? TEXT("parallel") : TEXT("serial"));
+
+    for (const FBenchmarkCase& Case : GBenchmarkCases)
+    {
+        if (Options.Cases.Num() > 0 && !Options.Cases.Contains(Case.Name))
+        {
+            continue;
+        }
+
+        FBenchmarkFrame Frame;
+        Frame.EyeResolution = Case.EyeResolution;
+        Frame.bStereo = Case.bStereo;
+        const int32 NumEyes = Case.bStereo ? 2 : 1;
+        for (int32 EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+        {
+            GenerateFrame(Case.EyeResolution, EyeIndex + 1, Frame.Eyes[EyeIndex]);
+        }
+        const double Megapixels = static_cast<double>(Case.EyeResolution.X) * Case.EyeResolution.Y * NumEyes / 1.0e6;
+
+        for (const FConverter& Converter : GConverters)
+        {
+            FBenchmarkResult& Result = OutResults.AddDefaulted_GetRef();
+            Result.Case = Case.Name;
+            Result.Converter = Converter.Name;
+
+            // Reference output from the scalar kernels, then the timed runs on whatever dispatch selects. The scalar
+            // kernels are requested for this conversion only, so a capture converting meanwhile keeps its own.
+            FConvertedFrame Reference;
+            FConversionParallelism ReferenceParallelism = Parallelism;
+            ReferenceParallelism.InstructionSet = Kernels::EInstructionSet::Scalar;
+            const bool bReferenceConverted = Converter.Run(Frame, ReferenceParallelism, Reference);
+            Result.ReferenceChecksum = Reference.GetChecksum();
+
+            FConvertedFrame Output;
+            double BestSeconds = TNumericLimits<double>::Max();
+            bool bConverted = bReferenceConverted;
+            for (int32 Iteration = 0; Iteration < Options.Iterations && bConverted; ++Iteration)
+            {
+                const double StartSeconds = FPlatformTime::Seconds();
+                bConverted = Converter.Run(Frame, Parallelism, Output);
+                BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartSeconds);
+            }
+
+            if (!bConverted)
+            {
+                OutErrors.Add(FString::Printf(TEXT("%s/%s: conversion failed"), Case.Name, Converter.Name));
+                continue;
+            }
+
+            Result.BestMilliseconds = BestSeconds * 1000.0;
+            Result.MegapixelsPerSecond = BestSeconds > 0.0 ? Megapixels / BestSeconds : 0.0;
+            Result.OutputBytes = Output.GetAllocatedSize();
+            Result.Checksum = Output.GetChecksum();
+
+            UE_LOG(LogPanoramaCapture, Display, TEXT("  %-8s %-8s %9.1f MPix/s %8.2f ms %11lld bytes crc %08x"),
+                Case.Name, Converter.Name, Result.MegapixelsPerSecond, Result.BestMilliseconds, Result.OutputBytes, Result.Checksum);
+
+            if (Result.Checksum != Result.ReferenceChecksum)
+            {
+                OutErrors.Add(FString::Printf(TEXT("%s/%s: %s output %08x differs from scalar reference %08x"), Case.Name, Converter.Name, *InstructionSet, Result.Checksum, Result.ReferenceChecksum));
+            }
+
+            const TSharedPtr<FJsonObject>* Entry = Baseline.Find(MakeResultKey(Result.Case, Result.Converter));
+            if (!Entry)
+            {
+                continue;
+            }
+
+            const uint32 BaselineChecksum = static_cast<uint32>((*Entry)->GetNumberField(TEXT("Checksum")));
+            if (Result.Checksum != BaselineChecksum)
+            {
+                OutErrors.Add(FString::Printf(TEXT("%s/%s: output %08x differs from baseline %08x"), Case.Name, Converter.Name, Result.Checksum, BaselineChecksum));
+            }
+
+            const double BaselineRate = (*Entry)->GetNumberField(TEXT("MegapixelsPerSecond"));
+            if (bCompareThroughput && Result.MegapixelsPerSecond < BaselineRate * (1.0 - Options.Tolerance))
+            {
+                OutErrors.Add(FString::Printf(TEXT("%s/%s: %.1f MPix/s is below baseline %.1f MPix/s"), Case.Name, Converter.Name, Result.MegapixelsPerSecond, BaselineRate));
+            }
+        }
+    }
+
+    if (Options.bSaveBaseline)
+    {
+        if (SaveBaseline(Options.BaselinePath, OutResults))
+        {
+            UE_LOG(LogPanoramaCapture, Display, TEXT("Color benchmark baseline written to %s"), *Options.BaselinePath);
+        }
+        else
+        {
+            OutErrors.Add(FString::Printf(TEXT("Failed to write color benchmark baseline %s"), *Options.BaselinePath));
+        }
+    }
+
+    return OutErrors.Num() == 0;
+}
+}
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPanoramaColorConversionBenchmarkTest, "Plugins.PanoramaCapture.ColorConversionBenchmark",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Fails when the active kernels disagree with the scalar reference or, against the default baseline, when output changed
+ * or throughput regressed. Record the baseline first with Panorama.BenchmarkColorConversion SaveBaseline.
+ */
+bool FPanoramaColorConversionBenchmarkTest::RunTest(const FString& Parameters)
+{
+    PanoramaCapture::Color::FBenchmarkOptions Options;
+    Options.BaselinePath = PanoramaCapture::Color::GetDefaultBenchmarkBaselinePath();
+    if (!FPaths::FileExists(Options.BaselinePath))
+    {
+        AddWarning(FString::Printf(TEXT("No color benchmark baseline at %s - checking output against the scalar kernels only"), *Options.BaselinePath));
+    }
+
+    TArray<PanoramaCapture::Color::FBenchmarkResult> Results;
+    TArray<FString> Errors;
+    PanoramaCapture::Color::RunColorConversionBenchmark(Options, Results, Errors);
+    for (const FString& Error : Errors)
+    {
+        AddError(Error);
+    }
+    return Errors.Num() == 0;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+    /**
+     * Options for the color conversion benchmark. Run it from the console with
+     * Panorama.BenchmarkColorConversion [Iterations=N] [Cases=2K,4K,8K,8KStereo] [Baseline=Path] [SaveBaseline] [Tolerance=0.1] [Serial]
+     * or as the Plugins.PanoramaCapture.ColorConversionBenchmark automation test, which fails on any regression.
+     */
+    struct FBenchmarkOptions
+    {
+        /** Timed runs per converter; the fastest one is reported. */
+        int32 Iterations = 5;
+
+        /** Case names to run (2K, 4K, 8K, 8KStereo). Empty runs all of them. */
+        TArray<FString> Cases;
+
+        /** JSON baseline compared against, and written when bSaveBaseline is set. */
+        FString BaselinePath;
+
+        /** Write this run's results to BaselinePath instead of comparing against it. */
+        bool bSaveBaseline = false;
+
+        /** Allowed throughput drop relative to the baseline before the run fails (0.1 = 10%). */
+        double Tolerance = 0.1;
+
+        /** Convert with row-strip parallelism, as captures do by default. */
+        bool bParallel = true;
+    };
+
+    /** Result of one converter on one synthetic frame. */
+    struct FBenchmarkResult
+    {
+        FString Case;
+        FString Converter;
+        double MegapixelsPerSecond = 0.0;
+        double BestMilliseconds = 0.0;
+
+        /** Capacity of the output buffers the converter sized; not a count of every allocation made during the run. */
+        int64 OutputBytes = 0;
+
+        /** CRC32 of the output with the active kernels and with the scalar kernels. */
+        uint32 Checksum = 0;
+        uint32 ReferenceChecksum = 0;
+    };
+
+    /** Default location of the JSON baseline under the project's Saved directory. */
+    FString GetDefaultBenchmarkBaselinePath();
+
+    /**
+     * Converts synthetic half-float frames through every converter (NV12, P010, BGRA8 and the PNG RGBA16 quantizer)
+     * and logs throughput, output size and checksums. Returns false, with a message per failure in OutErrors, when the
+     * active kernels disagree with the scalar reference or, with a baseline present, when output changed or throughput
+     * fell by more than the tolerance.
+     */
+    bool RunColorConversionBenchmark(const FBenchmarkOptions& Options, TArray<FBenchmarkResult>& OutResults, TArray<FString>& OutErrors);
+}
+}
+
+#endif // !UE_BUILD_SHIPPING
@@ -1,5 +1,8 @@
 #include "PanoramaCaptureColorConversion.h"
+#include "PanoramaCaptureColorKernels.h"
+#include "PanoramaCaptureTransferLUT.h"
 #include "Math/Float16Color.h"
+#include "Async/ParallelFor.h"
 
 namespace PanoramaCapture
 {
@@ -7,137 +10,205 @@ namespace Color
 {
 namespace
 {
-    FORCEINLINE uint8 ClampToByte(float Value)
+    /**
+     * Runs Body(StartRow, EndRow) over even-aligned row strips, in parallel when enabled. A requested instruction set is
+     * pinned on whichever thread runs a strip, and only for that strip.
+     */
+    void ForEachRowStrip(int32 Height, const FConversionParallelism& Parallelism, TFunctionRef<void(int32, int32)> Body)
     {
-        return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Value), 0, 255));
+        const int32 StripRows = FMath::Max(2, Parallelism.StripRows + (Parallelism.StripRows & 1));
+        const int32 NumStrips = FMath::DivideAndRoundUp(Height, StripRows);
+        const Kernels::EInstructionSet InstructionSet = Parallelism.InstructionSet.Get(Kernels::GetActiveInstructionSet());
+        if (!Parallelism.bEnabled || NumStrips <= 1)
+        {
+            Kernels::FScopedInstructionSetOverride InstructionSetScope(InstructionSet);
+            Body(0, Height);
+            return;
+        }
+
+        // Each task walks every NumTasks-th strip, which caps concurrency without a custom scheduler.
+        const int32 NumTasks = Parallelism.MaxThreads > 0 ? FMath::Min(NumStrips, Parallelism.MaxThreads) : NumStrips;
+        ParallelFor(NumTasks, [&Body, StripRows, NumStrips, NumTasks, Height, InstructionSet](int32 TaskIndex)
+        {
+            Kernels::FScopedInstructionSetOverride InstructionSetScope(InstructionSet);
+            for (int32 Strip = TaskIndex; Strip < NumStrips; Strip += NumTasks)
+            {
+                const int32 StartRow = Strip * StripRows;
+                Body(StartRow, FMath::Min(StartRow + StripRows, Height));
+            }
+        });
     }
 
-    FORCEINLINE uint16 ClampToTenBit(float Value)
+    bool IsValidDestination(const FPlanarDestination& Destination, const FIntPoint& Resolution, int32 BytesPerSample)
     {
-        return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Value), 0, 1023));
+        const int64 RowBytes = static_cast<int64>(Resolution.X) * BytesPerSample;
+        if (!Destination.Data || Destination.YOffset < 0 || Destination.UVOffset < 0 || Destination.YPitch < RowBytes || Destination.UVPitch < RowBytes)
+        {
+            return false;
+        }
+
+        // Sample pointers are formed from these, so wide samples need aligned offsets and pitches.
+        if ((Destination.YOffset | Destination.UVOffset | Destination.YPitch | Destination.UVPitch) % BytesPerSample != 0)
+        {
+            return false;
+        }
+
+        const int64 YEnd = Destination.YOffset + static_cast<int64>(Destination.YPitch) * (Resolution.Y - 1) + RowBytes;
+        const int64 UVEnd = Destination.UVOffset + static_cast<int64>(Destination.UVPitch) * (Resolution.Y / 2 - 1) + RowBytes;
+        return YEnd <= Destination.NumBytes && UVEnd <= Destination.NumBytes;
     }
 
-    void ExtractGammaAdjustedRGB(const FFloat16Color& Pixel, EPanoramaGamma GammaMode, float& OutR, float& OutG, float& OutB, float& OutA)
-    {
-        const FLinearColor LinearColor(Pixel.R.GetFloat(), Pixel.G.GetFloat(), Pixel.B.GetFloat(), Pixel.A.GetFloat());
-        OutA = FMath::Clamp(LinearColor.A, 0.0f, 1.0f);
+    template <typename SampleType>
+    using TRowPairFunction = void (*)(const FFloat16Color*, const FFloat16Color*, int32, EPanoramaGamma, EPanoramaYUVMatrix, SampleType*, SampleType*, SampleType*);
 
-        if (GammaMode == EPanoramaGamma::SRGB)
+    template <typename SampleType>
+    bool ConvertLinearToPlanar(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, const FPlanarDestination& Destination, const FConversionParallelism& Parallelism, TRowPairFunction<SampleType> ConvertRowPair)
+    {
+        const int32 Width = Resolution.X;
+        const int32 Height = Resolution.Y;
+        if (Width <= 0 || Height <= 0 || (Width % 2) != 0 || (Height % 2) != 0)
         {
-            const FColor SRGBColor = LinearColor.GetClamped().ToFColorSRGB();
-            OutR = static_cast<float>(SRGBColor.R) / 255.0f;
-            OutG = static_cast<float>(SRGBColor.G) / 255.0f;
-            OutB = static_cast<float>(SRGBColor.B) / 255.0f;
+            return false;
         }
-        else
+
+        if (SourcePixels.Num() != Width * Height || !IsValidDestination(Destination, Resolution, sizeof(SampleType)))
         {
-            OutR = FMath::Clamp(LinearColor.R, 0.0f, 1.0f);
-            OutG = FMath::Clamp(LinearColor.G, 0.0f, 1.0f);
-            OutB = FMath::Clamp(LinearColor.B, 0.0f, 1.0f);
+            return false;
         }
+
+        const EPanoramaYUVMatrix ResolvedMatrix = ResolveYUVMatrix(Matrix, GammaMode);
+        const FFloat16Color* SourcePtr = SourcePixels.GetData();
+        ForEachRowStrip(Height, Parallelism, [&Destination, SourcePtr, Width, GammaMode, ResolvedMatrix, ConvertRowPair](int32 StartRow, int32 EndRow)
+        {
+            for (int32 Y = StartRow; Y < EndRow; Y += 2)
+            {
+                const FFloat16Color* SourceRow = SourcePtr + Y * Width;
+                uint8* YRow = Destination.Data + Destination.YOffset + static_cast<int64>(Y) * Destination.YPitch;
+                uint8* UVRow = Destination.Data + Destination.UVOffset + static_cast<int64>(Y / 2) * Destination.UVPitch;
+                ConvertRowPair(SourceRow, SourceRow + Width, Width, GammaMode, ResolvedMatrix,
+                    reinterpret_cast<SampleType*>(YRow), reinterpret_cast<SampleType*>(YRow + Destination.YPitch), reinterpret_cast<SampleType*>(UVRow));
+            }
+        });
+
+        return true;
     }
 }
 
-bool ConvertLinearToNV12Planes(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, FNV12PlaneBuffers& OutPlanes)
+FConversionParallelism FConversionParallelism::FromSettings(const FPanoramicVideoSettings& Settings)
 {
-    const int32 Width = Resolution.X;
-    const int32 Height = Resolution.Y;
-    if (Width <= 0 || Height <= 0 || (Width % 2) != 0 || (Height % 2) != 0)
-    {
-        return false;
-    }
+    FConversionParallelism Parallelism;
+    Parallelism.bEnabled = Settings.bParallelColorConversion;
+    Parallelism.StripRows = Settings.ColorConversionStripRows;
+    Parallelism.MaxThreads = Settings.MaxColorConversionThreads;
+    return Parallelism;
+}
 
-    const int32 ExpectedPixelCount = Width * Height;
-    if (SourcePixels.Num() != ExpectedPixelCount)
+FPlanarDestination FPlanarDestination::Packed(uint8* Data, int64 NumBytes, const FIntPoint& Resolution, int32 BytesPerSample)
+{
+    FPlanarDestination Destination;
+    Destination.Data = Data;
+    Destination.NumBytes = NumBytes;
+    Destination.YOffset = 0;
+    Destination.UVOffset = static_cast<int64>(Resolution.X) * Resolution.Y * BytesPerSample;
+    Destination.YPitch = Resolution.X * BytesPerSample;
+    Destination.UVPitch = Resolution.X * BytesPerSample;
+    return Destination;
+}
+
+EPanoramaYUVMatrix ResolveYUVMatrix(EPanoramaYUVMatrix Matrix, EPanoramaGamma GammaMode)
+{
+    if (GammaMode == EPanoramaGamma::PQ)
     {
-        return false;
+        return EPanoramaYUVMatrix::BT2020;
     }
+    return (Matrix == EPanoramaYUVMatrix::Auto) ? EPanoramaYUVMatrix::BT709 : Matrix;
+}
 
-    OutPlanes.Resolution = Resolution;
-    OutPlanes.YPlane.SetNumUninitialized(ExpectedPixelCount);
-    OutPlanes.UVPlane.SetNumUninitialized((Width * Height) / 2);
+int64 GetPlanarPayloadBytes(const FIntPoint& Resolution, int32 BytesPerSample)
+{
+    const int64 PixelCount = static_cast<int64>(Resolution.X) * Resolution.Y;
+    return (PixelCount + PixelCount / 2) * BytesPerSample;
+}
 
-    const int32 BlockWidth = Width / 2;
-    const int32 BlockHeight = Height / 2;
+bool ConvertLinearToNV12(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, const FPlanarDestination& Destination, const FConversionParallelism& Parallelism)
+{
+    return ConvertLinearToPlanar<uint8>(SourcePixels, Resolution, GammaMode, Matrix, Destination, Parallelism, &Kernels::ConvertRowPairNV12);
+}
+
+bool ConvertLinearToP010(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, const FPlanarDestination& Destination, const FConversionParallelism& Parallelism)
+{
+    return ConvertLinearToPlanar<uint16>(SourcePixels, Resolution, GammaMode, Matrix, Destination, Parallelism, &Kernels::ConvertRowPairP010);
+}
 
-    TArray<float> UAccumulator;
-    TArray<float> VAccumulator;
-    TArray<int32> SampleCounts;
-    UAccumulator.SetNumZeroed(BlockWidth * BlockHeight);
-    VAccumulator.SetNumZeroed(BlockWidth * BlockHeight);
-    SampleCounts.SetNumZeroed(BlockWidth * BlockHeight);
+bool ConvertLinearToPackedPlanar(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaColorFormat ColorFormat, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, TArray<uint8>& OutData, const FConversionParallelism& Parallelism)
+{
+    if (ColorFormat != EPanoramaColorFormat::NV12 && ColorFormat != EPanoramaColorFormat::P010)
+    {
+        return false;
+    }
 
-    uint8* YPlanePtr = OutPlanes.YPlane.GetData();
+    const int32 BytesPerSample = (ColorFormat == EPanoramaColorFormat::P010) ? sizeof(uint16) : sizeof(uint8);
+    OutData.SetNumUninitialized(static_cast<int32>(GetPlanarPayloadBytes(Resolution, BytesPerSample)));
+    const FPlanarDestination Destination = FPlanarDestination::Packed(OutData.GetData(), OutData.Num(), Resolution, BytesPerSample);
 
-    for (int32 Y = 0; Y < Height; ++Y)
+    const bool bConverted = (ColorFormat == EPanoramaColorFormat::P010)
+        ? ConvertLinearToP010(SourcePixels, Resolution, GammaMode, Matrix, Destination, Parallelism)
+        : ConvertLinearToNV12(SourcePixels, Resolution, GammaMode, Matrix, Destination, Parallelism);
+    if (!bConverted)
     {
-        for (int32 X = 0; X < Width; ++X)
-        {
-            const int32 PixelIndex = Y * Width + X;
-            const FFloat16Color& Pixel = SourcePixels[PixelIndex];
-
-            float R;
-            float G;
-            float B;
-            float A;
-            ExtractGammaAdjustedRGB(Pixel, GammaMode, R, G, B, A);
-            UE_UNUSED(A);
-
-            const float YLinear = 0.2126f * R + 0.7152f * G + 0.0722f * B;
-            const float ULinear = -0.1146f * R - 0.3854f * G + 0.5000f * B;
-            const float VLinear = 0.5000f * R - 0.4542f * G - 0.0458f * B;
-
-            const float YByte = 16.0f + 219.0f * YLinear;
-            const float UByte = 128.0f + 224.0f * ULinear;
-            const float VByte = 128.0f + 224.0f * VLinear;
-
-            YPlanePtr[PixelIndex] = ClampToByte(YByte);
-
-            const int32 BlockX = X / 2;
-            const int32 BlockY = Y / 2;
-            const int32 BlockIndex = BlockY * BlockWidth + BlockX;
-            UAccumulator[BlockIndex] += ClampToByte(UByte);
-            VAccumulator[BlockIndex] += ClampToByte(VByte);
-            SampleCounts[BlockIndex] += 1;
-        }
+        OutData.Reset();
     }
+    return bConverted;
+}
 
-    uint8* UVPlanePtr = OutPlanes.UVPlane.GetData();
-    for (int32 BlockY = 0; BlockY < BlockHeight; ++BlockY)
+FPlanarDestination FPlanarDestination::StereoEye(uint8* Data, int64 NumBytes, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, int32 EyeIndex, int32 BytesPerSample)
+{
+    const FIntPoint CombinedResolution = GetStereoResolution(EyeResolution, Layout);
+    FPlanarDestination Destination = Packed(Data, NumBytes, CombinedResolution, BytesPerSample);
+    if (EyeIndex > 0)
     {
-        uint8* RowPtr = UVPlanePtr + (BlockY * Width);
-        for (int32 BlockX = 0; BlockX < BlockWidth; ++BlockX)
+        if (Layout == EPanoramaStereoLayout::SideBySide)
         {
-            const int32 BlockIndex = BlockY * BlockWidth + BlockX;
-            const int32 SampleCount = FMath::Max(1, SampleCounts[BlockIndex]);
-            const float UAverage = UAccumulator[BlockIndex] / static_cast<float>(SampleCount);
-            const float VAverage = VAccumulator[BlockIndex] / static_cast<float>(SampleCount);
-            RowPtr[BlockX * 2] = ClampToByte(UAverage);
-            RowPtr[BlockX * 2 + 1] = ClampToByte(VAverage);
+            // Right eye starts half way along every row of both planes.
+            Destination.YOffset += static_cast<int64>(EyeResolution.X) * BytesPerSample;
+            Destination.UVOffset += static_cast<int64>(EyeResolution.X) * BytesPerSample;
+        }
+        else
+        {
+            // Right eye starts after the left eye's rows in both planes.
+            Destination.YOffset += static_cast<int64>(Destination.YPitch) * EyeResolution.Y;
+            Destination.UVOffset += static_cast<int64>(Destination.UVPitch) * (EyeResolution.Y / 2);
         }
     }
-
-    return true;
+    return Destination;
 }
 
-void CollapsePlanesToNV12(const FNV12PlaneBuffers& Planes, TArray<uint8>& OutData)
+FInterleavedDestination FInterleavedDestination::StereoEye(uint8* Data, int64 NumBytes, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, int32 EyeIndex, int32 BytesPerPixel)
 {
-    OutData.SetNumUninitialized(Planes.YPlane.Num() + Planes.UVPlane.Num());
-    if (Planes.YPlane.Num() > 0)
-    {
-        FMemory::Memcpy(OutData.GetData(), Planes.YPlane.GetData(), Planes.YPlane.Num());
-    }
-    if (Planes.UVPlane.Num() > 0)
+    const FIntPoint CombinedResolution = GetStereoResolution(EyeResolution, Layout);
+    FInterleavedDestination Destination;
+    Destination.Data = Data;
+    Destination.NumBytes = NumBytes;
+    Destination.Pitch = CombinedResolution.X * BytesPerPixel;
+    if (EyeIndex > 0)
     {
-        FMemory::Memcpy(OutData.GetData() + Planes.YPlane.Num(), Planes.UVPlane.GetData(), Planes.UVPlane.Num());
+        Destination.Offset = (Layout == EPanoramaStereoLayout::SideBySide)
+            ? static_cast<int64>(EyeResolution.X) * BytesPerPixel
+            : static_cast<int64>(Destination.Pitch) * EyeResolution.Y;
     }
+    return Destination;
 }
 
-bool ConvertLinearToP010Planes(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, FP010PlaneBuffers& OutPlanes)
+FIntPoint GetStereoResolution(const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout)
+{
+    return (Layout == EPanoramaStereoLayout::SideBySide) ? FIntPoint(EyeResolution.X * 2, EyeResolution.Y) : FIntPoint(EyeResolution.X, EyeResolution.Y * 2);
+}
+
+bool ConvertLinearToBGRA(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, const FInterleavedDestination& Destination, const FConversionParallelism& Parallelism)
 {
     const int32 Width = Resolution.X;
     const int32 Height = Resolution.Y;
-    if (Width <= 0 || Height <= 0 || (Width % 2) != 0 || (Height % 2) != 0)
+    if (Width <= 0 || Height <= 0)
     {
         return false;
     }
@@ -148,124 +219,165 @@ bool ConvertLinearToP010Planes(const TArray<FFloat16Color>& SourcePixels, const
         return false;
     }
 
-    OutPlanes.Resolution = Resolution;
-    OutPlanes.YPlane.SetNumUninitialized(ExpectedPixelCount);
-    OutPlanes.UVPlane.SetNumUninitialized((Width * Height) / 2);
-
-    const int32 BlockWidth = Width / 2;
-    const int32 BlockHeight = Height / 2;
-
-    TArray<float> UAccumulator;
-    TArray<float> VAccumulator;
-    TArray<int32> SampleCounts;
-    UAccumulator.SetNumZeroed(BlockWidth * BlockHeight);
-    VAccumulator.SetNumZeroed(BlockWidth * BlockHeight);
-    SampleCounts.SetNumZeroed(BlockWidth * BlockHeight);
-
-    uint16* YPlanePtr = OutPlanes.YPlane.GetData();
-
-    for (int32 Y = 0; Y < Height; ++Y)
+    const int64 RowBytes = static_cast<int64>(Width) * 4;
+    if (!Destination.Data || Destination.Offset < 0 || Destination.Pitch < RowBytes
+        || Destination.Offset + static_cast<int64>(Destination.Pitch) * (Height - 1) + RowBytes > Destination.NumBytes)
     {
-        for (int32 X = 0; X < Width; ++X)
-        {
-            const int32 PixelIndex = Y * Width + X;
-            const FFloat16Color& Pixel = SourcePixels[PixelIndex];
-
-            float R;
-            float G;
-            float B;
-            float A;
-            ExtractGammaAdjustedRGB(Pixel, GammaMode, R, G, B, A);
-            UE_UNUSED(A);
-
-            const float YLinear = 0.2126f * R + 0.7152f * G + 0.0722f * B;
-            const float ULinear = -0.1146f * R - 0.3854f * G + 0.5000f * B;
-            const float VLinear = 0.5000f * R - 0.4542f * G - 0.0458f * B;
-
-            const float YTenBit = 64.0f + 876.0f * YLinear;
-            const float UTenBit = 512.0f + 896.0f * ULinear;
-            const float VTenBit = 512.0f + 896.0f * VLinear;
-
-            YPlanePtr[PixelIndex] = ClampToTenBit(YTenBit);
-
-            const int32 BlockX = X / 2;
-            const int32 BlockY = Y / 2;
-            const int32 BlockIndex = BlockY * BlockWidth + BlockX;
-            UAccumulator[BlockIndex] += ClampToTenBit(UTenBit);
-            VAccumulator[BlockIndex] += ClampToTenBit(VTenBit);
-            SampleCounts[BlockIndex] += 1;
-        }
+        return false;
     }
 
-    uint16* UVPlanePtr = OutPlanes.UVPlane.GetData();
-    for (int32 BlockY = 0; BlockY < BlockHeight; ++BlockY)
+    // Alpha is never gamma encoded.
+    const uint8* ColorCodes = (GammaMode == EPanoramaGamma::SRGB) ? TransferLUT::GetSRGB8() : TransferLUT::GetLinear8();
+    const uint8* AlphaCodes = TransferLUT::GetLinear8();
+
+    const FFloat16Color* SourcePtr = SourcePixels.GetData();
+    ForEachRowStrip(Height, Parallelism, [&Destination, SourcePtr, Width, ColorCodes, AlphaCodes](int32 StartRow, int32 EndRow)
     {
-        uint16* RowPtr = UVPlanePtr + (BlockY * Width);
-        for (int32 BlockX = 0; BlockX < BlockWidth; ++BlockX)
+        for (int32 Y = StartRow; Y < EndRow; ++Y)
         {
-            const int32 BlockIndex = BlockY * BlockWidth + BlockX;
-            const int32 SampleCount = FMath::Max(1, SampleCounts[BlockIndex]);
-            const float UAverage = UAccumulator[BlockIndex] / static_cast<float>(SampleCount);
-            const float VAverage = VAccumulator[BlockIndex] / static_cast<float>(SampleCount);
-            RowPtr[BlockX * 2] = ClampToTenBit(UAverage);
-            RowPtr[BlockX * 2 + 1] = ClampToTenBit(VAverage);
+            const FFloat16Color* SourceRow = SourcePtr + Y * Width;
+            uint8* DestRow = Destination.Data + Destination.Offset + static_cast<int64>(Y) * Destination.Pitch;
+            for (int32 X = 0; X < Width; ++X)
+            {
+                const FFloat16Color& Pixel = SourceRow[X];
+                DestRow[X * 4 + 0] = ColorCodes[Pixel.B.Encoded];
+                DestRow[X * 4 + 1] = ColorCodes[Pixel.G.Encoded];
+                DestRow[X * 4 + 2] = ColorCodes[Pixel.R.Encoded];
+                DestRow[X * 4 + 3] = AlphaCodes[Pixel.A.Encoded];
+            }
         }
-    }
+    });
 
     return true;
 }
 
-void CollapsePlanesToP010(const FP010PlaneBuffers& Planes, TArray<uint8>& OutData)
+bool ConvertLinearToBGRAPayload(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, TArray<uint8>& OutData, const FConversionParallelism& Parallelism)
 {
-    const int32 YBytes = Planes.YPlane.Num() * sizeof(uint16);
-    const int32 UVBytes = Planes.UVPlane.Num() * sizeof(uint16);
-    OutData.SetNumUninitialized(YBytes + UVBytes);
-    if (YBytes > 0)
+    if (Resolution.X <= 0 || Resolution.Y <= 0)
     {
-        FMemory::Memcpy(OutData.GetData(), Planes.YPlane.GetData(), YBytes);
+        return false;
     }
-    if (UVBytes > 0)
+
+    OutData.SetNumUninitialized(Resolution.X * Resolution.Y * 4);
+
+    FInterleavedDestination Destination;
+    Destination.Data = OutData.GetData();
+    Destination.NumBytes = OutData.Num();
+    Destination.Pitch = Resolution.X * 4;
+    if (!ConvertLinearToBGRA(SourcePixels, Resolution, GammaMode, Destination, Parallelism))
     {
-        FMemory::Memcpy(OutData.GetData() + YBytes, Planes.UVPlane.GetData(), UVBytes);
+        OutData.Reset();
+        return false;
     }
+    return true;
 }
 
-bool ConvertLinearToBGRAPayload(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, TArray<uint8>& OutData)
+bool ConvertLinearToRGBA16(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, const FInterleavedDestination& Destination, const FConversionParallelism& Parallelism)
 {
     const int32 Width = Resolution.X;
     const int32 Height = Resolution.Y;
-    if (Width <= 0 || Height <= 0)
+    if (Width <= 0 || Height <= 0 || SourcePixels.Num() != Width * Height)
     {
         return false;
     }
 
-    const int32 ExpectedPixelCount = Width * Height;
-    if (SourcePixels.Num() != ExpectedPixelCount)
+    const int64 RowBytes = static_cast<int64>(Width) * 4 * sizeof(uint16);
+    if (!Destination.Data || Destination.Offset < 0 || Destination.Pitch < RowBytes
+        || !IsAligned(Destination.Data + Destination.Offset, alignof(uint16)) || Destination.Pitch % sizeof(uint16) != 0
+        || Destination.Offset + static_cast<int64>(Destination.Pitch) * (Height - 1) + RowBytes > Destination.NumBytes)
     {
         return false;
     }
 
-    OutData.SetNumUninitialized(ExpectedPixelCount * 4);
+    // Every channel, alpha included, goes through the same linear table.
+    const uint16* Codes = TransferLUT::GetLinear16();
+    const FFloat16Color* SourcePtr = SourcePixels.GetData();
+    ForEachRowStrip(Height, Parallelism, [&Destination, SourcePtr, Width, Codes](int32 StartRow, int32 EndRow)
+    {
+        for (int32 Y = StartRow; Y < EndRow; ++Y)
+        {
+            const FFloat16Color* SourceRow = SourcePtr + Y * Width;
+            uint16* DestRow = reinterpret_cast<uint16*>(Destination.Data + Destination.Offset + static_cast<int64>(Y) * Destination.Pitch);
+            for (int32 X = 0; X < Width; ++X)
+            {
+                const FFloat16Color& Pixel = SourceRow[X];
+                uint16* Dest = DestRow + X * 4;
+                Dest[0] = Codes[Pixel.R.Encoded];
+                Dest[1] = Codes[Pixel.G.Encoded];
+                Dest[2] = Codes[Pixel.B.Encoded];
+                Dest[3] = Codes[Pixel.A.Encoded];
+            }
+        }
+    });
 
-    uint8* DestPtr = OutData.GetData();
-    for (int32 Index = 0; Index < ExpectedPixelCount; ++Index)
+    return true;
+}
+
+bool ConvertLinearToRGBA16(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, TArray<uint16>& OutData, const FConversionParallelism& Parallelism)
+{
+    if (Resolution.X <= 0 || Resolution.Y <= 0)
     {
-        const FFloat16Color& Pixel = SourcePixels[Index];
-        float R;
-        float G;
-        float B;
-        float A;
-        ExtractGammaAdjustedRGB(Pixel, GammaMode, R, G, B, A);
-
-        DestPtr[Index * 4 + 0] = ClampToByte(B * 255.0f);
-        DestPtr[Index * 4 + 1] = ClampToByte(G * 255.0f);
-        DestPtr[Index * 4 + 2] = ClampToByte(R * 255.0f);
-        DestPtr[Index * 4 + 3] = ClampToByte(A * 255.0f);
+        return false;
     }
 
+    OutData.SetNumUninitialized(Resolution.X * Resolution.Y * 4);
+
+    FInterleavedDestination Destination;
+    Destination.Data = reinterpret_cast<uint8*>(OutData.GetData());
+    Destination.NumBytes = static_cast<int64>(OutData.Num()) * sizeof(uint16);
+    Destination.Pitch = Resolution.X * 4 * sizeof(uint16);
+    if (!ConvertLinearToRGBA16(SourcePixels, Resolution, Destination, Parallelism))
+    {
+        OutData.Reset();
+        return false;
+    }
     return true;
 }
 
-}
+bool ConvertStereoLinearToPayload(const TArray<FFloat16Color>& LeftPixels, const TArray<FFloat16Color>& RightPixels, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, EPanoramaColorFormat ColorFormat, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, TArray<uint8>& OutData, const FConversionParallelism& Parallelism)
+{
+    const FIntPoint CombinedResolution = GetStereoResolution(EyeResolution, Layout);
+    const TArray<FFloat16Color>* EyePixels[2] = { &LeftPixels, &RightPixels };
+
+    bool bConverted = true;
+    switch (ColorFormat)
+    {
+    case EPanoramaColorFormat::NV12:
+    case EPanoramaColorFormat::P010:
+    {
+        const bool bTenBit = ColorFormat == EPanoramaColorFormat::P010;
+        const int32 BytesPerSample = bTenBit ? sizeof(uint16) : sizeof(uint8);
+        OutData.SetNumUninitialized(static_cast<int32>(GetPlanarPayloadBytes(CombinedResolution, BytesPerSample)));
+        for (int32 EyeIndex = 0; EyeIndex < 2 && bConverted; ++EyeIndex)
+        {
+            const FPlanarDestination Destination = FPlanarDestination::StereoEye(OutData.GetData(), OutData.Num(), EyeResolution, Layout, EyeIndex, BytesPerSample);
+            bConverted = bTenBit
+                ? ConvertLinearToP010(*EyePixels[EyeIndex], EyeResolution, GammaMode, Matrix, Destination, Parallelism)
+                : ConvertLinearToNV12(*EyePixels[EyeIndex], EyeResolution, GammaMode, Matrix, Destination, Parallelism);
+        }
+        break;
+    }
+    case EPanoramaColorFormat::BGRA8:
+    {
+        OutData.SetNumUninitialized(CombinedResolution.X * CombinedResolution.Y * 4);
+        for (int32 EyeIndex = 0; EyeIndex < 2 && bConverted; ++EyeIndex)
+        {
+            const FInterleavedDestination Destination = FInterleavedDestination::StereoEye(OutData.GetData(), OutData.Num(), EyeResolution, Layout, EyeIndex, 4);
+            bConverted = ConvertLinearToBGRA(*EyePixels[EyeIndex], EyeResolution, GammaMode, Destination, Parallelism);
+        }
+        break;
+    }
+    default:
+        bConverted = false;
+        break;
+    }
+
+    if (!bConverted)
+    {
+        OutData.Reset();
+    }
+    return bConverted;
 }
 
+}
+}
@@ -2,40 +2,97 @@
 
 #include "CoreMinimal.h"
 #include "PanoramaCaptureTypes.h"
+#include "PanoramaCaptureColorKernels.h"
 #include "Math/Float16Color.h"
 
 namespace PanoramaCapture
 {
 namespace Color
 {
-    struct FNV12PlaneBuffers
+    /** Controls how a frame conversion is split across task graph workers. */
+    struct FConversionParallelism
     {
-        FIntPoint Resolution = FIntPoint::ZeroValue;
-        TArray<uint8> YPlane;
-        TArray<uint8> UVPlane;
+        /** When false the whole frame is converted on the calling thread. */
+        bool bEnabled = false;
+
+        /** Rows per strip. Rounded up to an even count so a chroma row pair never spans two strips. */
+        int32 StripRows = 64;
+
+        /** Maximum number of strips converted at once. Zero lets ParallelFor use every worker. */
+        int32 MaxThreads = 0;
+
+        /** Kernels every strip runs with, e.g. Scalar for reference output. Unset uses the detected instruction set. */
+        TOptional<Kernels::EInstructionSet> InstructionSet;
+
+        static FConversionParallelism FromSettings(const FPanoramicVideoSettings& Settings);
     };
 
-    struct FP010PlaneBuffers
+    /**
+     * Caller-owned destination for a Y plane plus an interleaved UV plane. Offsets and pitches are in bytes relative
+     * to Data, so the planes can live inside a larger surface such as a packed stereo payload or an encoder input buffer.
+     */
+    struct FPlanarDestination
     {
-        FIntPoint Resolution = FIntPoint::ZeroValue;
-        TArray<uint16> YPlane;
-        TArray<uint16> UVPlane;
+        uint8* Data = nullptr;
+        int64 NumBytes = 0;
+        int64 YOffset = 0;
+        int64 UVOffset = 0;
+        int32 YPitch = 0;
+        int32 UVPitch = 0;
+
+        /** Tightly packed Y plane followed by the UV plane, the layout the raw NVENC/ffmpeg path expects. */
+        static FPlanarDestination Packed(uint8* Data, int64 NumBytes, const FIntPoint& Resolution, int32 BytesPerSample);
+
+        /** Region of one eye (0 = left, 1 = right) inside a packed stereo payload of the given layout. */
+        static FPlanarDestination StereoEye(uint8* Data, int64 NumBytes, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, int32 EyeIndex, int32 BytesPerSample);
     };
 
-    /** Converts linear HDR pixels to NV12 planes with optional gamma processing. */
-    bool ConvertLinearToNV12Planes(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, FNV12PlaneBuffers& OutPlanes);
+    /** Caller-owned destination for a single interleaved plane (BGRA8 or RGBA16). Offset and pitch are in bytes. */
+    struct FInterleavedDestination
+    {
+        uint8* Data = nullptr;
+        int64 NumBytes = 0;
+        int64 Offset = 0;
+        int32 Pitch = 0;
+
+        /** Region of one eye (0 = left, 1 = right) inside a packed stereo image of the given layout. */
+        static FInterleavedDestination StereoEye(uint8* Data, int64 NumBytes, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, int32 EyeIndex, int32 BytesPerPixel);
+    };
 
-    /** Flattens NV12 planes into a contiguous Y + UV byte payload. */
-    void CollapsePlanesToNV12(const FNV12PlaneBuffers& Planes, TArray<uint8>& OutData);
+    /** Size of the combined image that holds both eyes in the given layout. */
+    FIntPoint GetStereoResolution(const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout);
 
-    /** Converts linear HDR pixels to P010 planes with optional gamma processing. */
-    bool ConvertLinearToP010Planes(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, FP010PlaneBuffers& OutPlanes);
+    /** Maps Auto to the matrix implied by the transfer: BT.2020 for PQ, BT.709 otherwise. PQ always uses BT.2020. */
+    EPanoramaYUVMatrix ResolveYUVMatrix(EPanoramaYUVMatrix Matrix, EPanoramaGamma GammaMode);
 
-    /** Flattens P010 planes into a contiguous Y + UV payload (16-bit per sample). */
-    void CollapsePlanesToP010(const FP010PlaneBuffers& Planes, TArray<uint8>& OutData);
+    /** Size in bytes of a packed Y + UV payload. BytesPerSample is 1 for NV12 and 2 for P010. */
+    int64 GetPlanarPayloadBytes(const FIntPoint& Resolution, int32 BytesPerSample);
+
+    /** Converts linear HDR pixels to NV12 with the given matrix (Auto resolves from GammaMode), writing Y and UV straight into Destination. */
+    bool ConvertLinearToNV12(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, const FPlanarDestination& Destination, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /** Converts linear HDR pixels to P010 (10 significant bits at the top of each 16-bit sample), writing Y and UV straight into Destination. */
+    bool ConvertLinearToP010(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, const FPlanarDestination& Destination, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /** Sizes OutData as a packed NV12 or P010 payload and converts into it. Returns false for non-planar formats. */
+    bool ConvertLinearToPackedPlanar(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaColorFormat ColorFormat, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, TArray<uint8>& OutData, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /** Converts linear HDR pixels to BGRA8 rows written at Destination's offset and pitch. */
+    bool ConvertLinearToBGRA(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, const FInterleavedDestination& Destination, const FConversionParallelism& Parallelism = FConversionParallelism());
 
     /** Converts linear HDR pixels directly into a BGRA8 byte payload. */
-    bool ConvertLinearToBGRAPayload(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, TArray<uint8>& OutData);
+    bool ConvertLinearToBGRAPayload(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, EPanoramaGamma GammaMode, TArray<uint8>& OutData, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /** Quantizes linear pixels to clamped, truncated 16-bit RGBA, the PNG staging format, written at Destination's offset and pitch. */
+    bool ConvertLinearToRGBA16(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, const FInterleavedDestination& Destination, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /** Sizes OutData as a tightly packed RGBA16 image and quantizes into it. */
+    bool ConvertLinearToRGBA16(const TArray<FFloat16Color>& SourcePixels, const FIntPoint& Resolution, TArray<uint16>& OutData, const FConversionParallelism& Parallelism = FConversionParallelism());
+
+    /**
+     * Converts both eyes of a stereo pair into one top/bottom or side-by-side payload (NV12, P010 or BGRA8). Each eye is
+     * written straight into its region of OutData, so no per-eye intermediate is allocated or copied.
+     */
+    bool ConvertStereoLinearToPayload(const TArray<FFloat16Color>& LeftPixels, const TArray<FFloat16Color>& RightPixels, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, EPanoramaColorFormat ColorFormat, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, TArray<uint8>& OutData, const FConversionParallelism& Parallelism = FConversionParallelism());
 }
 }
-
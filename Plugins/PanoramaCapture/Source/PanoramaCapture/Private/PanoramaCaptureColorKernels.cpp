@@ -0,0 +1,848 @@
+#include "PanoramaCaptureColorKernels.h"
+#include "PanoramaCaptureTransferLUT.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+    #define PANORAMA_WITH_X86_KERNELS 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+    #include <immintrin.h>
+#else
+    #define PANORAMA_WITH_X86_KERNELS 0
+#endif
+
+#if PLATFORM_CPU_ARM_FAMILY && (defined(__aarch64__) || defined(_M_ARM64))
+    #define PANORAMA_WITH_NEON_KERNELS 1
+    #include <arm_neon.h>
+#else
+    #define PANORAMA_WITH_NEON_KERNELS 0
+#endif
+
+// MSVC allows any intrinsic in any function; clang and gcc need the target spelled out per function.
+#if defined(__clang__) || defined(__GNUC__)
+    #define PANORAMA_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define PANORAMA_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+    #define PANORAMA_TARGET_SSE41
+    #define PANORAMA_TARGET_AVX2
+#endif
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+namespace Kernels
+{
+namespace
+{
+    /** Fraction bits of the fixed-point matrix. Chroma is computed from 2x2 sums and shifts two bits further. */
+    constexpr int32 MatrixFractionBits = 14;
+    constexpr int32 ChromaFractionBits = MatrixFractionBits + 2;
+
+    /**
+     * Every row kernel works on 12-bit transfer-encoded RGB codes. With Q14 coefficients the largest 2x2 chroma sum
+     * (4 * 4095 * ~3600 plus the bias) stays well inside int32.
+     */
+    constexpr int32 RGBMaxCode = 4095;
+
+    struct FRangeScale
+    {
+        int32 YOffset;
+        int32 YScale;
+        int32 COffset;
+        int32 CScale;
+        int32 MaxCode;
+    };
+
+    constexpr FRangeScale NV12Range = { 16, 219, 128, 224, 255 };
+    constexpr FRangeScale P010Range = { 64, 876, 512, 896, 1023 };
+
+    /**
+     * Q14 RGB to YCbCr matrix with the studio-range scale and offset folded in. Each row sums exactly to the range
+     * scale (luma) or to zero (chroma), so white and grey land on their nominal codes.
+     */
+    struct FYUVCoefficients
+    {
+        int32 YR;
+        int32 YG;
+        int32 YB;
+        int32 UR;
+        int32 UG;
+        int32 UB;
+        int32 VR;
+        int32 VG;
+        int32 VB;
+
+        /** Offset plus rounding bias for a single luma sample. */
+        int32 YBias;
+
+        /** Offset plus rounding bias for the sum of a 2x2 chroma block. */
+        int32 CBias;
+
+        int32 MaxCode;
+    };
+
+    FYUVCoefficients MakeCoefficients(EPanoramaYUVMatrix Matrix, const FRangeScale& Range)
+    {
+        const double KR = (Matrix == EPanoramaYUVMatrix::BT2020) ? 0.2627 : 0.2126;
+        const double KB = (Matrix == EPanoramaYUVMatrix::BT2020) ? 0.0593 : 0.0722;
+
+        const double YScale = static_cast<double>(Range.YScale) / RGBMaxCode * (1 << MatrixFractionBits);
+        const double CScale = static_cast<double>(Range.CScale) / RGBMaxCode * (1 << MatrixFractionBits);
+
+        FYUVCoefficients Coefficients;
+        Coefficients.YR = FMath::RoundToInt(KR * YScale);
+        Coefficients.YB = FMath::RoundToInt(KB * YScale);
+        Coefficients.YG = FMath::RoundToInt(YScale) - Coefficients.YR - Coefficients.YB;
+
+        Coefficients.UR = FMath::RoundToInt(-KR / (2.0 * (1.0 - KB)) * CScale);
+        Coefficients.UB = FMath::RoundToInt(0.5 * CScale);
+        Coefficients.UG = -Coefficients.UR - Coefficients.UB;
+
+        Coefficients.VR = FMath::RoundToInt(0.5 * CScale);
+        Coefficients.VB = FMath::RoundToInt(-KB / (2.0 * (1.0 - KR)) * CScale);
+        Coefficients.VG = -Coefficients.VR - Coefficients.VB;
+
+        Coefficients.YBias = (Range.YOffset << MatrixFractionBits) + (1 << (MatrixFractionBits - 1));
+        Coefficients.CBias = (Range.COffset << ChromaFractionBits) + (1 << (ChromaFractionBits - 1));
+        Coefficients.MaxCode = Range.MaxCode;
+        return Coefficients;
+    }
+
+    const FYUVCoefficients& GetCoefficients(EPanoramaYUVMatrix Matrix, bool bTenBit)
+    {
+        static const FYUVCoefficients Table[2][2] = {
+            { MakeCoefficients(EPanoramaYUVMatrix::BT709, NV12Range), MakeCoefficients(EPanoramaYUVMatrix::BT709, P010Range) },
+            { MakeCoefficients(EPanoramaYUVMatrix::BT2020, NV12Range), MakeCoefficients(EPanoramaYUVMatrix::BT2020, P010Range) }
+        };
+        return Table[Matrix == EPanoramaYUVMatrix::BT2020 ? 1 : 0][bTenBit ? 1 : 0];
+    }
+
+    /** P010 keeps its 10 significant bits in the top of each 16-bit word. */
+    template <typename SampleType>
+    constexpr int32 SampleShift = sizeof(SampleType) == sizeof(uint16) ? 6 : 0;
+
+    /**
+     * 12-bit RGB codes for the requested transfer, indexed by the raw half bits. PQ input has already been moved to
+     * BT.2020 primaries and scaled to TransferLUT::PQInputNits by the equirect shader, so it takes the same lookup.
+     */
+    const uint16* GetTransferCodes(EPanoramaGamma GammaMode)
+    {
+        switch (GammaMode)
+        {
+        case EPanoramaGamma::SRGB:
+            return TransferLUT::GetSRGB12();
+        case EPanoramaGamma::PQ:
+            return TransferLUT::GetPQ12();
+        default:
+            return TransferLUT::GetLinear12();
+        }
+    }
+
+    /** Bit-exact software half to float conversion for CPUs without conversion instructions and for loop tails. */
+    FORCEINLINE float DecodeHalfPortable(uint16 Half)
+    {
+        const uint32 Sign = static_cast<uint32>(Half & 0x8000) << 16;
+        const uint32 Exponent = (Half >> 10) & 0x1F;
+        const uint32 Mantissa = Half & 0x3FF;
+
+        uint32 Bits;
+        if (Exponent == 0x1F)
+        {
+            Bits = Sign | 0x7F800000 | (Mantissa << 13);
+        }
+        else if (Exponent != 0)
+        {
+            Bits = Sign | ((Exponent + (127 - 15)) << 23) | (Mantissa << 13);
+        }
+        else
+        {
+            // Zero or denormal: Mantissa * 2^-24 is exact in single precision.
+            const float Magnitude = static_cast<float>(Mantissa) * (1.0f / 16777216.0f);
+            FMemory::Memcpy(&Bits, &Magnitude, sizeof(Bits));
+            Bits |= Sign;
+        }
+
+        float Value;
+        FMemory::Memcpy(&Value, &Bits, sizeof(Value));
+        return Value;
+    }
+
+    void DecodeHalfColorsPortable(const FFloat16Color* Source, int32 Count, float* OutRGBA)
+    {
+        for (int32 Index = 0; Index < Count; ++Index)
+        {
+            const FFloat16Color& Pixel = Source[Index];
+            OutRGBA[Index * 4 + 0] = DecodeHalfPortable(Pixel.R.Encoded);
+            OutRGBA[Index * 4 + 1] = DecodeHalfPortable(Pixel.G.Encoded);
+            OutRGBA[Index * 4 + 2] = DecodeHalfPortable(Pixel.B.Encoded);
+            OutRGBA[Index * 4 + 3] = DecodeHalfPortable(Pixel.A.Encoded);
+        }
+    }
+
+    template <typename SampleType>
+    FORCEINLINE SampleType ClampToCode(int32 Value, int32 MaxCode)
+    {
+        return static_cast<SampleType>(FMath::Clamp(Value, 0, MaxCode) << SampleShift<SampleType>);
+    }
+
+    /**
+     * Scalar reference for the fixed-point row-pair converter; the vector kernels must match it bit for bit. Also
+     * finishes the columns a vector loop leaves behind.
+     */
+    template <typename SampleType>
+    void ConvertRowPairScalar(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 StartX, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, SampleType* OutY0, SampleType* OutY1, SampleType* OutUV)
+    {
+        const FYUVCoefficients& C = Coefficients;
+        for (int32 X = StartX; X < Width; X += 2)
+        {
+            int32 USum = 0;
+            int32 VSum = 0;
+            for (int32 Sample = 0; Sample < 4; ++Sample)
+            {
+                const int32 Column = X + (Sample & 1);
+                const FFloat16Color& Pixel = (Sample < 2) ? SourceRow0[Column] : SourceRow1[Column];
+
+                const int32 R = Codes[Pixel.R.Encoded];
+                const int32 G = Codes[Pixel.G.Encoded];
+                const int32 B = Codes[Pixel.B.Encoded];
+
+                SampleType* YRow = (Sample < 2) ? OutY0 : OutY1;
+                YRow[Column] = ClampToCode<SampleType>((C.YR * R + C.YG * G + C.YB * B + C.YBias) >> MatrixFractionBits, C.MaxCode);
+
+                // The matrix is linear, so summing the unrounded chroma terms equals applying it to the 2x2 RGB sum.
+                USum += C.UR * R + C.UG * G + C.UB * B;
+                VSum += C.VR * R + C.VG * G + C.VB * B;
+            }
+
+            OutUV[X] = ClampToCode<SampleType>((USum + C.CBias) >> ChromaFractionBits, C.MaxCode);
+            OutUV[X + 1] = ClampToCode<SampleType>((VSum + C.CBias) >> ChromaFractionBits, C.MaxCode);
+        }
+    }
+
+#if PANORAMA_WITH_X86_KERNELS
+    struct FCpuFeatures
+    {
+        bool bSSE41 = false;
+        bool bAVX2 = false;
+        bool bF16C = false;
+    };
+
+    void QueryCpuId(int32 Leaf, int32 SubLeaf, uint32 (&OutRegisters)[4])
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int32 Registers[4];
+        __cpuidex(Registers, Leaf, SubLeaf);
+        for (int32 Index = 0; Index < 4; ++Index)
+        {
+            OutRegisters[Index] = static_cast<uint32>(Registers[Index]);
+        }
+#else
+        __cpuid_count(Leaf, SubLeaf, OutRegisters[0], OutRegisters[1], OutRegisters[2], OutRegisters[3]);
+#endif
+    }
+
+    uint64 ReadExtendedControlRegister()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return _xgetbv(0);
+#else
+        uint32 Low;
+        uint32 High;
+        __asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+        return (static_cast<uint64>(High) << 32) | Low;
+#endif
+    }
+
+    FCpuFeatures QueryCpuFeatures()
+    {
+        FCpuFeatures Features;
+
+        uint32 Registers[4] = {};
+        QueryCpuId(0, 0, Registers);
+        const uint32 MaxLeaf = Registers[0];
+        if (MaxLeaf < 1)
+        {
+            return Features;
+        }
+
+        QueryCpuId(1, 0, Registers);
+        const uint32 Ecx = Registers[2];
+        Features.bSSE41 = (Ecx & (1u << 19)) != 0;
+        const bool bOSXSave = (Ecx & (1u << 27)) != 0;
+        const bool bAVX = (Ecx & (1u << 28)) != 0;
+        const bool bF16C = (Ecx & (1u << 29)) != 0;
+
+        // The OS has to save the YMM state before any 256-bit instruction is safe.
+        const bool bYMMEnabled = bOSXSave && bAVX && (ReadExtendedControlRegister() & 0x6) == 0x6;
+        Features.bF16C = bYMMEnabled && bF16C;
+
+        if (MaxLeaf >= 7 && bYMMEnabled)
+        {
+            QueryCpuId(7, 0, Registers);
+            Features.bAVX2 = (Registers[1] & (1u << 5)) != 0;
+        }
+
+        return Features;
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // SSE4.1: four pixels per row per iteration, 32-bit integer lanes throughout.
+    // ---------------------------------------------------------------------------------------------
+
+    /** Integer half decode, since F16C is not guaranteed on CPUs that stop at SSE4.1. */
+    PANORAMA_TARGET_SSE41 FORCEINLINE __m128 DecodeHalfSSE41(__m128i HalfBits)
+    {
+        const __m128i ExponentMask = _mm_set1_epi32(0x7C00 << 13);
+        const __m128 DenormalMagic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+
+        __m128i Bits = _mm_slli_epi32(_mm_and_si128(HalfBits, _mm_set1_epi32(0x7FFF)), 13);
+        const __m128i Exponent = _mm_and_si128(Bits, ExponentMask);
+        Bits = _mm_add_epi32(Bits, _mm_set1_epi32((127 - 15) << 23));
+
+        const __m128i InfNaN = _mm_cmpeq_epi32(Exponent, ExponentMask);
+        Bits = _mm_add_epi32(Bits, _mm_and_si128(InfNaN, _mm_set1_epi32((128 - 16) << 23)));
+
+        const __m128i Denormal = _mm_cmpeq_epi32(Exponent, _mm_setzero_si128());
+        const __m128 Renormalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(Bits, _mm_set1_epi32(1 << 23))), DenormalMagic);
+        Bits = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(Bits), Renormalized, _mm_castsi128_ps(Denormal)));
+
+        const __m128i Sign = _mm_slli_epi32(_mm_and_si128(HalfBits, _mm_set1_epi32(0x8000)), 16);
+        return _mm_castsi128_ps(_mm_or_si128(Bits, Sign));
+    }
+
+    PANORAMA_TARGET_SSE41 void DecodeHalfColorsSSE41(const FFloat16Color* Source, int32 Count, float* OutRGBA)
+    {
+        int32 Index = 0;
+        for (; Index + 2 <= Count; Index += 2)
+        {
+            const __m128i Halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index));
+            _mm_storeu_ps(OutRGBA + Index * 4, DecodeHalfSSE41(_mm_cvtepu16_epi32(Halves)));
+            _mm_storeu_ps(OutRGBA + Index * 4 + 4, DecodeHalfSSE41(_mm_cvtepu16_epi32(_mm_srli_si128(Halves, 8))));
+        }
+        DecodeHalfColorsPortable(Source + Index, Count - Index, OutRGBA + Index * 4);
+    }
+
+    PANORAMA_TARGET_SSE41 FORCEINLINE __m128i LookupCodesSSE41(__m128i HalfBits, const uint16* Codes)
+    {
+        return _mm_setr_epi32(
+            Codes[_mm_extract_epi32(HalfBits, 0)],
+            Codes[_mm_extract_epi32(HalfBits, 1)],
+            Codes[_mm_extract_epi32(HalfBits, 2)],
+            Codes[_mm_extract_epi32(HalfBits, 3)]);
+    }
+
+    PANORAMA_TARGET_SSE41 FORCEINLINE void LoadRGBSSE41(const FFloat16Color* Source, const uint16* Codes, __m128i& OutR, __m128i& OutG, __m128i& OutB)
+    {
+        const __m128i Pixels01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source));
+        const __m128i Pixels23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + 2));
+
+        // r0 r2 g0 g2 b0 b2 a0 a2 / r1 r3 g1 g3 b1 b3 a1 a3 -> r0 r1 r2 r3 g0 g1 g2 g3 / b0 b1 b2 b3 a0 a1 a2 a3
+        const __m128i Low = _mm_unpacklo_epi16(Pixels01, Pixels23);
+        const __m128i High = _mm_unpackhi_epi16(Pixels01, Pixels23);
+        const __m128i RG = _mm_unpacklo_epi16(Low, High);
+        const __m128i BA = _mm_unpackhi_epi16(Low, High);
+
+        OutR = LookupCodesSSE41(_mm_cvtepu16_epi32(RG), Codes);
+        OutG = LookupCodesSSE41(_mm_cvtepu16_epi32(_mm_srli_si128(RG, 8)), Codes);
+        OutB = LookupCodesSSE41(_mm_cvtepu16_epi32(BA), Codes);
+    }
+
+    PANORAMA_TARGET_SSE41 FORCEINLINE __m128i DotSSE41(__m128i R, __m128i G, __m128i B, int32 CR, int32 CG, int32 CB)
+    {
+        return _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(R, _mm_set1_epi32(CR)), _mm_mullo_epi32(G, _mm_set1_epi32(CG))), _mm_mullo_epi32(B, _mm_set1_epi32(CB)));
+    }
+
+    PANORAMA_TARGET_SSE41 FORCEINLINE __m128i ClampCodeSSE41(__m128i Value, int32 MaxCode)
+    {
+        return _mm_min_epi32(_mm_max_epi32(Value, _mm_setzero_si128()), _mm_set1_epi32(MaxCode));
+    }
+
+    /** Final luma codes plus the unrounded per-pixel chroma terms. */
+    struct FPixelsSSE41
+    {
+        __m128i Y;
+        __m128i U;
+        __m128i V;
+    };
+
+    PANORAMA_TARGET_SSE41 FORCEINLINE FPixelsSSE41 ConvertPixelsSSE41(const FFloat16Color* Source, const uint16* Codes, const FYUVCoefficients& C)
+    {
+        __m128i R;
+        __m128i G;
+        __m128i B;
+        LoadRGBSSE41(Source, Codes, R, G, B);
+
+        FPixelsSSE41 Result;
+        Result.Y = ClampCodeSSE41(_mm_srai_epi32(_mm_add_epi32(DotSSE41(R, G, B, C.YR, C.YG, C.YB), _mm_set1_epi32(C.YBias)), MatrixFractionBits), C.MaxCode);
+        Result.U = DotSSE41(R, G, B, C.UR, C.UG, C.UB);
+        Result.V = DotSSE41(R, G, B, C.VR, C.VG, C.VB);
+        return Result;
+    }
+
+    /** Sums the 2x2 blocks of four columns and returns the chroma codes as interleaved U0 V0 U1 V1. */
+    PANORAMA_TARGET_SSE41 FORCEINLINE __m128i AverageChromaSSE41(const FPixelsSSE41& Row0, const FPixelsSSE41& Row1, const FYUVCoefficients& C)
+    {
+        const __m128i USum = _mm_add_epi32(Row0.U, Row1.U);
+        const __m128i VSum = _mm_add_epi32(Row0.V, Row1.V);
+        // u01 u23 v01 v23 -> u01 v01 u23 v23
+        const __m128i Pairs = _mm_shuffle_epi32(_mm_hadd_epi32(USum, VSum), _MM_SHUFFLE(3, 1, 2, 0));
+        return ClampCodeSSE41(_mm_srai_epi32(_mm_add_epi32(Pairs, _mm_set1_epi32(C.CBias)), ChromaFractionBits), C.MaxCode);
+    }
+
+    PANORAMA_TARGET_SSE41 void ConvertRowPairNV12SSE41(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint8* OutY0, uint8* OutY1, uint8* OutUV)
+    {
+        const int32 VectorWidth = Width & ~3;
+
+        for (int32 X = 0; X < VectorWidth; X += 4)
+        {
+            const FPixelsSSE41 Row0 = ConvertPixelsSSE41(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsSSE41 Row1 = ConvertPixelsSSE41(SourceRow1 + X, Codes, Coefficients);
+            const __m128i Chroma = AverageChromaSSE41(Row0, Row1, Coefficients);
+
+            // Y0 Y1 Chroma packed into one register, then stored as three 4-byte runs.
+            const __m128i Words = _mm_packus_epi32(Row0.Y, Row1.Y);
+            const __m128i Bytes = _mm_packus_epi16(Words, _mm_packus_epi32(Chroma, Chroma));
+            const int32 Y0Bytes = _mm_cvtsi128_si32(Bytes);
+            const int32 Y1Bytes = _mm_extract_epi32(Bytes, 1);
+            const int32 UVBytes = _mm_extract_epi32(Bytes, 2);
+            FMemory::Memcpy(OutY0 + X, &Y0Bytes, 4);
+            FMemory::Memcpy(OutY1 + X, &Y1Bytes, 4);
+            FMemory::Memcpy(OutUV + X, &UVBytes, 4);
+        }
+
+        ConvertRowPairScalar<uint8>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+
+    PANORAMA_TARGET_SSE41 void ConvertRowPairP010SSE41(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint16* OutY0, uint16* OutY1, uint16* OutUV)
+    {
+        const int32 VectorWidth = Width & ~3;
+
+        for (int32 X = 0; X < VectorWidth; X += 4)
+        {
+            const FPixelsSSE41 Row0 = ConvertPixelsSSE41(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsSSE41 Row1 = ConvertPixelsSSE41(SourceRow1 + X, Codes, Coefficients);
+            const __m128i Chroma = AverageChromaSSE41(Row0, Row1, Coefficients);
+
+            const __m128i Luma = _mm_slli_epi16(_mm_packus_epi32(Row0.Y, Row1.Y), SampleShift<uint16>);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutY0 + X), Luma);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutY1 + X), _mm_srli_si128(Luma, 8));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutUV + X), _mm_slli_epi16(_mm_packus_epi32(Chroma, Chroma), SampleShift<uint16>));
+        }
+
+        ConvertRowPairScalar<uint16>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // AVX2 + F16C: eight pixels per row per iteration with gathered transfer codes.
+    // ---------------------------------------------------------------------------------------------
+
+    /** F16C converts two whole pixels (eight halves) per instruction. */
+    PANORAMA_TARGET_AVX2 void DecodeHalfColorsF16C(const FFloat16Color* Source, int32 Count, float* OutRGBA)
+    {
+        int32 Index = 0;
+        for (; Index + 4 <= Count; Index += 4)
+        {
+            const __m128i Pixels01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index));
+            const __m128i Pixels23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index + 2));
+            _mm256_storeu_ps(OutRGBA + Index * 4, _mm256_cvtph_ps(Pixels01));
+            _mm256_storeu_ps(OutRGBA + Index * 4 + 8, _mm256_cvtph_ps(Pixels23));
+        }
+        DecodeHalfColorsPortable(Source + Index, Count - Index, OutRGBA + Index * 4);
+    }
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE __m256i LookupCodesAVX2(__m128i HalfBits, const uint16* Codes)
+    {
+        // 32-bit gathers at a 2-byte stride; the table padding keeps the last index in bounds.
+        const __m256i Indices = _mm256_cvtepu16_epi32(HalfBits);
+        return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(Codes), Indices, 2), _mm256_set1_epi32(0xFFFF));
+    }
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE void LoadRGBAVX2(const FFloat16Color* Source, const uint16* Codes, __m256i& OutR, __m256i& OutG, __m256i& OutB)
+    {
+        const __m128i Pixels01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source));
+        const __m128i Pixels23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + 2));
+        const __m128i Pixels45 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + 4));
+        const __m128i Pixels67 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + 6));
+
+        // Two rounds of 16-bit interleaving give r0..r3 g0..g3 / b0..b3 a0..a3 for each half of the block.
+        const __m128i RGLow = _mm_unpacklo_epi16(_mm_unpacklo_epi16(Pixels01, Pixels23), _mm_unpackhi_epi16(Pixels01, Pixels23));
+        const __m128i BALow = _mm_unpackhi_epi16(_mm_unpacklo_epi16(Pixels01, Pixels23), _mm_unpackhi_epi16(Pixels01, Pixels23));
+        const __m128i RGHigh = _mm_unpacklo_epi16(_mm_unpacklo_epi16(Pixels45, Pixels67), _mm_unpackhi_epi16(Pixels45, Pixels67));
+        const __m128i BAHigh = _mm_unpackhi_epi16(_mm_unpacklo_epi16(Pixels45, Pixels67), _mm_unpackhi_epi16(Pixels45, Pixels67));
+
+        OutR = LookupCodesAVX2(_mm_unpacklo_epi64(RGLow, RGHigh), Codes);
+        OutG = LookupCodesAVX2(_mm_unpackhi_epi64(RGLow, RGHigh), Codes);
+        OutB = LookupCodesAVX2(_mm_unpacklo_epi64(BALow, BAHigh), Codes);
+    }
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE __m256i DotAVX2(__m256i R, __m256i G, __m256i B, int32 CR, int32 CG, int32 CB)
+    {
+        return _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(R, _mm256_set1_epi32(CR)), _mm256_mullo_epi32(G, _mm256_set1_epi32(CG))), _mm256_mullo_epi32(B, _mm256_set1_epi32(CB)));
+    }
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE __m256i ClampCodeAVX2(__m256i Value, int32 MaxCode)
+    {
+        return _mm256_min_epi32(_mm256_max_epi32(Value, _mm256_setzero_si256()), _mm256_set1_epi32(MaxCode));
+    }
+
+    struct FPixelsAVX2
+    {
+        __m256i Y;
+        __m256i U;
+        __m256i V;
+    };
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE FPixelsAVX2 ConvertPixelsAVX2(const FFloat16Color* Source, const uint16* Codes, const FYUVCoefficients& C)
+    {
+        __m256i R;
+        __m256i G;
+        __m256i B;
+        LoadRGBAVX2(Source, Codes, R, G, B);
+
+        FPixelsAVX2 Result;
+        Result.Y = ClampCodeAVX2(_mm256_srai_epi32(_mm256_add_epi32(DotAVX2(R, G, B, C.YR, C.YG, C.YB), _mm256_set1_epi32(C.YBias)), MatrixFractionBits), C.MaxCode);
+        Result.U = DotAVX2(R, G, B, C.UR, C.UG, C.UB);
+        Result.V = DotAVX2(R, G, B, C.VR, C.VG, C.VB);
+        return Result;
+    }
+
+    /** Interleaved U V codes for the four 2x2 blocks of an eight column run, as eight 32-bit lanes in output order. */
+    PANORAMA_TARGET_AVX2 FORCEINLINE __m256i AverageChromaAVX2(const FPixelsAVX2& Row0, const FPixelsAVX2& Row1, const FYUVCoefficients& C)
+    {
+        const __m256i USum = _mm256_add_epi32(Row0.U, Row1.U);
+        const __m256i VSum = _mm256_add_epi32(Row0.V, Row1.V);
+        // hadd works per 128-bit lane: u01 u23 v01 v23 | u45 u67 v45 v67 -> u01 v01 u23 v23 | u45 v45 u67 v67
+        const __m256i Pairs = _mm256_shuffle_epi32(_mm256_hadd_epi32(USum, VSum), _MM_SHUFFLE(3, 1, 2, 0));
+        return ClampCodeAVX2(_mm256_srai_epi32(_mm256_add_epi32(Pairs, _mm256_set1_epi32(C.CBias)), ChromaFractionBits), C.MaxCode);
+    }
+
+    PANORAMA_TARGET_AVX2 FORCEINLINE __m128i PackToWordsAVX2(__m256i Value)
+    {
+        return _mm_packus_epi32(_mm256_castsi256_si128(Value), _mm256_extracti128_si256(Value, 1));
+    }
+
+    PANORAMA_TARGET_AVX2 void ConvertRowPairNV12AVX2(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint8* OutY0, uint8* OutY1, uint8* OutUV)
+    {
+        const int32 VectorWidth = Width & ~7;
+
+        for (int32 X = 0; X < VectorWidth; X += 8)
+        {
+            const FPixelsAVX2 Row0 = ConvertPixelsAVX2(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsAVX2 Row1 = ConvertPixelsAVX2(SourceRow1 + X, Codes, Coefficients);
+            const __m256i Chroma = AverageChromaAVX2(Row0, Row1, Coefficients);
+
+            const __m128i LumaBytes = _mm_packus_epi16(PackToWordsAVX2(Row0.Y), PackToWordsAVX2(Row1.Y));
+            const __m128i ChromaWords = PackToWordsAVX2(Chroma);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutY0 + X), LumaBytes);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutY1 + X), _mm_srli_si128(LumaBytes, 8));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(OutUV + X), _mm_packus_epi16(ChromaWords, ChromaWords));
+        }
+
+        ConvertRowPairScalar<uint8>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+
+    PANORAMA_TARGET_AVX2 void ConvertRowPairP010AVX2(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint16* OutY0, uint16* OutY1, uint16* OutUV)
+    {
+        const int32 VectorWidth = Width & ~7;
+
+        for (int32 X = 0; X < VectorWidth; X += 8)
+        {
+            const FPixelsAVX2 Row0 = ConvertPixelsAVX2(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsAVX2 Row1 = ConvertPixelsAVX2(SourceRow1 + X, Codes, Coefficients);
+            const __m256i Chroma = AverageChromaAVX2(Row0, Row1, Coefficients);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(OutY0 + X), _mm_slli_epi16(PackToWordsAVX2(Row0.Y), SampleShift<uint16>));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(OutY1 + X), _mm_slli_epi16(PackToWordsAVX2(Row1.Y), SampleShift<uint16>));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(OutUV + X), _mm_slli_epi16(PackToWordsAVX2(Chroma), SampleShift<uint16>));
+        }
+
+        ConvertRowPairScalar<uint16>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+#endif // PANORAMA_WITH_X86_KERNELS
+
+#if PANORAMA_WITH_NEON_KERNELS
+    // ---------------------------------------------------------------------------------------------
+    // NEON (AArch64): eight pixels per row per iteration using the structured vld4 deinterleave.
+    // ---------------------------------------------------------------------------------------------
+
+    void DecodeHalfColorsNEON(const FFloat16Color* Source, int32 Count, float* OutRGBA)
+    {
+        int32 Index = 0;
+        for (; Index + 2 <= Count; Index += 2)
+        {
+            const float16x8_t Halves = vreinterpretq_f16_u16(vld1q_u16(reinterpret_cast<const uint16*>(Source + Index)));
+            vst1q_f32(OutRGBA + Index * 4, vcvt_f32_f16(vget_low_f16(Halves)));
+            vst1q_f32(OutRGBA + Index * 4 + 4, vcvt_high_f32_f16(Halves));
+        }
+        DecodeHalfColorsPortable(Source + Index, Count - Index, OutRGBA + Index * 4);
+    }
+
+    /** NEON has no gather; the eight lookups go through a small stack buffer. */
+    FORCEINLINE void LookupCodesNEON(uint16x8_t HalfBits, const uint16* Codes, int32x4_t& OutLow, int32x4_t& OutHigh)
+    {
+        uint16 Bits[8];
+        vst1q_u16(Bits, HalfBits);
+        uint16 Looked[8];
+        for (int32 Lane = 0; Lane < 8; ++Lane)
+        {
+            Looked[Lane] = Codes[Bits[Lane]];
+        }
+        const uint16x8_t Values = vld1q_u16(Looked);
+        OutLow = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(Values)));
+        OutHigh = vreinterpretq_s32_u32(vmovl_high_u16(Values));
+    }
+
+    FORCEINLINE int32x4_t DotNEON(int32x4_t R, int32x4_t G, int32x4_t B, int32 CR, int32 CG, int32 CB)
+    {
+        return vmlaq_n_s32(vmlaq_n_s32(vmulq_n_s32(R, CR), G, CG), B, CB);
+    }
+
+    FORCEINLINE int32x4_t ClampCodeNEON(int32x4_t Value, int32 MaxCode)
+    {
+        return vminq_s32(vmaxq_s32(Value, vdupq_n_s32(0)), vdupq_n_s32(MaxCode));
+    }
+
+    struct FPixelsNEON
+    {
+        int32x4_t Y[2];
+        int32x4_t U[2];
+        int32x4_t V[2];
+    };
+
+    FORCEINLINE FPixelsNEON ConvertPixelsNEON(const FFloat16Color* Source, const uint16* Codes, const FYUVCoefficients& C)
+    {
+        const uint16x8x4_t Channels = vld4q_u16(reinterpret_cast<const uint16*>(Source));
+
+        int32x4_t R[2];
+        int32x4_t G[2];
+        int32x4_t B[2];
+        LookupCodesNEON(Channels.val[0], Codes, R[0], R[1]);
+        LookupCodesNEON(Channels.val[1], Codes, G[0], G[1]);
+        LookupCodesNEON(Channels.val[2], Codes, B[0], B[1]);
+
+        FPixelsNEON Result;
+        for (int32 Half = 0; Half < 2; ++Half)
+        {
+            const int32x4_t Luma = vaddq_s32(DotNEON(R[Half], G[Half], B[Half], C.YR, C.YG, C.YB), vdupq_n_s32(C.YBias));
+            Result.Y[Half] = ClampCodeNEON(vshrq_n_s32(Luma, MatrixFractionBits), C.MaxCode);
+            Result.U[Half] = DotNEON(R[Half], G[Half], B[Half], C.UR, C.UG, C.UB);
+            Result.V[Half] = DotNEON(R[Half], G[Half], B[Half], C.VR, C.VG, C.VB);
+        }
+        return Result;
+    }
+
+    /** Returns the chroma codes u01 v01 u23 v23 | u45 v45 u67 v67 as two vectors. */
+    FORCEINLINE void AverageChromaNEON(const FPixelsNEON& Row0, const FPixelsNEON& Row1, const FYUVCoefficients& C, int32x4_t& OutLow, int32x4_t& OutHigh)
+    {
+        const int32x4_t USum = vpaddq_s32(vaddq_s32(Row0.U[0], Row1.U[0]), vaddq_s32(Row0.U[1], Row1.U[1]));
+        const int32x4_t VSum = vpaddq_s32(vaddq_s32(Row0.V[0], Row1.V[0]), vaddq_s32(Row0.V[1], Row1.V[1]));
+        const int32x4x2_t Interleaved = vzipq_s32(USum, VSum);
+        const int32x4_t Bias = vdupq_n_s32(C.CBias);
+        OutLow = ClampCodeNEON(vshrq_n_s32(vaddq_s32(Interleaved.val[0], Bias), ChromaFractionBits), C.MaxCode);
+        OutHigh = ClampCodeNEON(vshrq_n_s32(vaddq_s32(Interleaved.val[1], Bias), ChromaFractionBits), C.MaxCode);
+    }
+
+    FORCEINLINE uint16x8_t PackToWordsNEON(int32x4_t Low, int32x4_t High)
+    {
+        return vcombine_u16(vqmovun_s32(Low), vqmovun_s32(High));
+    }
+
+    void ConvertRowPairNV12NEON(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint8* OutY0, uint8* OutY1, uint8* OutUV)
+    {
+        const int32 VectorWidth = Width & ~7;
+
+        for (int32 X = 0; X < VectorWidth; X += 8)
+        {
+            const FPixelsNEON Row0 = ConvertPixelsNEON(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsNEON Row1 = ConvertPixelsNEON(SourceRow1 + X, Codes, Coefficients);
+            int32x4_t ChromaLow;
+            int32x4_t ChromaHigh;
+            AverageChromaNEON(Row0, Row1, Coefficients, ChromaLow, ChromaHigh);
+
+            vst1_u8(OutY0 + X, vqmovn_u16(PackToWordsNEON(Row0.Y[0], Row0.Y[1])));
+            vst1_u8(OutY1 + X, vqmovn_u16(PackToWordsNEON(Row1.Y[0], Row1.Y[1])));
+            vst1_u8(OutUV + X, vqmovn_u16(PackToWordsNEON(ChromaLow, ChromaHigh)));
+        }
+
+        ConvertRowPairScalar<uint8>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+
+    void ConvertRowPairP010NEON(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, const uint16* Codes, const FYUVCoefficients& Coefficients, uint16* OutY0, uint16* OutY1, uint16* OutUV)
+    {
+        const int32 VectorWidth = Width & ~7;
+
+        for (int32 X = 0; X < VectorWidth; X += 8)
+        {
+            const FPixelsNEON Row0 = ConvertPixelsNEON(SourceRow0 + X, Codes, Coefficients);
+            const FPixelsNEON Row1 = ConvertPixelsNEON(SourceRow1 + X, Codes, Coefficients);
+            int32x4_t ChromaLow;
+            int32x4_t ChromaHigh;
+            AverageChromaNEON(Row0, Row1, Coefficients, ChromaLow, ChromaHigh);
+
+            vst1q_u16(OutY0 + X, vshlq_n_u16(PackToWordsNEON(Row0.Y[0], Row0.Y[1]), SampleShift<uint16>));
+            vst1q_u16(OutY1 + X, vshlq_n_u16(PackToWordsNEON(Row1.Y[0], Row1.Y[1]), SampleShift<uint16>));
+            vst1q_u16(OutUV + X, vshlq_n_u16(PackToWordsNEON(ChromaLow, ChromaHigh), SampleShift<uint16>));
+        }
+
+        ConvertRowPairScalar<uint16>(SourceRow0, SourceRow1, VectorWidth, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+    }
+#endif // PANORAMA_WITH_NEON_KERNELS
+
+    EInstructionSet DetectInstructionSet()
+    {
+#if PANORAMA_WITH_X86_KERNELS
+        const FCpuFeatures Features = QueryCpuFeatures();
+        if (Features.bAVX2 && Features.bF16C)
+        {
+            return EInstructionSet::AVX2;
+        }
+        if (Features.bSSE41)
+        {
+            return EInstructionSet::SSE41;
+        }
+#elif PANORAMA_WITH_NEON_KERNELS
+        return EInstructionSet::NEON;
+#endif
+        return EInstructionSet::Scalar;
+    }
+
+    EInstructionSet GetDetectedInstructionSet()
+    {
+        static const EInstructionSet InstructionSet = DetectInstructionSet();
+        return InstructionSet;
+    }
+
+    /** Instruction set pinned on this thread, or -1 to use the detected one. */
+    thread_local int32 ThreadInstructionSetOverride = -1;
+}
+
+EInstructionSet GetActiveInstructionSet()
+{
+    const int32 Override = ThreadInstructionSetOverride;
+    return Override >= 0 ? static_cast<EInstructionSet>(Override) : GetDetectedInstructionSet();
+}
+
+bool IsInstructionSetSupported(EInstructionSet InstructionSet)
+{
+    const EInstructionSet Detected = GetDetectedInstructionSet();
+    if (InstructionSet == EInstructionSet::Scalar || InstructionSet == Detected)
+    {
+        return true;
+    }
+    // AVX2 CPUs run the SSE4.1 kernels too.
+    return InstructionSet == EInstructionSet::SSE41 && Detected == EInstructionSet::AVX2;
+}
+
+FScopedInstructionSetOverride::FScopedInstructionSetOverride(EInstructionSet InstructionSet)
+    : PreviousOverride(ThreadInstructionSetOverride)
+{
+    if (IsInstructionSetSupported(InstructionSet))
+    {
+        ThreadInstructionSetOverride = static_cast<int32>(InstructionSet);
+    }
+}
+
+FScopedInstructionSetOverride::~FScopedInstructionSetOverride()
+{
+    ThreadInstructionSetOverride = PreviousOverride;
+}
+
+bool HasVectorKernels()
+{
+    return GetActiveInstructionSet() != EInstructionSet::Scalar;
+}
+
+const TCHAR* LexToString(EInstructionSet InstructionSet)
+{
+    switch (InstructionSet)
+    {
+    case EInstructionSet::SSE41:
+        return TEXT("SSE4.1");
+    case EInstructionSet::AVX2:
+        return TEXT("AVX2");
+    case EInstructionSet::NEON:
+        return TEXT("NEON");
+    default:
+        return TEXT("Scalar");
+    }
+}
+
+void DecodeHalfColors(const FFloat16Color* Source, int32 Count, float* OutRGBA)
+{
+    switch (GetActiveInstructionSet())
+    {
+#if PANORAMA_WITH_X86_KERNELS
+    case EInstructionSet::AVX2:
+        DecodeHalfColorsF16C(Source, Count, OutRGBA);
+        return;
+    case EInstructionSet::SSE41:
+        DecodeHalfColorsSSE41(Source, Count, OutRGBA);
+        return;
+#endif
+#if PANORAMA_WITH_NEON_KERNELS
+    case EInstructionSet::NEON:
+        DecodeHalfColorsNEON(Source, Count, OutRGBA);
+        return;
+#endif
+    default:
+        DecodeHalfColorsPortable(Source, Count, OutRGBA);
+        return;
+    }
+}
+
+void ConvertRowPairNV12(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, uint8* OutY0, uint8* OutY1, uint8* OutUV)
+{
+    const uint16* Codes = GetTransferCodes(GammaMode);
+    const FYUVCoefficients& Coefficients = GetCoefficients(Matrix, false);
+    switch (GetActiveInstructionSet())
+    {
+#if PANORAMA_WITH_X86_KERNELS
+    case EInstructionSet::AVX2:
+        ConvertRowPairNV12AVX2(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+    case EInstructionSet::SSE41:
+        ConvertRowPairNV12SSE41(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+#endif
+#if PANORAMA_WITH_NEON_KERNELS
+    case EInstructionSet::NEON:
+        ConvertRowPairNV12NEON(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+#endif
+    default:
+        ConvertRowPairScalar<uint8>(SourceRow0, SourceRow1, 0, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+    }
+}
+
+void ConvertRowPairP010(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, uint16* OutY0, uint16* OutY1, uint16* OutUV)
+{
+    const uint16* Codes = GetTransferCodes(GammaMode);
+    const FYUVCoefficients& Coefficients = GetCoefficients(Matrix, true);
+    switch (GetActiveInstructionSet())
+    {
+#if PANORAMA_WITH_X86_KERNELS
+    case EInstructionSet::AVX2:
+        ConvertRowPairP010AVX2(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+    case EInstructionSet::SSE41:
+        ConvertRowPairP010SSE41(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+#endif
+#if PANORAMA_WITH_NEON_KERNELS
+    case EInstructionSet::NEON:
+        ConvertRowPairP010NEON(SourceRow0, SourceRow1, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+#endif
+    default:
+        ConvertRowPairScalar<uint16>(SourceRow0, SourceRow1, 0, Width, Codes, Coefficients, OutY0, OutY1, OutUV);
+        return;
+    }
+}
+
+}
+}
+}
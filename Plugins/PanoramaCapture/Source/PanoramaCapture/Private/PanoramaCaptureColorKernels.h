@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PanoramaCaptureTypes.h"
+#include "Math/Float16Color.h"
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+namespace Kernels
+{
+    /** Instruction sets the row kernels are compiled for. Selected once at runtime from the CPU feature flags. */
+    enum class EInstructionSet : uint8
+    {
+        Scalar,
+        SSE41,
+        AVX2,
+        NEON
+    };
+
+    /** Returns the instruction set the kernels dispatch to: the fastest one the CPU supports unless overridden. */
+    EInstructionSet GetActiveInstructionSet();
+
+    /** True when the running CPU can execute kernels built for InstructionSet. */
+    bool IsInstructionSetSupported(EInstructionSet InstructionSet);
+
+    /**
+     * Pins dispatch on the calling thread to InstructionSet while in scope, e.g. Scalar to produce reference output.
+     * Other threads, such as a capture converting at the same time, keep the detected set. An instruction set the CPU
+     * does not support leaves dispatch unchanged. Conversions carry it to their workers through FConversionParallelism.
+     */
+    class FScopedInstructionSetOverride
+    {
+    public:
+        explicit FScopedInstructionSetOverride(EInstructionSet InstructionSet);
+        ~FScopedInstructionSetOverride();
+
+        FScopedInstructionSetOverride(const FScopedInstructionSetOverride&) = delete;
+        FScopedInstructionSetOverride& operator=(const FScopedInstructionSetOverride&) = delete;
+
+    private:
+        int32 PreviousOverride;
+    };
+
+    /** True when a vector kernel is available for the running CPU. */
+    bool HasVectorKernels();
+
+    const TCHAR* LexToString(EInstructionSet InstructionSet);
+
+    /**
+     * Decodes Count half-float pixels into interleaved RGBA floats (OutRGBA holds 4 * Count values). Uses the F16C or
+     * NEON conversion instructions when available; the portable fallback produces the same values as FFloat16::GetFloat.
+     */
+    void DecodeHalfColors(const FFloat16Color* Source, int32 Count, float* OutRGBA);
+
+    /**
+     * Converts two adjacent source rows into two NV12 luma rows and one interleaved UV row (2x2 chroma average).
+     * RGB is transfer-encoded to 12-bit codes through a lookup table and run through a Q14 fixed-point matrix, so the
+     * output is identical on every instruction set and compiler. Width must be even; Matrix must already be resolved
+     * (Auto is treated as BT.709). PQ expects BT.2020 linear input in units of TransferLUT::PQInputNits.
+     */
+    void ConvertRowPairNV12(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, uint8* OutY0, uint8* OutY1, uint8* OutUV);
+
+    /** P010 counterpart of ConvertRowPairNV12 producing 10-bit samples in the high bits of each word. */
+    void ConvertRowPairP010(const FFloat16Color* SourceRow0, const FFloat16Color* SourceRow1, int32 Width, EPanoramaGamma GammaMode, EPanoramaYUVMatrix Matrix, uint16* OutY0, uint16* OutY1, uint16* OutUV);
+}
+}
+}
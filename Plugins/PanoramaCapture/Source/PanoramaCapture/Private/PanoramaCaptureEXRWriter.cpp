@@ -0,0 +1,142 @@
+#include "PanoramaCaptureEXRWriter.h"
+#include "PanoramaCaptureLog.h"
+
+#if PANORAMA_WITH_OPENEXR
+THIRD_PARTY_INCLUDES_START
+#include "OpenEXR/ImfChannelList.h"
+#include "OpenEXR/ImfHeader.h"
+#include "OpenEXR/ImfIO.h"
+#include "OpenEXR/ImfOutputFile.h"
+#include "OpenEXR/ImfThreading.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+    /** OpenEXR output into a byte array, so the file is written with one call like the PNG frames. */
+    class FEXRMemoryStream : public Imf::OStream
+    {
+    public:
+        explicit FEXRMemoryStream(TArray64<uint8>& InBytes)
+            : Imf::OStream("PanoramaCaptureEXR")
+            , Bytes(InBytes)
+        {
+            Bytes.Reset();
+        }
+
+        virtual void write(const char Data[], int NumBytes) override
+        {
+            const int64 End = Position + NumBytes;
+            if (End > Bytes.Num())
+            {
+                Bytes.AddUninitialized(End - Bytes.Num());
+            }
+            FMemory::Memcpy(Bytes.GetData() + Position, Data, NumBytes);
+            Position = End;
+        }
+
+        virtual uint64_t tellp() override
+        {
+            return static_cast<uint64_t>(Position);
+        }
+
+        virtual void seekp(uint64_t InPosition) override
+        {
+            // OpenEXR seeks back only to patch the line offset table it already wrote.
+            Position = static_cast<int64>(InPosition);
+        }
+
+    private:
+        TArray64<uint8>& Bytes;
+        int64 Position = 0;
+    };
+
+    Imf::Compression ToImfCompression(EPanoramaEXRCompression Compression)
+    {
+        switch (Compression)
+        {
+        case EPanoramaEXRCompression::None:
+            return Imf::NO_COMPRESSION;
+        case EPanoramaEXRCompression::ZIP:
+            return Imf::ZIP_COMPRESSION;
+        case EPanoramaEXRCompression::DWAA:
+            return Imf::DWAA_COMPRESSION;
+        default:
+            break;
+        }
+        return Imf::PIZ_COMPRESSION;
+    }
+}
+#endif
+
+namespace PanoramaCapture
+{
+namespace EXR
+{
+bool IsSupported()
+{
+    return PANORAMA_WITH_OPENEXR != 0;
+}
+
+int32 ConfigureThreads(int32 NumThreads)
+{
+#if PANORAMA_WITH_OPENEXR
+    const int32 PreviousThreads = Imf::globalThreadCount();
+    if (PreviousThreads != NumThreads)
+    {
+        Imf::setGlobalThreadCount(FMath::Max(0, NumThreads));
+    }
+    return PreviousThreads;
+#else
+    return INDEX_NONE;
+#endif
+}
+
+bool EncodeRGBAHalf(const FFloat16Color* Pixels, const FIntPoint& Resolution, EPanoramaEXRCompression Compression, TArray64<uint8>& OutFile)
+{
+#if PANORAMA_WITH_OPENEXR
+    if (!Pixels || Resolution.X <= 0 || Resolution.Y <= 0)
+    {
+        return false;
+    }
+
+    static_assert(sizeof(FFloat16Color) == 4 * sizeof(uint16), "FFloat16Color must be four packed halves");
+    const size_t PixelStride = sizeof(FFloat16Color);
+    const size_t RowStride = PixelStride * Resolution.X;
+
+    try
+    {
+        Imf::Header Header(Resolution.X, Resolution.Y);
+        Header.compression() = ToImfCompression(Compression);
+        Header.channels().insert("R", Imf::Channel(Imf::HALF));
+        Header.channels().insert("G", Imf::Channel(Imf::HALF));
+        Header.channels().insert("B", Imf::Channel(Imf::HALF));
+        Header.channels().insert("A", Imf::Channel(Imf::HALF));
+
+        // Each channel slice strides over the interleaved pixels, so no planar copy of the frame is made.
+        char* Base = const_cast<char*>(reinterpret_cast<const char*>(Pixels));
+        Imf::FrameBuffer FrameBuffer;
+        FrameBuffer.insert("R", Imf::Slice(Imf::HALF, Base + STRUCT_OFFSET(FFloat16Color, R), PixelStride, RowStride));
+        FrameBuffer.insert("G", Imf::Slice(Imf::HALF, Base + STRUCT_OFFSET(FFloat16Color, G), PixelStride, RowStride));
+        FrameBuffer.insert("B", Imf::Slice(Imf::HALF, Base + STRUCT_OFFSET(FFloat16Color, B), PixelStride, RowStride));
+        FrameBuffer.insert("A", Imf::Slice(Imf::HALF, Base + STRUCT_OFFSET(FFloat16Color, A), PixelStride, RowStride));
+
+        // The file compresses its line blocks on the global pool, in parallel with the other frames being written.
+        FEXRMemoryStream Stream(OutFile);
+        Imf::OutputFile File(Stream, Header, Imf::globalThreadCount());
+        File.setFrameBuffer(FrameBuffer);
+        File.writePixels(Resolution.Y);
+    }
+    catch (const std::exception& Exception)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("OpenEXR failed to encode frame: %s"), UTF8_TO_TCHAR(Exception.what()));
+        return false;
+    }
+
+    // The line offset table is finalized when the file object goes out of scope above.
+    return OutFile.Num() > 0;
+#else
+    return false;
+#endif
+}
+}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PanoramaCaptureTypes.h"
+#include "Math/Float16Color.h"
+
+namespace PanoramaCapture
+{
+namespace EXR
+{
+    /** False when the module was built without OpenEXR for this platform. */
+    bool IsSupported();
+
+    /**
+     * Sizes OpenEXR's global pool, which compresses the line blocks of every file being written and is shared with the
+     * rest of the engine. Returns the previous size for the caller to restore, or INDEX_NONE without OpenEXR. Not
+     * thread safe against EXR work elsewhere in the process.
+     */
+    int32 ConfigureThreads(int32 NumThreads);
+
+    /**
+     * Encodes Resolution.X * Resolution.Y tightly packed half-float pixels as a scanline RGBA EXR in OutFile, which
+     * keeps its allocation across calls. The half values are written as they are: OpenEXR reads the interleaved pixels
+     * through strided slices, so the only per-pixel work is its planar reordering inside each line block.
+     */
+    bool EncodeRGBAHalf(const FFloat16Color* Pixels, const FIntPoint& Resolution, EPanoramaEXRCompression Compression, TArray64<uint8>& OutFile);
+}
+}
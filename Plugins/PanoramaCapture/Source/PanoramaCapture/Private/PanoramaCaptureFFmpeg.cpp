@@ -1,6 +1,10 @@
 #include "PanoramaCaptureFFmpeg.h"
 #include "PanoramaCaptureFrame.h"
 #include "PanoramaCaptureLog.h"
+#include "PanoramaCaptureColorConversion.h"
+#include "PanoramaCaptureIntermediate.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
 #include "HAL/FileManager.h"
 #include "Interfaces/IPluginManager.h"
@@ -8,6 +12,58 @@
 
 namespace
 {
+    /** Largest single write into ffmpeg's stdin; a frame is streamed in several so a full pipe never stalls a huge call. */
+    static constexpr int32 GPipeChunkBytes = 4 * 1024 * 1024;
+
+    /** An intermediate file and its decoded pixels; the buffers are reused from frame to frame. */
+    struct FIntermediateFrame
+    {
+        TArray64<uint8> File;
+        TArray<FFloat16Color> Pixels;
+        FIntPoint Resolution = FIntPoint::ZeroValue;
+    };
+
+    bool LoadIntermediateFrame(const FString& FilePath, FIntermediateFrame& Frame)
+    {
+        if (!FFileHelper::LoadFileToArray(Frame.File, *FilePath))
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to read intermediate frame %s"), *FilePath);
+            return false;
+        }
+        if (!PanoramaCapture::Intermediate::DecodeFrame(Frame.File, Frame.Pixels, Frame.Resolution))
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Intermediate frame is corrupt: %s"), *FilePath);
+            return false;
+        }
+        return true;
+    }
+
+    bool WriteToPipe(void* Pipe, FProcHandle& ProcHandle, const uint8* Data, int64 NumBytes)
+    {
+        while (NumBytes > 0)
+        {
+            const int32 ChunkBytes = static_cast<int32>(FMath::Min<int64>(NumBytes, GPipeChunkBytes));
+            int32 BytesWritten = 0;
+            if (!FPlatformProcess::WritePipe(Pipe, Data, ChunkBytes, &BytesWritten))
+            {
+                return false;
+            }
+            if (BytesWritten <= 0)
+            {
+                // The pipe is full until ffmpeg catches up, unless ffmpeg is gone.
+                if (!FPlatformProcess::IsProcRunning(ProcHandle))
+                {
+                    return false;
+                }
+                FPlatformProcess::Sleep(0.0f);
+                continue;
+            }
+            Data += BytesWritten;
+            NumBytes -= BytesWritten;
+        }
+        return true;
+    }
+
     const TCHAR* GetFFmpegPixelFormat(EPanoramaColorFormat Format)
     {
         switch (Format)
@@ -23,6 +79,33 @@ namespace
         }
         return TEXT("nv12");
     }
+
+    /** Primaries and transfer follow the gamma mode; the matrix tag follows the matrix the converter actually used. */
+    FString GetFFmpegColorTags(const FPanoramicVideoSettings& Settings)
+    {
+        FString Tags;
+        switch (Settings.Gamma)
+        {
+        case EPanoramaGamma::PQ:
+            Tags = TEXT(" -color_primaries bt2020 -color_trc smpte2084");
+            break;
+        case EPanoramaGamma::Linear:
+            Tags = TEXT(" -color_primaries bt709 -color_trc linear");
+            break;
+        default:
+            Tags = TEXT(" -color_primaries bt709 -color_trc bt709");
+            break;
+        }
+        const EPanoramaYUVMatrix Matrix = PanoramaCapture::Color::ResolveYUVMatrix(Settings.YUVMatrix, Settings.Gamma);
+        Tags += (Matrix == EPanoramaYUVMatrix::BT2020) ? TEXT(" -colorspace bt2020nc") : TEXT(" -colorspace bt709");
+        return Tags;
+    }
+
+    /** Transfer ffmpeg's EXR decoder applies to the scene-linear frames so they match the PNG path's encoding. */
+    const TCHAR* GetFFmpegEXRTransfer(EPanoramaGamma Gamma)
+    {
+        return Gamma == EPanoramaGamma::Linear ? TEXT("linear") : TEXT("iec61966_2_1");
+    }
 }
 
 FPanoramaFFmpegMuxer::FPanoramaFFmpegMuxer()
@@ -85,6 +168,7 @@ void FPanoramaFFmpegMuxer::Shutdown()
     OutputFilePath.Reset();
     AudioFilePath.Reset();
     CapturedFrameTimestamps.Reset();
+    CapturedFramePaths.Reset();
     CapturedFrameCount = 0;
     CachedAudioDurationSeconds = 0.0;
     NVENCRawVideoPath.Reset();
@@ -98,6 +182,7 @@ void FPanoramaFFmpegMuxer::Configure(const FPanoramicVideoSettings& VideoSetting
     CachedVideoSettings = VideoSettings;
     CachedAudioSettings = AudioSettings;
     CapturedFrameTimestamps.Reset();
+    CapturedFramePaths.Reset();
     CapturedFrameCount = 0;
     CachedAudioDurationSeconds = 0.0;
     NVENCResolution = VideoSettings.Resolution;
@@ -110,6 +195,17 @@ void FPanoramaFFmpegMuxer::Configure(const FPanoramicVideoSettings& VideoSetting
     const bool bPreferMKV = CachedVideoSettings.bUseHEVC || CachedVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo;
     const FString ContainerName = bPreferMKV ? TEXT("PanoramaCapture.mkv") : TEXT("PanoramaCapture.mp4");
     OutputFilePath = FPaths::Combine(TargetDirectory, ContainerName);
+
+    const TCHAR* FrameExtension = TEXT("png");
+    if (VideoSettings.OutputFormat == EPanoramaOutputFormat::EXRSequence)
+    {
+        FrameExtension = TEXT("exr");
+    }
+    else if (VideoSettings.OutputFormat == EPanoramaOutputFormat::IntermediateSequence)
+    {
+        FrameExtension = PanoramaCapture::Intermediate::GetFileExtension();
+    }
+    FrameFilePattern = FPaths::Combine(FramesDirectory, FString::Printf(TEXT("Frame_%%06d.%s"), FrameExtension));
 }
 
 void FPanoramaFFmpegMuxer::AddVideoFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
@@ -119,22 +215,26 @@ void FPanoramaFFmpegMuxer::AddVideoFrame(const TSharedPtr<FPanoramaFrame, ESPMod
         return;
     }
 
-    if (!Frame->DiskFilePath.IsEmpty())
+    if (const FPanoramaPersistedPayload* Persisted = Frame->GetPersisted())
     {
-        if (!FPaths::FileExists(Frame->DiskFilePath))
+        if (!FPaths::FileExists(Persisted->FilePath))
         {
-            UE_LOG(LogPanoramaCapture, Warning, TEXT("PNG frame missing on disk: %s"), *Frame->DiskFilePath);
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Sequence frame missing on disk: %s"), *Persisted->FilePath);
             return;
         }
 
         CapturedFrameTimestamps.Add(Frame->TimestampSeconds);
+        CapturedFramePaths.Add(Persisted->FilePath);
         ++CapturedFrameCount;
     }
-    else if (Frame->EncodedVideo.Num() > 0)
+    else if (const FPanoramaEncodedPayload* Encoded = Frame->GetEncoded())
     {
-        CapturedFrameTimestamps.Add(Frame->TimestampSeconds);
-        ++CapturedFrameCount;
-        Frame->EncodedVideo.Reset();
+        // The encoder already appended the bytes to the raw stream; the buffer goes back to the pool with the frame.
+        if (Encoded->Bytes.Num() > 0)
+        {
+            CapturedFrameTimestamps.Add(Frame->TimestampSeconds);
+            ++CapturedFrameCount;
+        }
     }
 }
 
@@ -172,91 +272,207 @@ void FPanoramaFFmpegMuxer::FinalizeContainer()
         return;
     }
 
-    if (CachedVideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence)
+    switch (CachedVideoSettings.OutputFormat)
+    {
+    case EPanoramaOutputFormat::NVENC:
+        FinalizeNVENCStream();
+        break;
+    case EPanoramaOutputFormat::IntermediateSequence:
+        FinalizeIntermediateSequence();
+        break;
+    default:
+        FinalizeImageSequence();
+        break;
+    }
+}
+
+void FPanoramaFFmpegMuxer::FinalizeImageSequence()
+{
+    if (CapturedFrameCount == 0)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("No frames were captured - skipping ffmpeg invocation"));
+        return;
+    }
+
+    const double FrameRate = ComputeFrameRate();
+    FString CommandLine = FString::Printf(TEXT("-y -framerate %.6f"), FrameRate);
+    if (CachedVideoSettings.OutputFormat == EPanoramaOutputFormat::EXRSequence)
+    {
+        // Without it the EXR decoder hands over linear light, which encodes dark and clips everything above 1.0.
+        CommandLine += FString::Printf(TEXT(" -apply_trc %s"), GetFFmpegEXRTransfer(CachedVideoSettings.Gamma));
+    }
+    CommandLine += FString::Printf(TEXT(" -i \"%s\""), *FrameFilePattern);
+    CommandLine += BuildSequenceOutputArguments();
+
+    if (!InvokeFFmpeg(CommandLine))
     {
-        FinalizePNGSequence();
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to run ffmpeg. Command line: %s"), *CommandLine);
     }
     else
     {
-        FinalizeNVENCStream();
+        UE_LOG(LogPanoramaCapture, Log, TEXT("FFmpeg muxing complete -> %s"), *OutputFilePath);
+
+        // EXR frames carry the full HDR range for compositing, so only PNG intermediates are removed.
+        if (CachedVideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence)
+        {
+            CleanupFrameFiles();
+        }
     }
 }
 
-void FPanoramaFFmpegMuxer::FinalizePNGSequence()
+void FPanoramaFFmpegMuxer::FinalizeIntermediateSequence()
 {
-    if (CapturedFrameCount == 0)
+    if (CapturedFramePaths.Num() == 0)
     {
         UE_LOG(LogPanoramaCapture, Warning, TEXT("No frames were captured - skipping ffmpeg invocation"));
         return;
     }
 
+    if (FFmpegExecutablePath.IsEmpty() || !FPaths::FileExists(FFmpegExecutablePath))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("ffmpeg executable not found at %s"), *FFmpegExecutablePath);
+        return;
+    }
+
+    // The first frame fixes the raw stream's size before ffmpeg starts.
+    FIntermediateFrame Current;
+    if (!LoadIntermediateFrame(CapturedFramePaths[0], Current))
+    {
+        return;
+    }
+    const FIntPoint Resolution = Current.Resolution;
+
+    // The decoded frames go through the same quantization as the PNG path and reach ffmpeg as raw rgba64le on stdin,
+    // so the frames are never re-encoded to an image format on the way.
     const double FrameRate = ComputeFrameRate();
-    FString CommandLine = FString::Printf(TEXT("-y -framerate %.6f -i \"%s\""), FrameRate, *FrameFilePattern);
+    FString CommandLine = FString::Printf(TEXT("-y -f rawvideo -pix_fmt rgba64le -s %dx%d -framerate %.6f -i pipe:0"), Resolution.X, Resolution.Y, FrameRate);
+    CommandLine += BuildSequenceOutputArguments();
+
+    void* ReadPipe = nullptr;
+    void* WritePipe = nullptr;
+    if (!FPlatformProcess::CreatePipe(ReadPipe, WritePipe, true))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to create the ffmpeg input pipe"));
+        return;
+    }
+
+    UE_LOG(LogPanoramaCapture, Log, TEXT("Invoking ffmpeg %s %s"), *FFmpegExecutablePath, *CommandLine);
+
+    FProcHandle ProcHandle = FPlatformProcess::CreateProc(*FFmpegExecutablePath, *CommandLine, false, true, true, nullptr, 0, nullptr, nullptr, ReadPipe);
+    if (!ProcHandle.IsValid())
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to launch ffmpeg process"));
+        FPlatformProcess::ClosePipe(ReadPipe, WritePipe);
+        return;
+    }
+
+    // The next file is read and decoded on the thread pool while the current one is quantized and streamed.
+    FIntermediateFrame Next;
+    TArray<uint16> RGBA16Pixels;
+    bool bStreamed = true;
+    for (int32 FrameIndex = 0; FrameIndex < CapturedFramePaths.Num() && bStreamed; ++FrameIndex)
+    {
+        TFuture<bool> NextLoaded;
+        if (FrameIndex + 1 < CapturedFramePaths.Num())
+        {
+            NextLoaded = Async(EAsyncExecution::ThreadPool, [&Next, FilePath = CapturedFramePaths[FrameIndex + 1]]()
+            {
+                return LoadIntermediateFrame(FilePath, Next);
+            });
+        }
+
+        if (Current.Resolution != Resolution)
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Intermediate frame %d is %dx%d, expected %dx%d"), FrameIndex, Current.Resolution.X, Current.Resolution.Y, Resolution.X, Resolution.Y);
+            bStreamed = false;
+        }
+        else if (!PanoramaCapture::Color::ConvertLinearToRGBA16(Current.Pixels, Resolution, RGBA16Pixels)
+            || !WriteToPipe(WritePipe, ProcHandle, reinterpret_cast<const uint8*>(RGBA16Pixels.GetData()), static_cast<int64>(RGBA16Pixels.Num()) * sizeof(uint16)))
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to stream intermediate frame %d to ffmpeg"), FrameIndex);
+            bStreamed = false;
+        }
+
+        // Always joined, so the prefetch never outlives the buffers it writes.
+        if (NextLoaded.IsValid())
+        {
+            bStreamed &= NextLoaded.Get();
+            Swap(Current, Next);
+        }
+    }
+
+    // Closing our end of the pipe is ffmpeg's end of input.
+    FPlatformProcess::ClosePipe(ReadPipe, WritePipe);
+    if (!bStreamed)
+    {
+        FPlatformProcess::TerminateProc(ProcHandle);
+    }
+    FPlatformProcess::WaitForProc(ProcHandle);
+    int32 ReturnCode = 0;
+    FPlatformProcess::GetProcReturnCode(ProcHandle, &ReturnCode);
+    FPlatformProcess::CloseProc(ProcHandle);
 
+    if (!bStreamed || ReturnCode != 0)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Intermediate ffmpeg muxing failed (exit code %d); frames kept in %s. Command line: %s"), ReturnCode, *FramesDirectory, *CommandLine);
+        return;
+    }
+
+    UE_LOG(LogPanoramaCapture, Log, TEXT("FFmpeg muxing complete -> %s"), *OutputFilePath);
+    CleanupFrameFiles();
+}
+
+FString FPanoramaFFmpegMuxer::BuildSequenceOutputArguments() const
+{
+    FString Arguments;
     if (!AudioFilePath.IsEmpty() && FPaths::FileExists(AudioFilePath))
     {
-        CommandLine += FString::Printf(TEXT(" -i \"%s\" -c:a aac -ar %d -ac %d"), *AudioFilePath, CachedAudioSettings.SampleRate, CachedAudioSettings.NumChannels);
+        Arguments += FString::Printf(TEXT(" -i \"%s\" -c:a aac -ar %d -ac %d"), *AudioFilePath, CachedAudioSettings.SampleRate, CachedAudioSettings.NumChannels);
     }
 
     if (CachedVideoSettings.bUseHEVC)
     {
-        CommandLine += FString::Printf(TEXT(" -c:v libx265 -x265-params bitrate=%d"), CachedVideoSettings.TargetBitrateMbps * 1000);
+        Arguments += FString::Printf(TEXT(" -c:v libx265 -x265-params bitrate=%d"), CachedVideoSettings.TargetBitrateMbps * 1000);
     }
     else
     {
-        CommandLine += FString::Printf(TEXT(" -c:v libx264 -b:v %dk"), CachedVideoSettings.TargetBitrateMbps * 1000);
+        Arguments += FString::Printf(TEXT(" -c:v libx264 -b:v %dk"), CachedVideoSettings.TargetBitrateMbps * 1000);
     }
 
-    CommandLine += FString::Printf(TEXT(" -g %d"), CachedVideoSettings.GOPLength);
-    CommandLine += FString::Printf(TEXT(" -bf %d"), CachedVideoSettings.NumBFrames);
-    CommandLine += TEXT(" -pix_fmt yuv420p");
+    Arguments += FString::Printf(TEXT(" -g %d"), CachedVideoSettings.GOPLength);
+    Arguments += FString::Printf(TEXT(" -bf %d"), CachedVideoSettings.NumBFrames);
+    Arguments += TEXT(" -pix_fmt yuv420p");
 
     if (CachedVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo)
     {
         const bool bSideBySide = CachedVideoSettings.StereoLayout == EPanoramaStereoLayout::SideBySide;
         if (bSideBySide)
         {
-            CommandLine += TEXT(" -metadata:s:v:0 stereo=left-right -metadata:s:v:0 stereomode=left_right");
+            Arguments += TEXT(" -metadata:s:v:0 stereo=left-right -metadata:s:v:0 stereomode=left_right");
         }
         else
         {
-            CommandLine += TEXT(" -metadata:s:v:0 stereo=top-bottom -metadata:s:v:0 stereomode=top_bottom");
+            Arguments += TEXT(" -metadata:s:v:0 stereo=top-bottom -metadata:s:v:0 stereomode=top_bottom");
         }
     }
     else
     {
-        CommandLine += TEXT(" -metadata:s:v:0 stereo=mono");
+        Arguments += TEXT(" -metadata:s:v:0 stereo=mono");
     }
 
-    CommandLine += TEXT(" -metadata:s:v:0 projection=equirectangular");
-    if (CachedVideoSettings.Gamma == EPanoramaGamma::Linear)
-    {
-        CommandLine += TEXT(" -color_primaries bt2020 -colorspace bt2020nc -color_trc smpte2084");
-    }
-    else
-    {
-        CommandLine += TEXT(" -color_primaries bt709 -colorspace bt709 -color_trc bt709");
-    }
+    Arguments += TEXT(" -metadata:s:v:0 projection=equirectangular");
+    Arguments += GetFFmpegColorTags(CachedVideoSettings);
 
-    CommandLine += TEXT(" -color_range tv");
+    Arguments += TEXT(" -color_range tv");
 
     const bool bIsMP4 = OutputFilePath.EndsWith(TEXT(".mp4"));
     if (bIsMP4)
     {
-        CommandLine += TEXT(" -movflags +faststart");
+        Arguments += TEXT(" -movflags +faststart");
     }
 
-    CommandLine += FString::Printf(TEXT(" \"%s\""), *OutputFilePath);
-
-    if (!InvokeFFmpeg(CommandLine))
-    {
-        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to run ffmpeg. Command line: %s"), *CommandLine);
-    }
-    else
-    {
-        UE_LOG(LogPanoramaCapture, Log, TEXT("FFmpeg muxing complete -> %s"), *OutputFilePath);
-        CleanupPNGFrames();
-    }
+    Arguments += FString::Printf(TEXT(" \"%s\""), *OutputFilePath);
+    return Arguments;
 }
 
 void FPanoramaFFmpegMuxer::FinalizeNVENCStream()
@@ -334,14 +550,7 @@ void FPanoramaFFmpegMuxer::FinalizeNVENCStream()
     }
 
     CommandLine += TEXT(" -metadata:s:v:0 projection=equirectangular");
-    if (CachedVideoSettings.Gamma == EPanoramaGamma::Linear)
-    {
-        CommandLine += TEXT(" -color_primaries bt2020 -colorspace bt2020nc -color_trc smpte2084");
-    }
-    else
-    {
-        CommandLine += TEXT(" -color_primaries bt709 -colorspace bt709 -color_trc bt709");
-    }
+    CommandLine += GetFFmpegColorTags(CachedVideoSettings);
 
     CommandLine += TEXT(" -color_range tv");
 
@@ -364,7 +573,7 @@ void FPanoramaFFmpegMuxer::FinalizeNVENCStream()
     }
 }
 
-void FPanoramaFFmpegMuxer::CleanupPNGFrames()
+void FPanoramaFFmpegMuxer::CleanupFrameFiles()
 {
     if (FramesDirectory.IsEmpty())
     {
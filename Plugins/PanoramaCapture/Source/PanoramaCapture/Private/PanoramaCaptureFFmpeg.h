@@ -26,9 +26,11 @@ public:
     bool IsFFmpegAvailable() const { return bHasFFmpegExecutable; }
 
 private:
-    void FinalizePNGSequence();
+    void FinalizeImageSequence();
+    void FinalizeIntermediateSequence();
     void FinalizeNVENCStream();
-    void CleanupPNGFrames();
+    FString BuildSequenceOutputArguments() const;
+    void CleanupFrameFiles();
     double ComputeFrameRate() const;
     bool InvokeFFmpeg(const FString& CommandLine) const;
 
@@ -44,6 +46,8 @@ private:
     FPanoramicVideoSettings CachedVideoSettings;
     FPanoramicAudioSettings CachedAudioSettings;
     TArray<double> CapturedFrameTimestamps;
+    /** Persisted frame files in presentation order, read back by the intermediate finalize step. */
+    TArray<FString> CapturedFramePaths;
     int32 CapturedFrameCount;
     double CachedAudioDurationSeconds;
     FIntPoint NVENCResolution;
@@ -0,0 +1,220 @@
+#include "PanoramaCaptureFramePool.h"
+#include "PanoramaCaptureColorConversion.h"
+
+FPanoramaFramePool::~FPanoramaFramePool()
+{
+    Trim();
+}
+
+void FPanoramaFramePool::Configure(const FPanoramicVideoSettings& Settings, int32 MaxQueuedFrames, int64 IdleBudgetBytes)
+{
+    const int32 EyesPerCapture = Settings.CaptureMode == EPanoramaCaptureMode::Stereo ? 2 : 1;
+    const int64 FrameBytes = FMath::Max<int64>(1, EstimateFramePayloadBytes(Settings));
+
+    TArray<FPanoramaFrame*> Excess;
+    {
+        FScopeLock Lock(&CriticalSection);
+        MaxIdleFrames = FMath::Max(EyesPerCapture, MaxQueuedFrames);
+        MaxIdleBufferBytes = FMath::Max(FMath::Max<int64>(0, IdleBudgetBytes), FrameBytes * EyesPerCapture);
+        Hits = 0;
+        Misses = 0;
+        while (IdleFrames.Num() > MaxIdleFrames)
+        {
+            Excess.Add(IdleFrames.Pop());
+        }
+        while (IdleBufferBytes > MaxIdleBufferBytes && (IdlePixelBuffers.Num() > 0 || IdleByteBuffers.Num() > 0))
+        {
+            if (IdlePixelBuffers.Num() > 0)
+            {
+                IdleBufferBytes -= IdlePixelBuffers.Last().GetAllocatedSize();
+                IdlePixelBuffers.Pop();
+            }
+            else
+            {
+                IdleBufferBytes -= IdleByteBuffers.Last().GetAllocatedSize();
+                IdleByteBuffers.Pop();
+            }
+        }
+    }
+
+    for (FPanoramaFrame* Frame : Excess)
+    {
+        delete Frame;
+    }
+}
+
+TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> FPanoramaFramePool::Acquire()
+{
+    FPanoramaFrame* Frame = nullptr;
+    {
+        FScopeLock Lock(&CriticalSection);
+        if (IdleFrames.Num() > 0)
+        {
+            Frame = IdleFrames.Pop();
+        }
+    }
+
+    if (!Frame)
+    {
+        Frame = new FPanoramaFrame();
+    }
+
+    // The frame may outlive the pool (a capture torn down while the worker still holds it); it is then just freed.
+    TWeakPtr<FPanoramaFramePool, ESPMode::ThreadSafe> WeakPool = AsShared();
+    return MakeShareable(Frame, [WeakPool](FPanoramaFrame* ReleasedFrame)
+    {
+        if (TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe> Pool = WeakPool.Pin())
+        {
+            Pool->Release(ReleasedFrame);
+        }
+        else
+        {
+            delete ReleasedFrame;
+        }
+    });
+}
+
+TArray<FFloat16Color> FPanoramaFramePool::AcquirePixelBuffer()
+{
+    FScopeLock Lock(&CriticalSection);
+    if (IdlePixelBuffers.Num() > 0)
+    {
+        ++Hits;
+        TArray<FFloat16Color> Buffer = IdlePixelBuffers.Pop();
+        IdleBufferBytes -= Buffer.GetAllocatedSize();
+        return Buffer;
+    }
+    ++Misses;
+    return TArray<FFloat16Color>();
+}
+
+TArray<uint8> FPanoramaFramePool::AcquireByteBuffer()
+{
+    FScopeLock Lock(&CriticalSection);
+    if (IdleByteBuffers.Num() > 0)
+    {
+        ++Hits;
+        TArray<uint8> Buffer = IdleByteBuffers.Pop();
+        IdleBufferBytes -= Buffer.GetAllocatedSize();
+        return Buffer;
+    }
+    ++Misses;
+    return TArray<uint8>();
+}
+
+void FPanoramaFramePool::Recycle(FPanoramaFramePayload&& Payload)
+{
+    const int64 PayloadBytes = FPanoramaFrame::GetPayloadBytes(Payload);
+    if (PayloadBytes <= 0)
+    {
+        return;
+    }
+
+    FScopeLock Lock(&CriticalSection);
+    if (IdleBufferBytes + PayloadBytes > MaxIdleBufferBytes)
+    {
+        // Over budget: the payload is freed when it goes out of scope.
+        return;
+    }
+
+    if (FPanoramaReadbackPayload* Readback = Payload.TryGet<FPanoramaReadbackPayload>())
+    {
+        Readback->Pixels.Reset();
+        IdlePixelBuffers.Add(MoveTemp(Readback->Pixels));
+    }
+    else if (FPanoramaConvertedPayload* Converted = Payload.TryGet<FPanoramaConvertedPayload>())
+    {
+        Converted->Bytes.Reset();
+        IdleByteBuffers.Add(MoveTemp(Converted->Bytes));
+    }
+    else if (FPanoramaEncodedPayload* Encoded = Payload.TryGet<FPanoramaEncodedPayload>())
+    {
+        Encoded->Bytes.Reset();
+        IdleByteBuffers.Add(MoveTemp(Encoded->Bytes));
+    }
+    else
+    {
+        return;
+    }
+    IdleBufferBytes += PayloadBytes;
+}
+
+void FPanoramaFramePool::Release(FPanoramaFrame* Frame)
+{
+    // Drops the RHI reference and hands the payload buffer to the free lists; the frame itself is only a header.
+    Recycle(Frame->TakePayload());
+    Frame->ResetForReuse();
+    {
+        FScopeLock Lock(&CriticalSection);
+        if (IdleFrames.Num() < MaxIdleFrames)
+        {
+            IdleFrames.Add(Frame);
+            return;
+        }
+    }
+    delete Frame;
+}
+
+void FPanoramaFramePool::Trim()
+{
+    TArray<FPanoramaFrame*> Frames;
+    TArray<TArray<FFloat16Color>> PixelBuffers;
+    TArray<TArray<uint8>> ByteBuffers;
+    {
+        FScopeLock Lock(&CriticalSection);
+        Frames = MoveTemp(IdleFrames);
+        PixelBuffers = MoveTemp(IdlePixelBuffers);
+        ByteBuffers = MoveTemp(IdleByteBuffers);
+        IdleFrames.Reset();
+        IdlePixelBuffers.Reset();
+        IdleByteBuffers.Reset();
+        IdleBufferBytes = 0;
+    }
+
+    for (FPanoramaFrame* Frame : Frames)
+    {
+        delete Frame;
+    }
+}
+
+int32 FPanoramaFramePool::GetHitCount() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return Hits;
+}
+
+int32 FPanoramaFramePool::GetMissCount() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return Misses;
+}
+
+int64 FPanoramaFramePool::GetIdleBufferBytes() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return IdleBufferBytes;
+}
+
+int64 FPanoramaFramePool::EstimateFramePayloadBytes(const FPanoramicVideoSettings& Settings)
+{
+    const FIntPoint& Resolution = Settings.Resolution;
+    const int64 NumPixels = static_cast<int64>(FMath::Max(0, Resolution.X)) * FMath::Max(0, Resolution.Y);
+    int64 Bytes = NumPixels * sizeof(FFloat16Color);
+    if (Settings.OutputFormat == EPanoramaOutputFormat::NVENC)
+    {
+        // The converted payload; it becomes the encoded payload without a copy.
+        switch (Settings.ColorFormat)
+        {
+        case EPanoramaColorFormat::NV12:
+            Bytes += PanoramaCapture::Color::GetPlanarPayloadBytes(Resolution, sizeof(uint8));
+            break;
+        case EPanoramaColorFormat::P010:
+            Bytes += PanoramaCapture::Color::GetPlanarPayloadBytes(Resolution, sizeof(uint16));
+            break;
+        default:
+            Bytes += NumPixels * 4;
+            break;
+        }
+    }
+    return Bytes;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/Float16Color.h"
+#include "PanoramaCaptureTypes.h"
+#include "PanoramaCaptureFrame.h"
+
+/**
+ * Recycles FPanoramaFrame objects and, separately, the payload buffers that move between them. Acquire hands out an
+ * empty frame; when the last reference drops, on whichever thread, the frame's payload buffer goes to the matching
+ * free list and the frame goes back to the pool instead of being freed. Stages draw their output buffers with
+ * AcquirePixelBuffer/AcquireByteBuffer and hand displaced ones back with Recycle. Thread safe.
+ */
+class FPanoramaFramePool : public TSharedFromThis<FPanoramaFramePool, ESPMode::ThreadSafe>
+{
+public:
+    ~FPanoramaFramePool();
+
+    /**
+     * Sizes the pool for a capture: estimates one eye's payload from the resolution, output and color format, and
+     * lets idle buffers hold up to IdleBudgetBytes (at least one capture's worth). Idle frames are capped at
+     * MaxQueuedFrames. Also clears the hit/miss counters.
+     */
+    void Configure(const FPanoramicVideoSettings& Settings, int32 MaxQueuedFrames, int64 IdleBudgetBytes);
+
+    /** Returns a recycled frame when one is idle, otherwise a new one. The frame is at EPanoramaFrameStage::Empty. */
+    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> Acquire();
+
+    /** Empty arrays that keep the capacity of an earlier payload when one is idle. */
+    TArray<FFloat16Color> AcquirePixelBuffer();
+    TArray<uint8> AcquireByteBuffer();
+
+    /** Keeps the buffer of a payload that left its frame, if it fits in the idle budget. */
+    void Recycle(FPanoramaFramePayload&& Payload);
+
+    /** Frees every idle frame and buffer. Frames still referenced come back later and are kept or freed as usual. */
+    void Trim();
+
+    int32 GetHitCount() const;
+    int32 GetMissCount() const;
+
+    /** Bytes currently held by idle payload buffers. */
+    int64 GetIdleBufferBytes() const;
+
+    /** Expected CPU payload of one captured eye, used to size the pool. */
+    static int64 EstimateFramePayloadBytes(const FPanoramicVideoSettings& Settings);
+
+private:
+    void Release(FPanoramaFrame* Frame);
+
+    mutable FCriticalSection CriticalSection;
+    TArray<FPanoramaFrame*> IdleFrames;
+    TArray<TArray<FFloat16Color>> IdlePixelBuffers;
+    TArray<TArray<uint8>> IdleByteBuffers;
+    int64 IdleBufferBytes = 0;
+    int64 MaxIdleBufferBytes = 0;
+    int32 MaxIdleFrames = 2;
+    int32 Hits = 0;
+    int32 Misses = 0;
+};
@@ -0,0 +1,440 @@
+#include "PanoramaCaptureImageEncoder.h"
+#include "PanoramaCaptureFrame.h"
+#include "PanoramaCaptureFramePool.h"
+#include "PanoramaCaptureColorConversion.h"
+#include "PanoramaCapturePNGWriter.h"
+#include "PanoramaCaptureEXRWriter.h"
+#include "PanoramaCaptureIntermediate.h"
+#include "PanoramaCaptureLog.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+
+namespace
+{
+    /** Compression state lives on the heap and the heavy lifting runs on task graph or OpenEXR threads, so encoder threads need little stack. */
+    static constexpr uint32 GEncoderStackSize = 256 * 1024;
+
+    /** Without a session budget, jobs in flight may use at most this fraction of physical memory. */
+    static constexpr int64 GDefaultInFlightMemoryDivisor = 4;
+
+    /**
+     * Peak bytes a worker's context holds while encoding a frame of ImageBytes half-float pixels: PNG quantizes to a
+     * 16-bit copy, filters it and deflates the bands before assembling the file; EXR packs stereo pairs before writing;
+     * intermediates filter into planes and compress them. The arena keeps its peak until Stop, so this is the steady state.
+     */
+    int64 EstimateContextBytes(EPanoramaOutputFormat Format, int64 ImageBytes)
+    {
+        switch (Format)
+        {
+        case EPanoramaOutputFormat::EXRSequence:
+            return ImageBytes * 2;
+        case EPanoramaOutputFormat::IntermediateSequence:
+            return ImageBytes * 3;
+        default:
+            break;
+        }
+        return ImageBytes * 4;
+    }
+
+    void RecyclePayload(FPanoramaFramePool* Pool, FPanoramaFrame& Frame)
+    {
+        FPanoramaFramePayload Payload = Frame.TakePayload();
+        if (Pool)
+        {
+            Pool->Recycle(MoveTemp(Payload));
+        }
+    }
+}
+
+class FPanoramaImageEncodePool::FJob : public IQueuedWork
+{
+public:
+    explicit FJob(FPanoramaImageEncodePool& InOwner)
+        : Owner(InOwner)
+    {
+    }
+
+    virtual void DoThreadedWork() override
+    {
+        Owner.Execute(*this);
+    }
+
+    virtual void Abandon() override
+    {
+        // The slot may be reused as soon as bDone is published, so nothing in it is touched afterwards.
+        FEvent* CompletionEvent = Owner.CompletionEvent;
+        bSuccess = false;
+        bDone.Store(true);
+        CompletionEvent->Trigger();
+    }
+
+    FPanoramaImageEncodePool& Owner;
+    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> LeftFrame;
+    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> RightFrame;
+    EPanoramaStereoLayout Layout = EPanoramaStereoLayout::TopBottom;
+    FString FilePath;
+    bool bSuccess = false;
+
+    /** Set by the worker once the fields above are final; the draining thread reads them only after seeing it. */
+    TAtomic<bool> bDone{ true };
+};
+
+FPanoramaImageEncodePool::FPanoramaImageEncodePool()
+    : CompletionEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+}
+
+FPanoramaImageEncodePool::~FPanoramaImageEncodePool()
+{
+    Stop();
+    FPlatformProcess::ReturnSynchEventToPool(CompletionEvent);
+    CompletionEvent = nullptr;
+}
+
+void FPanoramaImageEncodePool::Start(int32 InNumWorkers, const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool, const FPanoramicVideoSettings& Settings, int64 MaxInFlightBytes)
+{
+    Stop();
+
+    FramePool = InFramePool;
+    OutputFormat = Settings.OutputFormat;
+    PNGOptions = FPanoramaPNGWriteOptions::FromProfile(Settings.PNGProfile);
+    EXRCompression = Settings.EXRCompression;
+    if (OutputFormat == EPanoramaOutputFormat::EXRSequence)
+    {
+        // Line blocks of every file in flight share one OpenEXR pool sized to the machine for the session; Stop hands
+        // the engine its own size back.
+        PreviousEXRThreads = PanoramaCapture::EXR::ConfigureThreads(FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+    }
+    NumWorkers = FMath::Max(1, InNumWorkers);
+
+    // Every job holds its readback until encoded, and every running job also fills a worker's context.
+    const int32 NumEyes = Settings.CaptureMode == EPanoramaCaptureMode::Stereo ? 2 : 1;
+    const int64 ReadbackBytes = static_cast<int64>(FMath::Max(1, Settings.Resolution.X)) * FMath::Max(1, Settings.Resolution.Y) * sizeof(FFloat16Color) * NumEyes;
+    const int64 WorkerBytes = ReadbackBytes + EstimateContextBytes(OutputFormat, ReadbackBytes);
+    const bool bHasBudget = MaxInFlightBytes > 0;
+    if (!bHasBudget)
+    {
+        // A worker per core would hold gigabytes each at 8K, so a frame-count queue still gets a bound.
+        MaxInFlightBytes = static_cast<int64>(FPlatformMemory::GetConstants().TotalPhysical / GDefaultInFlightMemoryDivisor);
+    }
+    const int32 AffordableWorkers = static_cast<int32>(FMath::Clamp<int64>(MaxInFlightBytes / WorkerBytes, 1, MAX_int32));
+    if (AffordableWorkers < NumWorkers)
+    {
+        UE_LOG(LogPanoramaCapture, Log, TEXT("Image encoders limited to %d of %d by the %s"), AffordableWorkers, NumWorkers,
+            bHasBudget ? TEXT("memory budget") : TEXT("physical memory allowance"));
+        NumWorkers = AffordableWorkers;
+    }
+
+    ThreadPool = FQueuedThreadPool::Allocate();
+    if (!ThreadPool->Create(NumWorkers, GEncoderStackSize, TPri_BelowNormal, TEXT("PanoramaImageEncoder")))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to create %d image encoder threads - encoding on the frame worker"), NumWorkers);
+        delete ThreadPool;
+        ThreadPool = nullptr;
+        NumWorkers = 0;
+    }
+
+    // One job beyond the worker count lets the draining thread queue the next frame while every worker is busy, if
+    // its readback fits the allowance too.
+    const bool bSpareSlot = ThreadPool && WorkerBytes * NumWorkers + ReadbackBytes <= MaxInFlightBytes;
+    const int32 NumSlots = ThreadPool ? NumWorkers + (bSpareSlot ? 1 : 0) : 1;
+    ReservedBytes = WorkerBytes * FMath::Max(1, NumWorkers) + (bSpareSlot ? ReadbackBytes : 0);
+    Jobs.Reserve(NumSlots);
+    for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+    {
+        Jobs.Add(MakeUnique<FJob>(*this));
+    }
+}
+
+void FPanoramaImageEncodePool::Stop()
+{
+    while (GetNumInFlight() > 0)
+    {
+        WaitForOldest();
+        DrainCompleted([](const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&, bool) {});
+    }
+
+    if (ThreadPool)
+    {
+        ThreadPool->Destroy();
+        delete ThreadPool;
+        ThreadPool = nullptr;
+    }
+
+    // Only after every job is done, so no file is mid-write when the pool resizes.
+    if (PreviousEXRThreads != INDEX_NONE)
+    {
+        PanoramaCapture::EXR::ConfigureThreads(PreviousEXRThreads);
+        PreviousEXRThreads = INDEX_NONE;
+    }
+
+    Jobs.Empty();
+    NextSubmitIndex = 0;
+    NextDrainIndex = 0;
+    FramePool.Reset();
+    NumWorkers = 0;
+    ReservedBytes = 0;
+
+    FScopeLock Lock(&CriticalSection);
+    IdleContexts.Empty();
+}
+
+void FPanoramaImageEncodePool::SetOnJobCompleted(TFunction<void()> InOnJobCompleted)
+{
+    FScopeLock Lock(&CriticalSection);
+    OnJobCompleted = MoveTemp(InOnJobCompleted);
+}
+
+bool FPanoramaImageEncodePool::CanSubmit() const
+{
+    return Jobs.Num() > 0 && GetNumInFlight() < Jobs.Num();
+}
+
+void FPanoramaImageEncodePool::Submit(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame, EPanoramaStereoLayout Layout, const FString& FilePath)
+{
+    check(CanSubmit());
+
+    FJob& Job = *Jobs[NextSubmitIndex % Jobs.Num()];
+    Job.LeftFrame = LeftFrame;
+    Job.RightFrame = RightFrame;
+    Job.Layout = Layout;
+    Job.FilePath = FilePath;
+    Job.bSuccess = false;
+    Job.bDone.Store(false, EMemoryOrder::Relaxed);
+    ++NextSubmitIndex;
+
+    if (ThreadPool)
+    {
+        ThreadPool->AddQueuedWork(&Job);
+    }
+    else
+    {
+        Execute(Job);
+    }
+}
+
+int32 FPanoramaImageEncodePool::DrainCompleted(TFunctionRef<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame, bool bSuccess)> Visitor)
+{
+    int32 NumDrained = 0;
+    while (NextDrainIndex < NextSubmitIndex)
+    {
+        FJob& Job = *Jobs[NextDrainIndex % Jobs.Num()];
+        if (!Job.bDone.Load())
+        {
+            break;
+        }
+
+        Visitor(Job.LeftFrame, Job.bSuccess);
+        Job.LeftFrame.Reset();
+        Job.RightFrame.Reset();
+        ++NextDrainIndex;
+        ++NumDrained;
+    }
+    return NumDrained;
+}
+
+void FPanoramaImageEncodePool::WaitForOldest()
+{
+    if (NextDrainIndex == NextSubmitIndex)
+    {
+        return;
+    }
+
+    // The event is auto-reset and stays signaled until consumed, so a completion between the check and the wait is not lost.
+    const FJob& Job = *Jobs[NextDrainIndex % Jobs.Num()];
+    while (!Job.bDone.Load())
+    {
+        CompletionEvent->Wait();
+    }
+}
+
+void FPanoramaImageEncodePool::Execute(FJob& Job)
+{
+    TUniquePtr<FEncodeContext> Context;
+    {
+        FScopeLock Lock(&CriticalSection);
+        Context = IdleContexts.Num() > 0 ? IdleContexts.Pop() : MakeUnique<FEncodeContext>();
+    }
+
+    const bool bSuccess = Encode(Job, *Context);
+    Context->Scratch.Reset();
+
+    FScopeLock Lock(&CriticalSection);
+    IdleContexts.Add(MoveTemp(Context));
+    Job.bSuccess = bSuccess;
+    Job.bDone.Store(true);
+    CompletionEvent->Trigger();
+    if (OnJobCompleted)
+    {
+        OnJobCompleted();
+    }
+}
+
+bool FPanoramaImageEncodePool::Encode(FJob& Job, FEncodeContext& Context)
+{
+    if (!Job.LeftFrame.IsValid())
+    {
+        return false;
+    }
+
+    FPanoramaFrame& LeftFrame = *Job.LeftFrame;
+    FPanoramaFrame* RightFrame = Job.RightFrame.Get();
+    const FIntPoint EyeResolution = LeftFrame.Resolution;
+    if (RightFrame && (RightFrame->Resolution != EyeResolution || RightFrame->GetReadbackPixels().Num() == 0))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Stereo frame mismatch - skipping pair"));
+        return false;
+    }
+
+    const FIntPoint ImageResolution = RightFrame ? PanoramaCapture::Color::GetStereoResolution(EyeResolution, Job.Layout) : EyeResolution;
+    bool bEncoded = false;
+    switch (OutputFormat)
+    {
+    case EPanoramaOutputFormat::EXRSequence:
+        bEncoded = EncodeEXR(Job, Context, ImageResolution);
+        break;
+    case EPanoramaOutputFormat::IntermediateSequence:
+        bEncoded = EncodeIntermediate(Job, Context);
+        break;
+    default:
+        bEncoded = EncodePNG(Job, Context, ImageResolution);
+        break;
+    }
+    if (!bEncoded)
+    {
+        return false;
+    }
+
+    LeftFrame.Timings.ConvertedCycles = FPlatformTime::Cycles64();
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(Job.FilePath), true);
+    if (!FFileHelper::SaveArrayToFile(Context.FileBytes, *Job.FilePath))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to write sequence frame %s"), *Job.FilePath);
+        IFileManager::Get().Delete(*Job.FilePath, false, true, true);
+        return false;
+    }
+    LeftFrame.Timings.WrittenCycles = FPlatformTime::Cycles64();
+
+    LeftFrame.bIsStereo = RightFrame != nullptr;
+    LeftFrame.SetPersisted(Job.FilePath, ImageResolution);
+    return true;
+}
+
+bool FPanoramaImageEncodePool::EncodePNG(FJob& Job, FEncodeContext& Context, const FIntPoint& ImageResolution)
+{
+    FPanoramaFrame& LeftFrame = *Job.LeftFrame;
+    FPanoramaFrame* RightFrame = Job.RightFrame.Get();
+    const FIntPoint EyeResolution = LeftFrame.Resolution;
+
+    // Each eye is quantized straight into its region of the image, so a stereo pair is never packed as half floats.
+    TArrayView<uint16> RGBA16Pixels = Context.Scratch.AllocateArray<uint16>(ImageResolution.X * ImageResolution.Y * 4);
+    if (RGBA16Pixels.Num() == 0)
+    {
+        return false;
+    }
+
+    const int32 BytesPerPixel = 4 * sizeof(uint16);
+    const int64 NumBytes = static_cast<int64>(RGBA16Pixels.Num()) * sizeof(uint16);
+    FPanoramaFrame* Eyes[2] = { &LeftFrame, RightFrame };
+    for (int32 EyeIndex = 0; EyeIndex < 2 && Eyes[EyeIndex]; ++EyeIndex)
+    {
+        uint8* ImageData = reinterpret_cast<uint8*>(RGBA16Pixels.GetData());
+        PanoramaCapture::Color::FInterleavedDestination Destination;
+        if (RightFrame)
+        {
+            Destination = PanoramaCapture::Color::FInterleavedDestination::StereoEye(ImageData, NumBytes, EyeResolution, Job.Layout, EyeIndex, BytesPerPixel);
+        }
+        else
+        {
+            Destination.Data = ImageData;
+            Destination.NumBytes = NumBytes;
+            Destination.Pitch = ImageResolution.X * BytesPerPixel;
+        }
+        if (!PanoramaCapture::Color::ConvertLinearToRGBA16(Eyes[EyeIndex]->GetReadbackPixels(), EyeResolution, Destination))
+        {
+            return false;
+        }
+    }
+
+    // The quantized copy is all that is needed from here; the readback buffers can serve the next capture.
+    RecyclePayload(FramePool.Get(), LeftFrame);
+    if (RightFrame)
+    {
+        RecyclePayload(FramePool.Get(), *RightFrame);
+    }
+
+    // The native writer filters and deflates row bands of this one image across the task graph.
+    return Context.PNGWriter.EncodeRGBA16(RGBA16Pixels, ImageResolution, PNGOptions, Context.Scratch, Context.FileBytes);
+}
+
+bool FPanoramaImageEncodePool::EncodeEXR(FJob& Job, FEncodeContext& Context, const FIntPoint& ImageResolution)
+{
+    FPanoramaFrame& LeftFrame = *Job.LeftFrame;
+    FPanoramaFrame* RightFrame = Job.RightFrame.Get();
+    const FIntPoint EyeResolution = LeftFrame.Resolution;
+    if (LeftFrame.GetReadbackPixels().Num() < EyeResolution.X * EyeResolution.Y || (RightFrame && RightFrame->GetReadbackPixels().Num() < EyeResolution.X * EyeResolution.Y))
+    {
+        return false;
+    }
+
+    // A mono frame is encoded straight from its readback. A stereo pair is packed into one image first; that is a row
+    // copy per eye, with no per-pixel conversion.
+    const FFloat16Color* Pixels = LeftFrame.GetReadbackPixels().GetData();
+    if (RightFrame)
+    {
+        TArrayView<FFloat16Color> Packed = Context.Scratch.AllocateArray<FFloat16Color>(ImageResolution.X * ImageResolution.Y);
+        if (Packed.Num() == 0)
+        {
+            return false;
+        }
+
+        const int64 NumBytes = static_cast<int64>(Packed.Num()) * sizeof(FFloat16Color);
+        const int64 EyeRowBytes = static_cast<int64>(EyeResolution.X) * sizeof(FFloat16Color);
+        FPanoramaFrame* Eyes[2] = { &LeftFrame, RightFrame };
+        for (int32 EyeIndex = 0; EyeIndex < 2; ++EyeIndex)
+        {
+            const PanoramaCapture::Color::FInterleavedDestination Destination = PanoramaCapture::Color::FInterleavedDestination::StereoEye(
+                reinterpret_cast<uint8*>(Packed.GetData()), NumBytes, EyeResolution, Job.Layout, EyeIndex, sizeof(FFloat16Color));
+            const uint8* Source = reinterpret_cast<const uint8*>(Eyes[EyeIndex]->GetReadbackPixels().GetData());
+            for (int32 Row = 0; Row < EyeResolution.Y; ++Row)
+            {
+                FMemory::Memcpy(Destination.Data + Destination.Offset + Destination.Pitch * Row, Source + EyeRowBytes * Row, EyeRowBytes);
+            }
+        }
+
+        RecyclePayload(FramePool.Get(), LeftFrame);
+        RecyclePayload(FramePool.Get(), *RightFrame);
+        Pixels = Packed.GetData();
+    }
+
+    const bool bEncoded = PanoramaCapture::EXR::EncodeRGBAHalf(Pixels, ImageResolution, EXRCompression, Context.FileBytes);
+    if (!RightFrame)
+    {
+        RecyclePayload(FramePool.Get(), LeftFrame);
+    }
+    return bEncoded;
+}
+
+bool FPanoramaImageEncodePool::EncodeIntermediate(FJob& Job, FEncodeContext& Context)
+{
+    FPanoramaFrame& LeftFrame = *Job.LeftFrame;
+    FPanoramaFrame* RightFrame = Job.RightFrame.Get();
+
+    // Stereo eyes are read in place and interleaved into the packed layout row by row as they are filtered.
+    const TArray<FFloat16Color>& LeftPixels = LeftFrame.GetReadbackPixels();
+    const TArrayView<const FFloat16Color> RightPixels = RightFrame ? TArrayView<const FFloat16Color>(RightFrame->GetReadbackPixels()) : TArrayView<const FFloat16Color>();
+    const bool bEncoded = PanoramaCapture::Intermediate::EncodeFrame(LeftPixels, RightPixels, LeftFrame.Resolution, Job.Layout, Context.Scratch, Context.FileBytes);
+
+    RecyclePayload(FramePool.Get(), LeftFrame);
+    if (RightFrame)
+    {
+        RecyclePayload(FramePool.Get(), *RightFrame);
+    }
+    return bEncoded;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PanoramaCaptureTypes.h"
+#include "PanoramaCaptureScratchArena.h"
+#include "PanoramaCapturePNGWriter.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Atomic.h"
+
+struct FPanoramaFrame;
+class FPanoramaFramePool;
+class FQueuedThreadPool;
+class FEvent;
+
+/**
+ * Encodes PNG or EXR sequence frames on a pool of worker threads. The thread that drains the frame queue submits each
+ * frame (or stereo pair) with its file path, workers encode and write it concurrently, and DrainCompleted
+ * hands finished frames back in submission order, so the muxer sees them in capture order no matter which worker
+ * finishes first. Jobs in flight are bounded by the worker count and, when given, by a byte allowance covering their
+ * readbacks and each worker's scratch and file buffers. Submit, drain and wait are called from the draining thread only.
+ */
+class FPanoramaImageEncodePool
+{
+public:
+    FPanoramaImageEncodePool();
+    ~FPanoramaImageEncodePool();
+
+    /**
+     * Starts up to NumWorkers encoder threads that write every frame in the output format of Settings, which must be an
+     * image sequence. The worker and job counts are lowered until the estimated memory of every job in flight fits
+     * MaxInFlightBytes, or a quarter of physical memory when it is not positive, keeping at least one. When the threads
+     * cannot be created, jobs run inline on the submitting thread.
+     */
+    void Start(int32 NumWorkers, const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool, const FPanoramicVideoSettings& Settings, int64 MaxInFlightBytes = 0);
+
+    /** Finishes every submitted job and stops the threads. Results not drained yet are released. */
+    void Stop();
+
+    /** Called on a worker thread after each job completes, e.g. to wake the draining thread. May be empty. */
+    void SetOnJobCompleted(TFunction<void()> InOnJobCompleted);
+
+    /** True when another job fits under the in-flight limit. */
+    bool CanSubmit() const;
+
+    /**
+     * Queues LeftFrame (plus RightFrame for a stereo pair, packed in Layout) to be written to FilePath. On success the
+     * left frame comes back persisted; the readback payloads go back to the frame pool as soon as they are no longer read.
+     */
+    void Submit(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame, EPanoramaStereoLayout Layout, const FString& FilePath);
+
+    /** Visits finished jobs in submission order, stopping at the first one still running. Returns the number visited. */
+    int32 DrainCompleted(TFunctionRef<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame, bool bSuccess)> Visitor);
+
+    /** Blocks until the oldest job in flight has finished. */
+    void WaitForOldest();
+
+    int32 GetNumInFlight() const { return static_cast<int32>(NextSubmitIndex - NextDrainIndex); }
+    int32 GetNumWorkers() const { return NumWorkers; }
+
+    /** Jobs that can be in flight at once; zero until Start. */
+    int32 GetNumSlots() const { return Jobs.Num(); }
+
+    /** Estimated peak memory of the jobs in flight and the worker buffers they use; zero until Start. */
+    int64 GetReservedBytes() const { return ReservedBytes; }
+
+private:
+    class FJob;
+
+    /** Per-worker state, handed to whichever thread runs a job so at most one context exists per worker. */
+    struct FEncodeContext
+    {
+        FPanoramaScratchArena Scratch;
+        FPanoramaPNGWriter PNGWriter;
+
+        /** Encoded file, reused so steady-state frames do not reallocate it. */
+        TArray64<uint8> FileBytes;
+    };
+
+    void Execute(FJob& Job);
+    bool Encode(FJob& Job, FEncodeContext& Context);
+    bool EncodePNG(FJob& Job, FEncodeContext& Context, const FIntPoint& ImageResolution);
+    bool EncodeEXR(FJob& Job, FEncodeContext& Context, const FIntPoint& ImageResolution);
+    bool EncodeIntermediate(FJob& Job, FEncodeContext& Context);
+
+    FQueuedThreadPool* ThreadPool = nullptr;
+    TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe> FramePool;
+    EPanoramaOutputFormat OutputFormat = EPanoramaOutputFormat::PNGSequence;
+    FPanoramaPNGWriteOptions PNGOptions;
+    EPanoramaEXRCompression EXRCompression = EPanoramaEXRCompression::PIZ;
+
+    /** OpenEXR global pool size before Start resized it, restored by Stop; INDEX_NONE when untouched. */
+    int32 PreviousEXRThreads = INDEX_NONE;
+    int32 NumWorkers = 0;
+    int64 ReservedBytes = 0;
+
+    /** Ring of job slots indexed by submission index; a slot is reused once its job has been drained. */
+    TArray<TUniquePtr<FJob>> Jobs;
+    uint64 NextSubmitIndex = 0;
+    uint64 NextDrainIndex = 0;
+
+    /** Triggered after every job completes. */
+    FEvent* CompletionEvent = nullptr;
+
+    /** Guards IdleContexts and OnJobCompleted. */
+    FCriticalSection CriticalSection;
+    TArray<TUniquePtr<FEncodeContext>> IdleContexts;
+    TFunction<void()> OnJobCompleted;
+};
@@ -0,0 +1,290 @@
+#include "PanoramaCaptureIntermediate.h"
+#include "PanoramaCaptureScratchArena.h"
+#include "PanoramaCaptureColorConversion.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+#include "Templates/Atomic.h"
+
+namespace
+{
+    /** "PCIF", little endian. */
+    static constexpr uint32 GMagic = 0x46494350;
+    static constexpr uint16 GVersion = 1;
+
+    /** Rows per independently compressed band: about 2 MB of an 8K frame, enough bands to keep every core busy. */
+    static constexpr int32 GBandRows = 32;
+
+    static constexpr int32 GChannels = 4;
+    static constexpr int32 GPlanes = GChannels * 2;
+
+    static_assert(PLATFORM_LITTLE_ENDIAN, "Intermediate files are written in native little-endian order");
+    static_assert(sizeof(FFloat16Color) == GChannels * sizeof(uint16), "FFloat16Color must be four packed halves");
+
+    struct FFileHeader
+    {
+        uint32 Magic = GMagic;
+        uint16 Version = GVersion;
+        /** Reserved for other band codecs; zero is LZ4. */
+        uint16 Codec = 0;
+        uint32 Width = 0;
+        uint32 Height = 0;
+        uint32 BandRows = GBandRows;
+        uint32 NumBands = 0;
+    };
+
+    /**
+     * Row Y of the packed image as up to two runs of pixels: a side-by-side stereo row continues from the left eye into
+     * the right eye, every other row is a single run.
+     */
+    struct FFrameSource
+    {
+        const FFloat16Color* Eyes[2] = { nullptr, nullptr };
+        FIntPoint EyeResolution = FIntPoint::ZeroValue;
+        EPanoramaStereoLayout Layout = EPanoramaStereoLayout::TopBottom;
+
+        int32 GetRuns(int32 Y, const FFloat16Color* OutRuns[2]) const
+        {
+            const int64 EyeWidth = EyeResolution.X;
+            if (!Eyes[1])
+            {
+                OutRuns[0] = Eyes[0] + Y * EyeWidth;
+                return 1;
+            }
+            if (Layout == EPanoramaStereoLayout::SideBySide)
+            {
+                OutRuns[0] = Eyes[0] + Y * EyeWidth;
+                OutRuns[1] = Eyes[1] + Y * EyeWidth;
+                return 2;
+            }
+            const int32 EyeIndex = Y < EyeResolution.Y ? 0 : 1;
+            OutRuns[0] = Eyes[EyeIndex] + (Y - EyeIndex * EyeResolution.Y) * EyeWidth;
+            return 1;
+        }
+    };
+
+    bool ParseHeader(TArrayView64<const uint8> File, FFileHeader& OutHeader)
+    {
+        if (File.Num() < static_cast<int64>(sizeof(FFileHeader)))
+        {
+            return false;
+        }
+        FMemory::Memcpy(&OutHeader, File.GetData(), sizeof(FFileHeader));
+
+        // The decoded frame is indexed with int32 down to its 16-bit samples, and bands always have the writer's
+        // height, so a corrupt header is rejected here instead of overflowing the allocations sized from it.
+        return OutHeader.Magic == GMagic
+            && OutHeader.Version == GVersion
+            && OutHeader.Codec == 0
+            && OutHeader.Width > 0 && OutHeader.Width <= 65536
+            && OutHeader.Height > 0 && OutHeader.Height <= 65536
+            && static_cast<int64>(OutHeader.Width) * OutHeader.Height * GChannels <= MAX_int32
+            && OutHeader.BandRows == GBandRows
+            && OutHeader.NumBands == FMath::DivideAndRoundUp(OutHeader.Height, OutHeader.BandRows);
+    }
+}
+
+namespace PanoramaCapture
+{
+namespace Intermediate
+{
+const TCHAR* GetFileExtension()
+{
+    return TEXT("pcif");
+}
+
+bool EncodeFrame(TArrayView<const FFloat16Color> LeftPixels, TArrayView<const FFloat16Color> RightPixels, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, FPanoramaScratchArena& Scratch, TArray64<uint8>& OutFile)
+{
+    const int64 EyePixels = static_cast<int64>(EyeResolution.X) * EyeResolution.Y;
+    const bool bStereo = RightPixels.Num() > 0;
+    if (EyePixels <= 0 || LeftPixels.Num() < EyePixels || (bStereo && RightPixels.Num() < EyePixels))
+    {
+        return false;
+    }
+
+    FFrameSource Source;
+    Source.Eyes[0] = LeftPixels.GetData();
+    Source.Eyes[1] = bStereo ? RightPixels.GetData() : nullptr;
+    Source.EyeResolution = EyeResolution;
+    Source.Layout = Layout;
+
+    const FIntPoint Resolution = bStereo ? PanoramaCapture::Color::GetStereoResolution(EyeResolution, Layout) : EyeResolution;
+    if (static_cast<int64>(Resolution.X) * Resolution.Y * GChannels > MAX_int32)
+    {
+        // The reader could not index the frame.
+        return false;
+    }
+    const int32 Width = Resolution.X;
+    const int32 RunWidth = (bStereo && Layout == EPanoramaStereoLayout::SideBySide) ? EyeResolution.X : Width;
+    const int32 NumBands = FMath::DivideAndRoundUp(Resolution.Y, GBandRows);
+    const int32 MaxBandBytes = Width * GBandRows * static_cast<int32>(sizeof(FFloat16Color));
+    const int32 MaxCompressedBytes = FCompression::CompressMemoryBound(NAME_LZ4, MaxBandBytes);
+
+    // Carved out up front because the arena belongs to the calling thread; bands only write to their own slices.
+    uint8* Filtered = static_cast<uint8*>(Scratch.Allocate(static_cast<int64>(MaxBandBytes) * NumBands));
+    uint8* Compressed = static_cast<uint8*>(Scratch.Allocate(static_cast<int64>(MaxCompressedBytes) * NumBands));
+    TArrayView<int32> BandSizes = Scratch.AllocateArray<int32>(NumBands);
+    if (!Filtered || !Compressed || BandSizes.Num() != NumBands)
+    {
+        return false;
+    }
+
+    ParallelFor(NumBands, [&](int32 BandIndex)
+    {
+        const int32 FirstRow = BandIndex * GBandRows;
+        const int32 NumRows = FMath::Min(GBandRows, Resolution.Y - FirstRow);
+        const int64 PlaneBytes = static_cast<int64>(NumRows) * Width;
+        uint8* Planes = Filtered + static_cast<int64>(MaxBandBytes) * BandIndex;
+
+        // Neighbouring half floats share sign and exponent, so the high-byte planes of the deltas are mostly zero.
+        for (int32 Row = 0; Row < NumRows; ++Row)
+        {
+            const FFloat16Color* Runs[2];
+            const int32 NumRuns = Source.GetRuns(FirstRow + Row, Runs);
+            uint16 Previous[GChannels] = {};
+            int64 Index = static_cast<int64>(Row) * Width;
+            for (int32 RunIndex = 0; RunIndex < NumRuns; ++RunIndex)
+            {
+                const uint16* Samples = reinterpret_cast<const uint16*>(Runs[RunIndex]);
+                for (int32 X = 0; X < RunWidth; ++X, ++Index)
+                {
+                    for (int32 Channel = 0; Channel < GChannels; ++Channel)
+                    {
+                        const uint16 Sample = Samples[X * GChannels + Channel];
+                        const uint16 Delta = static_cast<uint16>(Sample - Previous[Channel]);
+                        Previous[Channel] = Sample;
+                        Planes[PlaneBytes * (Channel * 2) + Index] = static_cast<uint8>(Delta >> 8);
+                        Planes[PlaneBytes * (Channel * 2 + 1) + Index] = static_cast<uint8>(Delta);
+                    }
+                }
+            }
+        }
+
+        // A band that does not shrink is stored; its size equals the raw size, which a compressed band never reaches.
+        const int32 RawBytes = static_cast<int32>(PlaneBytes * GPlanes);
+        uint8* Output = Compressed + static_cast<int64>(MaxCompressedBytes) * BandIndex;
+        int32 CompressedBytes = MaxCompressedBytes;
+        if (!FCompression::CompressMemory(NAME_LZ4, Output, CompressedBytes, Planes, RawBytes, COMPRESS_BiasSpeed) || CompressedBytes >= RawBytes)
+        {
+            FMemory::Memcpy(Output, Planes, RawBytes);
+            CompressedBytes = RawBytes;
+        }
+        BandSizes[BandIndex] = CompressedBytes;
+    });
+
+    FFileHeader Header;
+    Header.Width = static_cast<uint32>(Width);
+    Header.Height = static_cast<uint32>(Resolution.Y);
+    Header.NumBands = static_cast<uint32>(NumBands);
+
+    int64 TotalBytes = sizeof(FFileHeader) + static_cast<int64>(NumBands) * sizeof(uint32);
+    for (int32 BandSize : BandSizes)
+    {
+        TotalBytes += BandSize;
+    }
+
+    OutFile.SetNumUninitialized(TotalBytes, EAllowShrinking::No);
+    uint8* Cursor = OutFile.GetData();
+    FMemory::Memcpy(Cursor, &Header, sizeof(FFileHeader));
+    Cursor += sizeof(FFileHeader);
+    for (int32 BandSize : BandSizes)
+    {
+        const uint32 Size = static_cast<uint32>(BandSize);
+        FMemory::Memcpy(Cursor, &Size, sizeof(uint32));
+        Cursor += sizeof(uint32);
+    }
+    for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+    {
+        FMemory::Memcpy(Cursor, Compressed + static_cast<int64>(MaxCompressedBytes) * BandIndex, BandSizes[BandIndex]);
+        Cursor += BandSizes[BandIndex];
+    }
+    return true;
+}
+
+bool DecodeFrame(TArrayView64<const uint8> File, TArray<FFloat16Color>& OutPixels, FIntPoint& OutResolution)
+{
+    FFileHeader Header;
+    if (!ParseHeader(File, Header))
+    {
+        return false;
+    }
+
+    const int32 Width = static_cast<int32>(Header.Width);
+    const int32 Height = static_cast<int32>(Header.Height);
+    const int32 BandRows = static_cast<int32>(Header.BandRows);
+    const int32 NumBands = static_cast<int32>(Header.NumBands);
+    const int64 TableOffset = sizeof(FFileHeader);
+    if (File.Num() < TableOffset + static_cast<int64>(NumBands) * sizeof(uint32))
+    {
+        return false;
+    }
+
+    // Band offsets come from the size table, so every band can be located before any is decoded.
+    TArray<int64> BandOffsets;
+    BandOffsets.SetNumUninitialized(NumBands + 1);
+    BandOffsets[0] = TableOffset + static_cast<int64>(NumBands) * sizeof(uint32);
+    for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+    {
+        uint32 Size = 0;
+        FMemory::Memcpy(&Size, File.GetData() + TableOffset + BandIndex * sizeof(uint32), sizeof(uint32));
+
+        // A band is never stored larger than its raw planes.
+        if (Size > static_cast<uint32>(BandRows * Width * sizeof(FFloat16Color)))
+        {
+            return false;
+        }
+        BandOffsets[BandIndex + 1] = BandOffsets[BandIndex] + Size;
+    }
+    if (BandOffsets[NumBands] > File.Num())
+    {
+        return false;
+    }
+
+    OutPixels.SetNumUninitialized(Width * Height, EAllowShrinking::No);
+    uint16* Samples = reinterpret_cast<uint16*>(OutPixels.GetData());
+    TAtomic<bool> bFailed{ false };
+    ParallelFor(NumBands, [&](int32 BandIndex)
+    {
+        const int32 FirstRow = BandIndex * BandRows;
+        const int32 NumRows = FMath::Min(BandRows, Height - FirstRow);
+        const int64 PlaneBytes = static_cast<int64>(NumRows) * Width;
+        const int32 RawBytes = static_cast<int32>(PlaneBytes * GPlanes);
+        const uint8* Payload = File.GetData() + BandOffsets[BandIndex];
+        const int32 PayloadBytes = static_cast<int32>(BandOffsets[BandIndex + 1] - BandOffsets[BandIndex]);
+
+        // Each task decompresses into a buffer of its own; the reader's memory is not on the capture's hot path.
+        TArray<uint8> Planes;
+        const uint8* PlaneData = Payload;
+        if (PayloadBytes != RawBytes)
+        {
+            Planes.SetNumUninitialized(RawBytes);
+            if (!FCompression::UncompressMemory(NAME_LZ4, Planes.GetData(), RawBytes, Payload, PayloadBytes))
+            {
+                bFailed = true;
+                return;
+            }
+            PlaneData = Planes.GetData();
+        }
+
+        for (int32 Row = 0; Row < NumRows; ++Row)
+        {
+            uint16 Previous[GChannels] = {};
+            uint16* RowSamples = Samples + (static_cast<int64>(FirstRow) + Row) * Width * GChannels;
+            const int64 RowIndex = static_cast<int64>(Row) * Width;
+            for (int32 X = 0; X < Width; ++X)
+            {
+                for (int32 Channel = 0; Channel < GChannels; ++Channel)
+                {
+                    const uint16 High = PlaneData[PlaneBytes * (Channel * 2) + RowIndex + X];
+                    const uint16 Low = PlaneData[PlaneBytes * (Channel * 2 + 1) + RowIndex + X];
+                    Previous[Channel] = static_cast<uint16>(Previous[Channel] + ((High << 8) | Low));
+                    RowSamples[X * GChannels + Channel] = Previous[Channel];
+                }
+            }
+        }
+    });
+
+    OutResolution = FIntPoint(Width, Height);
+    return !bFailed;
+}
+}
+}
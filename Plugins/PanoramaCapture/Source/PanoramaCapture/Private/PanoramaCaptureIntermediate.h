@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PanoramaCaptureTypes.h"
+#include "Math/Float16Color.h"
+
+class FPanoramaScratchArena;
+
+namespace PanoramaCapture
+{
+namespace Intermediate
+{
+    /** File extension of intermediate frames, without the dot. */
+    const TCHAR* GetFileExtension();
+
+    /**
+     * Encodes a frame, or a stereo pair packed in Layout, as a lossless intermediate file in OutFile (reused across
+     * calls). The half-float bit patterns are delta coded against the pixel to their left, split into high and low
+     * byte planes per channel and LZ4 compressed in independent row bands on task graph workers.
+     */
+    bool EncodeFrame(TArrayView<const FFloat16Color> LeftPixels, TArrayView<const FFloat16Color> RightPixels, const FIntPoint& EyeResolution, EPanoramaStereoLayout Layout, FPanoramaScratchArena& Scratch, TArray64<uint8>& OutFile);
+
+    /** Decodes an intermediate file back into the exact half-float pixels it was written from, bands in parallel. */
+    bool DecodeFrame(TArrayView64<const uint8> File, TArray<FFloat16Color>& OutPixels, FIntPoint& OutResolution);
+}
+}
@@ -0,0 +1,139 @@
+#include "PanoramaCaptureLatency.h"
+#include "PanoramaCaptureFrame.h"
+#include "HAL/PlatformTime.h"
+
+namespace
+{
+    float MicrosecondsToMilliseconds(uint64 Microseconds)
+    {
+        return static_cast<float>(static_cast<double>(Microseconds) / 1000.0);
+    }
+
+    /** Records End - Start when both stamps are set and in order. */
+    void RecordInterval(FPanoramaLatencyHistogram& Histogram, uint64 StartCycles, uint64 EndCycles)
+    {
+        if (StartCycles == 0 || EndCycles < StartCycles)
+        {
+            return;
+        }
+
+        const double Microseconds = FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1000000.0;
+        Histogram.Record(static_cast<uint64>(Microseconds));
+    }
+}
+
+FPanoramaLatencyHistogram::FPanoramaLatencyHistogram()
+{
+    Reset();
+}
+
+int32 FPanoramaLatencyHistogram::GetBucketIndex(uint64 Microseconds)
+{
+    if (Microseconds < 2 * SubBucketCount)
+    {
+        return static_cast<int32>(Microseconds);
+    }
+
+    const uint64 Largest = (uint64(1) << (MaxExponent + SubBucketBits + 1)) - 1;
+    Microseconds = FMath::Min(Microseconds, Largest);
+
+    const int32 Exponent = static_cast<int32>(FPlatformMath::FloorLog2_64(Microseconds)) - SubBucketBits;
+    const int32 Mantissa = static_cast<int32>(Microseconds >> Exponent);
+    return Exponent * SubBucketCount + Mantissa;
+}
+
+uint64 FPanoramaLatencyHistogram::GetBucketUpperBound(int32 Index)
+{
+    if (Index < 2 * SubBucketCount)
+    {
+        return static_cast<uint64>(Index);
+    }
+
+    const int32 Exponent = Index / SubBucketCount - 1;
+    const uint64 Mantissa = static_cast<uint64>(Index - Exponent * SubBucketCount);
+    return ((Mantissa + 1) << Exponent) - 1;
+}
+
+void FPanoramaLatencyHistogram::Record(uint64 Microseconds)
+{
+    Buckets[GetBucketIndex(Microseconds)].AddExchange(1);
+
+    uint64 CurrentMax = MaxMicroseconds.Load(EMemoryOrder::Relaxed);
+    while (Microseconds > CurrentMax && !MaxMicroseconds.CompareExchange(CurrentMax, Microseconds))
+    {
+    }
+}
+
+void FPanoramaLatencyHistogram::Reset()
+{
+    for (TAtomic<uint32>& Bucket : Buckets)
+    {
+        Bucket.Store(0, EMemoryOrder::Relaxed);
+    }
+    MaxMicroseconds.Store(0, EMemoryOrder::Relaxed);
+}
+
+FPanoramaLatencyStats FPanoramaLatencyHistogram::GetStats() const
+{
+    uint32 Counts[NumBuckets];
+    uint64 Total = 0;
+    for (int32 Index = 0; Index < NumBuckets; ++Index)
+    {
+        Counts[Index] = Buckets[Index].Load(EMemoryOrder::Relaxed);
+        Total += Counts[Index];
+    }
+
+    FPanoramaLatencyStats Stats;
+    if (Total == 0)
+    {
+        return Stats;
+    }
+
+    const uint64 Max = MaxMicroseconds.Load(EMemoryOrder::Relaxed);
+    const double Percentiles[] = { 0.50, 0.95, 0.99 };
+    float* Outputs[] = { &Stats.P50Ms, &Stats.P95Ms, &Stats.P99Ms };
+    constexpr int32 NumPercentiles = UE_ARRAY_COUNT(Percentiles);
+
+    int32 PercentileIndex = 0;
+    uint64 Cumulative = 0;
+    for (int32 Index = 0; Index < NumBuckets && PercentileIndex < NumPercentiles; ++Index)
+    {
+        Cumulative += Counts[Index];
+        while (PercentileIndex < NumPercentiles && Cumulative >= static_cast<uint64>(FMath::CeilToDouble(Percentiles[PercentileIndex] * Total)))
+        {
+            *Outputs[PercentileIndex] = MicrosecondsToMilliseconds(FMath::Min(GetBucketUpperBound(Index), Max));
+            ++PercentileIndex;
+        }
+    }
+
+    Stats.MaxMs = MicrosecondsToMilliseconds(Max);
+    Stats.SampleCount = static_cast<int32>(FMath::Min<uint64>(Total, MAX_int32));
+    return Stats;
+}
+
+void FPanoramaLatencyTracker::RecordFrame(const FPanoramaFrameTimings& Timings)
+{
+    RecordInterval(Submit, Timings.ReadbackCycles, Timings.EnqueueCycles);
+    RecordInterval(Queue, Timings.EnqueueCycles, Timings.DequeueCycles);
+    RecordInterval(Conversion, Timings.DequeueCycles, Timings.ConvertedCycles);
+    RecordInterval(Write, Timings.ConvertedCycles, Timings.WrittenCycles);
+    RecordInterval(EndToEnd, Timings.ReadbackCycles, Timings.WrittenCycles);
+}
+
+void FPanoramaLatencyTracker::Reset()
+{
+    Submit.Reset();
+    Queue.Reset();
+    Conversion.Reset();
+    Write.Reset();
+    EndToEnd.Reset();
+}
+
+void FPanoramaLatencyTracker::FillStatus(FPanoramicCaptureStatus& Status) const
+{
+    Status.SubmitLatency = Submit.GetStats();
+    Status.QueueLatency = Queue.GetStats();
+    Status.ConversionLatency = Conversion.GetStats();
+    Status.WriteLatency = Write.GetStats();
+    Status.EndToEndLatency = EndToEnd.GetStats();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PanoramaCaptureTypes.h"
+#include "Templates/Atomic.h"
+
+struct FPanoramaFrameTimings;
+
+/**
+ * HDR-style log-linear latency histogram in microseconds. Values below 32 get exact buckets; above that each power of
+ * two is split into 16 sub-buckets, so percentiles are accurate to about 6% from 1 us up to days. Record is lock free
+ * and wait free apart from the max update, so the render thread and the frame worker can record concurrently while
+ * the status thread takes snapshots.
+ */
+class FPanoramaLatencyHistogram
+{
+public:
+    FPanoramaLatencyHistogram();
+
+    void Record(uint64 Microseconds);
+
+    /** Not atomic with respect to concurrent Record calls; call while no stage is recording. */
+    void Reset();
+
+    /** Percentiles of everything recorded since the last Reset. Samples recorded during the scan may be missed. */
+    FPanoramaLatencyStats GetStats() const;
+
+private:
+    static constexpr int32 SubBucketBits = 4;
+    static constexpr int32 SubBucketCount = 1 << SubBucketBits;
+    static constexpr int32 MaxExponent = 36;
+    static constexpr int32 NumBuckets = (MaxExponent + 2) * SubBucketCount;
+
+    static int32 GetBucketIndex(uint64 Microseconds);
+
+    /** Largest value that maps to the bucket, as HdrHistogram's highestEquivalentValue. */
+    static uint64 GetBucketUpperBound(int32 Index);
+
+    TAtomic<uint32> Buckets[NumBuckets];
+    TAtomic<uint64> MaxMicroseconds;
+};
+
+/** One histogram per pipeline stage, fed from the FPanoramaFrameTimings of every written frame. */
+class FPanoramaLatencyTracker
+{
+public:
+    /** Records each stage whose start and end stamps are both set. */
+    void RecordFrame(const FPanoramaFrameTimings& Timings);
+
+    void Reset();
+
+    /** Copies the per-stage percentiles into the status. */
+    void FillStatus(FPanoramicCaptureStatus& Status) const;
+
+private:
+    FPanoramaLatencyHistogram Submit;
+    FPanoramaLatencyHistogram Queue;
+    FPanoramaLatencyHistogram Conversion;
+    FPanoramaLatencyHistogram Write;
+    FPanoramaLatencyHistogram EndToEnd;
+};
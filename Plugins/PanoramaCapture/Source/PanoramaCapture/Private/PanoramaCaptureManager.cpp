@@ -4,10 +4,18 @@
 #include "PanoramaCaptureAudio.h"
 #include "PanoramaCaptureFFmpeg.h"
 #include "PanoramaCaptureNVENC.h"
+#include "PanoramaCaptureColorConversion.h"
 #include "PanoramaCaptureFrame.h"
+#include "PanoramaCaptureFramePool.h"
+#include "PanoramaCaptureSpillFile.h"
+#include "PanoramaCaptureLatency.h"
+#include "PanoramaCaptureImageEncoder.h"
+#include "PanoramaCaptureEXRWriter.h"
+#include "PanoramaCaptureIntermediate.h"
 #include "PanoramaCaptureLog.h"
 #include "Async/Async.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "Misc/App.h"
 #include "Misc/Paths.h"
 #include "Misc/FileHelper.h"
 #include "HAL/FileManager.h"
@@ -19,12 +27,43 @@
 #include "HAL/PlatformTime.h"
 #include "HAL/ThreadSafeCounter.h"
 #include "Modules/ModuleManager.h"
-#include "IImageWrapper.h"
-#include "IImageWrapperModule.h"
+#include "RenderingThread.h"
 
 namespace
 {
     static constexpr TCHAR const* GFrameSubdirectory = TEXT("Frames");
+    /** Muxed sequence files, numbered without gaps as ffmpeg's image2 input expects. */
+    static constexpr TCHAR const* GFramePrefix = TEXT("Frame");
+    /** Encoders write under this name and the drain renames each written file to the next GFramePrefix index. */
+    static constexpr TCHAR const* GPendingFramePrefix = TEXT("Pending");
+    static constexpr TCHAR const* GSpillFileName = TEXT("FrameQueueSpill.bin");
+
+    /** Idle buffer allowance of the frame pool when the queue is bounded by frame count rather than by memory. */
+    static constexpr int64 GDefaultFramePoolIdleBytes = 1024ll * 1024ll * 1024ll;
+
+    /** Frames drained from the queue per batch; status is published once per batch. */
+    static constexpr int32 GFrameBatchSize = 4;
+
+    /** Longest single wait of a blocked render thread before it re-checks the timeout and shutdown. */
+    static constexpr uint32 GBackpressureWaitSliceMs = 10;
+
+    /** Share of the memory budget image sequence encoders may hold in flight; the queue keeps the rest. */
+    static constexpr int64 GSequenceEncoderBudgetDivisor = 2;
+
+    int64 GetQueueBudgetBytes(const FPanoramicVideoSettings& Settings)
+    {
+        return Settings.FrameQueueMode == EPanoramaFrameQueueMode::MemoryBudget ? static_cast<int64>(FMath::Max(1, Settings.FrameQueueBudgetMB)) * 1024 * 1024 : 0;
+    }
+
+    /** Auto blocks fixed-timestep renders, which must not lose frames, and drops frames of live previews. */
+    EPanoramaBackpressurePolicy ResolveAutoBackpressurePolicy(EPanoramaBackpressurePolicy Policy)
+    {
+        if (Policy == EPanoramaBackpressurePolicy::Auto)
+        {
+            return FApp::UseFixedTimeStep() ? EPanoramaBackpressurePolicy::BlockProducer : EPanoramaBackpressurePolicy::DropNewest;
+        }
+        return Policy;
+    }
 }
 
 class FPanoramaCaptureManager::FFrameProcessor : public FRunnable
@@ -83,18 +122,33 @@ FPanoramaCaptureManager::FPanoramaCaptureManager()
     , bCaptureRequested(false)
     , bCaptureActive(false)
     , CaptureStartTimeSeconds(0.0)
+    , ActiveBackpressurePolicy(EPanoramaBackpressurePolicy::DropNewest)
+    , QueueSpaceEvent(FPlatformProcess::GetSynchEventFromPool(false))
+    , bProducerWaitingForSpace(false)
+    , bBlockingEnqueueAllowed(false)
     , FrameCounter(0)
+    , PendingSequenceIndex(0)
+    , PendingVideoPTS(0.0)
+    , bHasPendingVideoPTS(false)
     , PreviewFrameIntervalSeconds(1.0f / 30.0f)
     , LastPreviewUpdateSeconds(0.0)
     , bPreviewEnabled(true)
     , bHasFallenBack(false)
 {
+    LatencyTracker = MakeUnique<FPanoramaLatencyTracker>();
+    SequenceEncoder = MakeUnique<FPanoramaImageEncodePool>();
     ResetStatus();
 }
 
 FPanoramaCaptureManager::~FPanoramaCaptureManager()
 {
     Shutdown();
+
+    if (QueueSpaceEvent)
+    {
+        FPlatformProcess::ReturnSynchEventToPool(QueueSpaceEvent);
+        QueueSpaceEvent = nullptr;
+    }
 }
 
 void FPanoramaCaptureManager::Initialize(UPanoramaCaptureComponent* InOwnerComponent, const FPanoramicVideoSettings& VideoSettings, const FPanoramicAudioSettings& AudioSettings, const FString& OutputDirectory)
@@ -109,14 +163,20 @@ void FPanoramaCaptureManager::Initialize(UPanoramaCaptureComponent* InOwnerCompo
     TargetOutputDirectory = OutputDirectory.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PanoramaCaptures")) : OutputDirectory;
     OwnerComponent = InOwnerComponent;
 
+    FrameQueue.Configure(CurrentVideoSettings.MaxQueuedFrames, GetQueueBudgetBytes(CurrentVideoSettings));
+
+    FramePool = MakeShared<FPanoramaFramePool, ESPMode::ThreadSafe>();
+
     Renderer = MakeUnique<FPanoramaCaptureRenderer>();
     Renderer->Initialize();
+    Renderer->SetFramePool(FramePool);
 
     AudioRecorder = MakeUnique<FPanoramaAudioRecorder>();
     AudioRecorder->Initialize(CurrentAudioSettings, TargetOutputDirectory, InOwnerComponent ? InOwnerComponent->GetWorld() : nullptr);
 
     VideoEncoder = MakeUnique<FPanoramaNVENCEncoder>();
     VideoEncoder->Initialize(CurrentVideoSettings, TargetOutputDirectory);
+    VideoEncoder->SetFramePool(FramePool);
 
     Muxer = MakeUnique<FPanoramaFFmpegMuxer>();
     Muxer->Initialize(TargetOutputDirectory);
@@ -155,6 +215,9 @@ void FPanoramaCaptureManager::Shutdown()
     }
 
     FrameQueue.Reset();
+    CloseSpillFile();
+    FramePool.Reset();
+    SequenceEncoder->Stop();
     bInitialized = false;
 }
 
@@ -178,16 +241,43 @@ void FPanoramaCaptureManager::StartCapture()
     bCaptureRequested = true;
     bCaptureActive = true;
     FrameCounter = 0;
+    PendingSequenceIndex = 0;
     PendingLeftFrame.Reset();
-    PendingNVENCLeftFrame.Reset();
-    FrameQueue.Reset();
+    ConfigureFrameQueueForCapture();
+    if (IsImageSequenceOutput())
+    {
+        // Leave a core each for the game and render threads by default. Frames held by the encoders left the queue, so
+        // they are charged to its budget: the encoders may reserve up to half of it and the queue admits the rest.
+        const int32 NumEncoders = CurrentVideoSettings.SequenceEncodeWorkers > 0 ? CurrentVideoSettings.SequenceEncodeWorkers : FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 2);
+        const int64 SessionBudgetBytes = FrameQueue.GetMaxBytes();
+        SequenceEncoder->Start(NumEncoders, FramePool, CurrentVideoSettings, SessionBudgetBytes / GSequenceEncoderBudgetDivisor);
+        if (SessionBudgetBytes > 0)
+        {
+            FrameQueue.Configure(FrameQueue.GetCapacity(), FMath::Max<int64>(1, SessionBudgetBytes - SequenceEncoder->GetReservedBytes()));
+        }
+    }
+    if (FramePool)
+    {
+        // Sized after preflight, which may have switched the output format. Idle payload buffers may use a quarter
+        // of the queue budget on top of it.
+        const int64 QueueBudgetBytes = FrameQueue.GetMaxBytes();
+        FramePool->Configure(CurrentVideoSettings, FrameQueue.GetCapacity(), QueueBudgetBytes > 0 ? QueueBudgetBytes / 4 : GDefaultFramePoolIdleBytes);
+    }
     CaptureStartTimeSeconds = FPlatformTime::Seconds();
+    LatencyTracker->Reset();
     ResetStatus();
     if (Muxer)
     {
         Muxer->Configure(CurrentVideoSettings, CurrentAudioSettings);
     }
     StartWorkers();
+    ActiveBackpressurePolicy = ResolveBackpressurePolicy();
+    if (SpillFile.IsValid() && ActiveBackpressurePolicy != EPanoramaBackpressurePolicy::BlockProducer)
+    {
+        // The blocking policy fell back, so spilling would stall a render thread that is no longer allowed to wait.
+        PushWarningMessage(TEXT("Spill to disk needs blocking backpressure - spill tier disabled."));
+        CloseSpillFile();
+    }
     {
         FScopeLock Lock(&StatusCriticalSection);
         CachedStatus.bIsCapturing = true;
@@ -206,6 +296,7 @@ void FPanoramaCaptureManager::StartCapture()
         FScopeLock Lock(&StatusCriticalSection);
         CachedStatus.PendingFrameCount = 0;
         CachedStatus.DroppedFrames = 0;
+        CachedStatus.ThrottledFrames = 0;
     }
 }
 
@@ -243,10 +334,21 @@ void FPanoramaCaptureManager::StopCapture()
         }
     }
 
+    // Land captures still in flight on the render thread, then finish whatever the worker left in the queue so
+    // stopping never discards frames that were already captured.
+    FlushRenderingCommands();
     StopWorkers();
+    ProcessPendingFrames();
+    FinishSequenceEncoding();
 
     PendingLeftFrame.Reset();
-    PendingNVENCLeftFrame.Reset();
+    CloseSpillFile();
+
+    // Give the recycled frames, payload buffers and encoder scratch back to the system between captures.
+    if (FramePool)
+    {
+        FramePool->Trim();
+    }
 
     if (VideoEncoder)
     {
@@ -271,24 +373,213 @@ void FPanoramaCaptureManager::StopCapture()
     NotifyStatus_GameThread();
 }
 
-void FPanoramaCaptureManager::EnqueueFrame_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+void FPanoramaCaptureManager::EnqueueFrame_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame)
 {
-    if (!Frame.IsValid())
+    if (!LeftFrame.IsValid())
     {
         return;
     }
 
-    if (!FrameQueue.Enqueue(Frame))
+    // Both eyes go in as one unit, so backpressure keeps or drops the whole capture and never strands a single eye.
+    // The queue counts its own drops; the status picks them up on the next poll, so nothing here takes a lock.
+    int64 LeftBytes = LeftFrame->GetPayloadBytes();
+    int64 RightBytes = RightFrame.IsValid() ? RightFrame->GetPayloadBytes() : 0;
+    StampEnqueue(*LeftFrame, RightFrame.Get());
+    bool bQueued = false;
+    if (SpillFile.IsValid())
     {
-        FScopeLock Lock(&StatusCriticalSection);
-        CachedStatus.DroppedFrames++;
+        bQueued = FrameQueue.TryEnqueuePair(LeftFrame, LeftBytes, RightFrame, RightBytes);
+
+        // Only a full memory budget is helped by spilling; a ring full by count would reject the headers as well.
+        if (!bQueued && FrameQueue.HasFreeSlots(RightFrame.IsValid() ? 2 : 1) && SpillPair_RenderThread(*LeftFrame, RightFrame.Get()))
+        {
+            // The headers cost no memory, so the capture stays in order behind the frames still in memory.
+            LeftBytes = LeftFrame->GetPayloadBytes();
+            RightBytes = RightFrame.IsValid() ? RightFrame->GetPayloadBytes() : 0;
+            StampEnqueue(*LeftFrame, RightFrame.Get());
+            bQueued = FrameQueue.TryEnqueuePair(LeftFrame, LeftBytes, RightFrame, RightBytes);
+        }
     }
-    else if (FrameProcessor.IsValid())
+
+    // Without a spill tier, or once it is full too, the backpressure policy decides.
+    if (!bQueued)
+    {
+        switch (ActiveBackpressurePolicy)
+        {
+        case EPanoramaBackpressurePolicy::DropOldest:
+            bQueued = FrameQueue.EnqueuePairEvictingOldest(LeftFrame, LeftBytes, RightFrame, RightBytes);
+            break;
+        case EPanoramaBackpressurePolicy::BlockProducer:
+            bQueued = EnqueueBlocking_RenderThread(LeftFrame, LeftBytes, RightFrame, RightBytes);
+            break;
+        default:
+            bQueued = FrameQueue.EnqueuePair(LeftFrame, LeftBytes, RightFrame, RightBytes);
+            break;
+        }
+    }
+
+    if (bQueued && FrameProcessor.IsValid())
     {
         FrameProcessor->SignalWork();
     }
 }
 
+bool FPanoramaCaptureManager::SpillPair_RenderThread(FPanoramaFrame& LeftFrame, FPanoramaFrame* RightFrame)
+{
+    if (!SpillFile->SpillFrame(LeftFrame, FramePool.Get()))
+    {
+        return false;
+    }
+    if (RightFrame && !SpillFile->SpillFrame(*RightFrame, FramePool.Get()))
+    {
+        // A pair is spilled whole or not at all, so the left eye is read back and its region freed.
+        if (!SpillFile->RestoreFrame(LeftFrame, FramePool.Get()))
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Could not read back the spilled left eye of capture %llu"), LeftFrame.FrameId);
+        }
+        return false;
+    }
+    return true;
+}
+
+void FPanoramaCaptureManager::StampEnqueue(FPanoramaFrame& LeftFrame, FPanoramaFrame* RightFrame)
+{
+    // Stamped before each attempt: once a frame is in the queue the worker may already be reading it.
+    const uint64 EnqueueCycles = FPlatformTime::Cycles64();
+    LeftFrame.Timings.EnqueueCycles = EnqueueCycles;
+    if (RightFrame)
+    {
+        RightFrame->Timings.EnqueueCycles = EnqueueCycles;
+    }
+}
+
+bool FPanoramaCaptureManager::EnqueueBlocking_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, int64 LeftBytes, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame, int64 RightBytes)
+{
+    const double TimeoutSeconds = CurrentVideoSettings.BackpressureTimeoutMs / 1000.0;
+    const double StartSeconds = FPlatformTime::Seconds();
+    for (;;)
+    {
+        StampEnqueue(*LeftFrame, RightFrame.Get());
+        if (FrameQueue.TryEnqueuePair(LeftFrame, LeftBytes, RightFrame, RightBytes))
+        {
+            return true;
+        }
+
+        const bool bTimedOut = TimeoutSeconds > 0.0 && FPlatformTime::Seconds() - StartSeconds >= TimeoutSeconds;
+        if (bTimedOut || !bBlockingEnqueueAllowed)
+        {
+            FrameQueue.RecordDrop();
+            return false;
+        }
+
+        // Publish the wait before retrying so a dequeue that lands in between still triggers the event.
+        bProducerWaitingForSpace = true;
+        if (FrameProcessor.IsValid())
+        {
+            FrameProcessor->SignalWork();
+        }
+        StampEnqueue(*LeftFrame, RightFrame.Get());
+        if (FrameQueue.TryEnqueuePair(LeftFrame, LeftBytes, RightFrame, RightBytes))
+        {
+            bProducerWaitingForSpace = false;
+            return true;
+        }
+        QueueSpaceEvent->Wait(GBackpressureWaitSliceMs);
+        bProducerWaitingForSpace = false;
+    }
+}
+
+void FPanoramaCaptureManager::ConfigureFrameQueueForCapture()
+{
+    CloseSpillFile();
+
+    int32 SpillSlots = 0;
+    if (CurrentVideoSettings.bSpillToDisk)
+    {
+        if (CurrentVideoSettings.FrameQueueMode != EPanoramaFrameQueueMode::MemoryBudget)
+        {
+            PushWarningMessage(TEXT("Spill to disk needs the memory budget queue mode - spill tier disabled."));
+        }
+        else if (ResolveAutoBackpressurePolicy(CurrentVideoSettings.BackpressurePolicy) != EPanoramaBackpressurePolicy::BlockProducer)
+        {
+            // Spilling copies the payload on the render thread, which only a capture that may block it can afford;
+            // live previews must never stall the game.
+            PushWarningMessage(TEXT("Spill to disk needs blocking backpressure - spill tier disabled."));
+        }
+        else
+        {
+            const FString SpillDirectory = CurrentVideoSettings.SpillDirectory.IsEmpty() ? TargetOutputDirectory : CurrentVideoSettings.SpillDirectory;
+            const int64 SpillBytes = static_cast<int64>(FMath::Max(1, CurrentVideoSettings.SpillFileSizeMB)) * 1024 * 1024;
+            SpillFile = MakeShared<FPanoramaSpillFile, ESPMode::ThreadSafe>();
+            if (SpillFile->Open(FPaths::Combine(SpillDirectory, GSpillFileName), SpillBytes))
+            {
+                // Mono NVENC frames are converted on the render thread before they are queued; everything else spills
+                // as half-float readback. Zero-copy frames have no CPU payload and never spill.
+                const FIntPoint& Resolution = CurrentVideoSettings.Resolution;
+                const bool bConvertedOnRenderThread = CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::NVENC
+                    && CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Mono
+                    && CurrentVideoSettings.ColorFormat != EPanoramaColorFormat::BGRA8;
+                const int32 BytesPerSample = CurrentVideoSettings.ColorFormat == EPanoramaColorFormat::P010 ? sizeof(uint16) : sizeof(uint8);
+                const int64 SpilledFrameBytes = bConvertedOnRenderThread
+                    ? PanoramaCapture::Color::GetPlanarPayloadBytes(Resolution, BytesPerSample)
+                    : static_cast<int64>(FMath::Max(1, Resolution.X)) * FMath::Max(1, Resolution.Y) * sizeof(FFloat16Color);
+                SpillSlots = static_cast<int32>(FMath::Min<int64>(SpillBytes / FMath::Max<int64>(1, SpilledFrameBytes), MAX_int32 / 2));
+            }
+            else
+            {
+                PushWarningMessage(FString::Printf(TEXT("Could not create a %d MB spill file in %s - spill tier disabled."), CurrentVideoSettings.SpillFileSizeMB, *SpillDirectory));
+                SpillFile.Reset();
+            }
+        }
+    }
+
+    // Spilled frames still take a ring slot each, so the ring grows by as many frames as the spill file can hold.
+    FrameQueue.Configure(CurrentVideoSettings.MaxQueuedFrames + SpillSlots, GetQueueBudgetBytes(CurrentVideoSettings));
+}
+
+void FPanoramaCaptureManager::CloseSpillFile()
+{
+    if (SpillFile)
+    {
+        SpillFile->Close();
+        SpillFile.Reset();
+    }
+}
+
+void FPanoramaCaptureManager::RestoreSpilledFrame(FPanoramaFrame& Frame)
+{
+    if (Frame.GetStage() != EPanoramaFrameStage::Spilled)
+    {
+        return;
+    }
+
+    if (!SpillFile.IsValid() || !SpillFile->RestoreFrame(Frame, FramePool.Get()))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to read frame %llu (eye %d) back from the spill file"), Frame.FrameId, Frame.EyeIndex);
+    }
+}
+
+void FPanoramaCaptureManager::NotifyQueueSpace()
+{
+    if (bProducerWaitingForSpace)
+    {
+        QueueSpaceEvent->Trigger();
+    }
+}
+
+EPanoramaBackpressurePolicy FPanoramaCaptureManager::ResolveBackpressurePolicy()
+{
+    EPanoramaBackpressurePolicy Policy = ResolveAutoBackpressurePolicy(CurrentVideoSettings.BackpressurePolicy);
+
+    if (Policy == EPanoramaBackpressurePolicy::BlockProducer && !FrameProcessor.IsValid())
+    {
+        // Without a worker the game thread drains the queue, and it may itself be waiting on the render thread.
+        PushWarningMessage(TEXT("No frame worker thread - blocking backpressure replaced by drop-newest."));
+        Policy = EPanoramaBackpressurePolicy::DropNewest;
+    }
+    return Policy;
+}
+
 FPanoramicCaptureStatus FPanoramaCaptureManager::GetStatus() const
 {
     FScopeLock Lock(&StatusCriticalSection);
@@ -335,12 +626,18 @@ void FPanoramaCaptureManager::Tick_GameThread(float DeltaTime)
         }
     }
 
-    if (Renderer && OwnerComponent.IsValid())
+    const bool bThrottled = ActiveBackpressurePolicy == EPanoramaBackpressurePolicy::ThrottleCapture && FrameQueue.GetFillRatio() >= CurrentVideoSettings.QueueHighWaterMark;
+    if (bThrottled)
+    {
+        FScopeLock Lock(&StatusCriticalSection);
+        CachedStatus.ThrottledFrames++;
+    }
+    else if (Renderer && OwnerComponent.IsValid())
     {
         const bool bZeroCopy = VideoEncoder && VideoEncoder->SupportsZeroCopy();
-        Renderer->CaptureFrame(OwnerComponent.Get(), CurrentVideoSettings, CaptureStartTimeSeconds, bZeroCopy, [this](const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+        Renderer->CaptureFrame(OwnerComponent.Get(), CurrentVideoSettings, CaptureStartTimeSeconds, bZeroCopy, [this](const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame)
         {
-            EnqueueFrame_RenderThread(Frame);
+            EnqueueFrame_RenderThread(LeftFrame, RightFrame);
         });
     }
 
@@ -392,7 +689,13 @@ void FPanoramaCaptureManager::StartWorkers()
     {
         UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to spawn frame processor thread - falling back to game thread processing"));
         FrameProcessor.Reset();
+        return;
     }
+    bBlockingEnqueueAllowed = true;
+
+    // Finished sequence frames are handed to the muxer by this thread, so it is woken when one completes while the queue is idle.
+    FFrameProcessor* Processor = FrameProcessor.Get();
+    SequenceEncoder->SetOnJobCompleted([Processor]() { Processor->SignalWork(); });
 }
 
 void FPanoramaCaptureManager::StopWorkers()
@@ -402,6 +705,9 @@ void FPanoramaCaptureManager::StopWorkers()
         return;
     }
 
+    bBlockingEnqueueAllowed = false;
+    QueueSpaceEvent->Trigger();
+    SequenceEncoder->SetOnJobCompleted(nullptr);
     FrameProcessor->Stop();
     if (FrameProcessorThread.IsValid())
     {
@@ -418,192 +724,188 @@ void FPanoramaCaptureManager::ProcessPendingFrames()
         return;
     }
 
-    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> Frame;
-    while ((Frame = FrameQueue.Dequeue()).IsValid())
+    const bool bImageSequence = IsImageSequenceOutput();
+    const bool bStereo = CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo;
+    TArray<TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>, TInlineAllocator<GFrameBatchSize>> Batch;
+    while (FrameQueue.DequeueBulk(Batch, GFrameBatchSize) > 0)
     {
-        if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence)
+        NotifyQueueSpace();
+        const uint64 DequeueCycles = FPlatformTime::Cycles64();
+        for (TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame : Batch)
         {
-            HandlePNGFrame(Frame);
-        }
-        else
-        {
-            HandleNVENCFrame(Frame);
-        }
-        {
-            FScopeLock Lock(&StatusCriticalSection);
-            CachedStatus.PendingFrameCount = FrameQueue.Num();
+            if (Frame.IsValid())
+            {
+                Frame->Timings.DequeueCycles = DequeueCycles;
+                RestoreSpilledFrame(*Frame);
+            }
+
+            if (bStereo)
+            {
+                HandleStereoEye(Frame);
+            }
+            else if (bImageSequence)
+            {
+                SubmitSequenceFrame(Frame, nullptr);
+            }
+            else
+            {
+                HandleNVENCFrame(Frame);
+            }
+
+            // Release each frame as soon as it is handled so pooled frames recycle before the batch ends.
+            Frame.Reset();
         }
-    }
-}
+        Batch.Reset();
 
-void FPanoramaCaptureManager::ProcessPendingFrames_Worker()
-{
-    if (!VideoEncoder || !Muxer)
-    {
-        return;
+        FlushCompletedSequenceFrames();
+        UpdateStatusAfterVideoFrames();
     }
 
-    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> Frame;
-    while ((Frame = FrameQueue.Dequeue()).IsValid())
+    // Woken by an encoder finishing while the queue is empty.
+    if (FlushCompletedSequenceFrames() > 0)
     {
-        if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence)
-        {
-            HandlePNGFrame(Frame);
-        }
-        else
-        {
-            HandleNVENCFrame(Frame);
-        }
-
-        UpdateStatusAfterVideoFrame(nullptr);
+        UpdateStatusAfterVideoFrames();
     }
 }
 
-bool FPanoramaCaptureManager::HandlePNGFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+void FPanoramaCaptureManager::ProcessPendingFrames_Worker()
+{
+    ProcessPendingFrames();
+}
+
+void FPanoramaCaptureManager::HandleStereoEye(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
 {
     if (!Frame.IsValid())
     {
-        return false;
+        return;
     }
 
-    if (CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo && Frame->EyeIndex == 1)
+    // Eyes are paired by capture ID. The queue keeps a capture's eyes together, so a mismatch means one eye was lost.
+    if (Frame->EyeIndex == 0)
     {
         if (PendingLeftFrame.IsValid())
         {
-            const bool bResult = HandleStereoPNGPair(PendingLeftFrame, Frame);
-            PendingLeftFrame.Reset();
-            return bResult;
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Stereo capture %llu has no right eye - skipping it"), PendingLeftFrame->FrameId);
         }
-        return false;
-    }
-
-    if (CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo)
-    {
         PendingLeftFrame = Frame;
-        return true;
+        return;
     }
 
-    const FString FilePath = BuildPNGFilePath(FrameCounter++);
-    const bool bSuccess = SavePNGToDisk(FilePath, Frame->LinearPixels, Frame->Resolution);
-    if (bSuccess)
+    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> LeftFrame = MoveTemp(PendingLeftFrame);
+    if (!LeftFrame.IsValid() || LeftFrame->FrameId != Frame->FrameId)
     {
-        Frame->DiskFilePath = FilePath;
-        Frame->LinearPixels.Reset();
-        Muxer->AddVideoFrame(Frame);
-        UpdateStatusAfterVideoFrame(Frame);
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Right eye of stereo capture %llu has no matching left eye - skipping it"), Frame->FrameId);
+        return;
     }
-    return bSuccess;
-}
 
-bool FPanoramaCaptureManager::HandleStereoPNGPair(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame)
-{
-    if (!LeftFrame.IsValid() || !RightFrame.IsValid())
+    if (IsImageSequenceOutput())
     {
-        return false;
+        SubmitSequenceFrame(LeftFrame, Frame);
     }
-
-    const FIntPoint LeftRes = LeftFrame->Resolution;
-    const FIntPoint RightRes = RightFrame->Resolution;
-    if (LeftRes != RightRes || LeftFrame->LinearPixels.Num() == 0 || RightFrame->LinearPixels.Num() == 0)
+    else if (VideoEncoder->SupportsZeroCopy())
     {
-        UE_LOG(LogPanoramaCapture, Warning, TEXT("Stereo frame mismatch - skipping pair"));
-        return false;
+        // The left eye carries the combined NVENC texture for both eyes.
+        HandleNVENCFrame(LeftFrame);
     }
-
-    const bool bSideBySide = CurrentVideoSettings.StereoLayout == EPanoramaStereoLayout::SideBySide;
-    TArray<FFloat16Color> Combined;
-    FIntPoint CombinedRes;
-    if (bSideBySide)
+    else
     {
-        CombinedRes = FIntPoint(LeftRes.X * 2, LeftRes.Y);
-        Combined.SetNumUninitialized(CombinedRes.X * CombinedRes.Y);
-        for (int32 Row = 0; Row < LeftRes.Y; ++Row)
+        TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> Encoded = HandleStereoNVENCPair(LeftFrame, Frame);
+        if (Encoded.IsValid())
         {
-            const int32 LeftRowIndex = Row * LeftRes.X;
-            const int32 RightRowIndex = Row * RightRes.X;
-            FFloat16Color* DestRow = Combined.GetData() + Row * CombinedRes.X;
-            FMemory::Memcpy(DestRow, LeftFrame->LinearPixels.GetData() + LeftRowIndex, sizeof(FFloat16Color) * LeftRes.X);
-            FMemory::Memcpy(DestRow + LeftRes.X, RightFrame->LinearPixels.GetData() + RightRowIndex, sizeof(FFloat16Color) * RightRes.X);
+            Muxer->AddVideoFrame(Encoded);
+            RecordVideoFrameWritten(Encoded);
+        }
+        else
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC failed to encode stereo pair."));
         }
     }
-    else
-    {
-        CombinedRes = FIntPoint(LeftRes.X, LeftRes.Y * 2);
-        const int32 TotalPixels = LeftFrame->LinearPixels.Num() + RightFrame->LinearPixels.Num();
-        Combined.Reserve(TotalPixels);
-        Combined.Append(LeftFrame->LinearPixels);
-        Combined.Append(RightFrame->LinearPixels);
-    }
-
-    const FString FilePath = BuildPNGFilePath(FrameCounter++);
-    const bool bSuccess = SavePNGToDisk(FilePath, Combined, CombinedRes);
-    if (bSuccess)
-    {
-        LeftFrame->DiskFilePath = FilePath;
-        LeftFrame->LinearPixels.Reset();
-        LeftFrame->Resolution = CombinedRes;
-        LeftFrame->bIsStereo = true;
-        Muxer->AddVideoFrame(LeftFrame);
-        UpdateStatusAfterVideoFrame(LeftFrame);
-    }
-    RightFrame->LinearPixels.Reset();
-    return bSuccess;
 }
 
-bool FPanoramaCaptureManager::SavePNGToDisk(const FString& Filename, const TArray<FFloat16Color>& Pixels, const FIntPoint& Resolution)
+void FPanoramaCaptureManager::SubmitSequenceFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame)
 {
-    if (Pixels.Num() == 0 || Resolution.X <= 0 || Resolution.Y <= 0)
+    if (!LeftFrame.IsValid())
     {
-        return false;
+        return;
     }
 
-    const int32 ExpectedPixels = Resolution.X * Resolution.Y;
-    if (ExpectedPixels != Pixels.Num())
+    if (SequenceEncoder->GetNumSlots() == 0)
     {
-        UE_LOG(LogPanoramaCapture, Warning, TEXT("PNG save aborted due to mismatched pixel count %d vs expected %d"), Pixels.Num(), ExpectedPixels);
-        return false;
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Sequence encoders not running - skipping frame %llu"), LeftFrame->FrameId);
+        return;
     }
 
-    IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
-    TSharedPtr<IImageWrapper> ImageWriter = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
-    if (!ImageWriter.IsValid())
+    // Frames held by the encoders were charged to the queue budget up front for a fixed number of slots. Waiting here
+    // stops the drain, which leaves backpressure to the queue as before.
+    while (!SequenceEncoder->CanSubmit())
     {
-        return false;
+        if (FlushCompletedSequenceFrames() == 0)
+        {
+            SequenceEncoder->WaitForOldest();
+        }
     }
 
-    TArray<uint16> RawBuffer;
-    RawBuffer.SetNum(ExpectedPixels * 4);
+    // The encoders may finish in any order, so they write under a pending name and the final index is assigned when
+    // the frame drains in capture order.
+    SequenceEncoder->Submit(LeftFrame, RightFrame, CurrentVideoSettings.StereoLayout, BuildSequenceFilePath(GPendingFramePrefix, PendingSequenceIndex++));
+}
 
-    for (int32 PixelIndex = 0; PixelIndex < ExpectedPixels; ++PixelIndex)
+int32 FPanoramaCaptureManager::FlushCompletedSequenceFrames()
+{
+    return SequenceEncoder->DrainCompleted([this](const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame, bool bSuccess)
     {
-        const FFloat16Color& Source = Pixels[PixelIndex];
-        const int32 BaseIndex = PixelIndex * 4;
-        RawBuffer[BaseIndex + 0] = static_cast<uint16>(FMath::Clamp(Source.R.GetFloat() * 65535.0f, 0.0f, 65535.0f));
-        RawBuffer[BaseIndex + 1] = static_cast<uint16>(FMath::Clamp(Source.G.GetFloat() * 65535.0f, 0.0f, 65535.0f));
-        RawBuffer[BaseIndex + 2] = static_cast<uint16>(FMath::Clamp(Source.B.GetFloat() * 65535.0f, 0.0f, 65535.0f));
-        RawBuffer[BaseIndex + 3] = static_cast<uint16>(FMath::Clamp(Source.A.GetFloat() * 65535.0f, 0.0f, 65535.0f));
-    }
+        const FPanoramaPersistedPayload* Persisted = bSuccess ? Frame->GetPersisted() : nullptr;
+        if (!Persisted)
+        {
+            // A failed frame takes no index, so Frame_%06d stays contiguous and ffmpeg's image2 input reads every
+            // frame after it.
+            return;
+        }
 
-    if (!ImageWriter->SetRaw(RawBuffer.GetData(), RawBuffer.Num() * sizeof(uint16), Resolution.X, Resolution.Y, ERGBFormat::RGBA, 16))
-    {
-        return false;
-    }
+        const FString FinalPath = BuildSequenceFilePath(GFramePrefix, FrameCounter);
+        if (!IFileManager::Get().Move(*FinalPath, *Persisted->FilePath, true))
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to move sequence frame %s to %s - dropping it"), *Persisted->FilePath, *FinalPath);
+            IFileManager::Get().Delete(*Persisted->FilePath, false, true, true);
+            return;
+        }
+
+        ++FrameCounter;
+        Frame->SetPersisted(FinalPath, Frame->Resolution);
+        Muxer->AddVideoFrame(Frame);
+        RecordVideoFrameWritten(Frame);
+    });
+}
 
-    const TArray64<uint8>& Compressed = ImageWriter->GetCompressed(0);
-    if (Compressed.Num() == 0)
+void FPanoramaCaptureManager::FinishSequenceEncoding()
+{
+    while (SequenceEncoder->GetNumInFlight() > 0)
     {
-        return false;
+        SequenceEncoder->WaitForOldest();
+        FlushCompletedSequenceFrames();
     }
+    SequenceEncoder->Stop();
+    UpdateStatusAfterVideoFrames();
+}
 
-    const FString Directory = FPaths::GetPath(Filename);
-    IFileManager::Get().MakeDirectory(*Directory, true);
-    return FFileHelper::SaveArrayToFile(Compressed, *Filename);
+bool FPanoramaCaptureManager::IsImageSequenceOutput() const
+{
+    return CurrentVideoSettings.OutputFormat != EPanoramaOutputFormat::NVENC;
 }
 
-FString FPanoramaCaptureManager::BuildPNGFilePath(int32 FrameIndex) const
+FString FPanoramaCaptureManager::BuildSequenceFilePath(const TCHAR* BaseName, int32 FrameIndex) const
 {
     const FString FramesDir = FPaths::Combine(TargetOutputDirectory, GFrameSubdirectory);
-    return FPaths::Combine(FramesDir, FString::Printf(TEXT("Frame_%06d.png"), FrameIndex));
+    const TCHAR* Extension = TEXT("png");
+    if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::EXRSequence)
+    {
+        Extension = TEXT("exr");
+    }
+    else if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::IntermediateSequence)
+    {
+        Extension = PanoramaCapture::Intermediate::GetFileExtension();
+    }
+    return FPaths::Combine(FramesDir, FString::Printf(TEXT("%s_%06d.%s"), BaseName, FrameIndex, Extension));
 }
 
 void FPanoramaCaptureManager::ProcessPendingAudio()
@@ -614,11 +916,7 @@ void FPanoramaCaptureManager::ProcessPendingAudio()
 void FPanoramaCaptureManager::NotifyStatus_GameThread()
 {
     FScopeLock Lock(&StatusCriticalSection);
-    const int32 Occupancy = FrameQueue.Num();
-    CachedStatus.PendingFrameCount = Occupancy;
-    CachedStatus.DroppedFrames = FrameQueue.GetDroppedCount();
-    const int32 Capacity = FrameQueue.GetCapacity();
-    CachedStatus.RingBufferFill = (Capacity > 0) ? static_cast<float>(Occupancy) / static_cast<float>(Capacity) : 0.f;
+    UpdateQueueStatus_Locked();
     CachedStatus.bUsingFallback = bHasFallenBack;
     CachedStatus.LastWarning = LastWarningMessage;
     if (OnCaptureStatusUpdated.IsBound())
@@ -636,12 +934,7 @@ bool FPanoramaCaptureManager::HandleNVENCFrame(const TSharedPtr<FPanoramaFrame,
 
     if (VideoEncoder->SupportsZeroCopy())
     {
-        if (CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo && Frame->EyeIndex == 1)
-        {
-            return true;
-        }
-
-        if (!Frame->NVENCTexture.IsValid())
+        if (!Frame->GetGPUTexture())
         {
             UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC zero-copy frame missing GPU texture."));
             return false;
@@ -650,40 +943,17 @@ bool FPanoramaCaptureManager::HandleNVENCFrame(const TSharedPtr<FPanoramaFrame,
         if (VideoEncoder->EncodeFrame(Frame))
         {
             Muxer->AddVideoFrame(Frame);
-            UpdateStatusAfterVideoFrame(Frame);
-            return true;
-        }
-
-        return false;
-    }
-
-    if (CurrentVideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo)
-    {
-        if (Frame->EyeIndex == 0)
-        {
-            PendingNVENCLeftFrame = Frame;
+            RecordVideoFrameWritten(Frame);
             return true;
         }
 
-        if (Frame->EyeIndex == 1 && PendingNVENCLeftFrame.IsValid())
-        {
-            TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> Encoded = HandleStereoNVENCPair(PendingNVENCLeftFrame, Frame);
-            PendingNVENCLeftFrame.Reset();
-            if (Encoded.IsValid())
-            {
-                Muxer->AddVideoFrame(Encoded);
-                UpdateStatusAfterVideoFrame(Encoded);
-                return true;
-            }
-            UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC failed to encode stereo pair."));
-        }
         return false;
     }
 
     if (VideoEncoder->EncodeFrame(Frame))
     {
         Muxer->AddVideoFrame(Frame);
-        UpdateStatusAfterVideoFrame(Frame);
+        RecordVideoFrameWritten(Frame);
         return true;
     }
 
@@ -702,17 +972,53 @@ TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> FPanoramaCaptureManager::HandleS
     return VideoEncoder->EncodeStereoPair(LeftFrame, RightFrame);
 }
 
-void FPanoramaCaptureManager::UpdateStatusAfterVideoFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+void FPanoramaCaptureManager::RecordVideoFrameWritten(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+{
+    if (Frame.IsValid())
+    {
+        PendingVideoPTS = Frame->TimestampSeconds;
+        bHasPendingVideoPTS = true;
+
+        // The encoder stamps its own write; sequence frames are on disk by the time they get here.
+        if (Frame->Timings.WrittenCycles == 0)
+        {
+            Frame->Timings.WrittenCycles = FPlatformTime::Cycles64();
+        }
+        LatencyTracker->RecordFrame(Frame->Timings);
+    }
+}
+
+void FPanoramaCaptureManager::UpdateStatusAfterVideoFrames()
 {
     FScopeLock Lock(&StatusCriticalSection);
-    const int32 Occupancy = FrameQueue.Num();
-    CachedStatus.PendingFrameCount = Occupancy;
+    UpdateQueueStatus_Locked();
+    if (bHasPendingVideoPTS)
+    {
+        CachedStatus.LastVideoPTS = PendingVideoPTS;
+        bHasPendingVideoPTS = false;
+    }
+}
+
+void FPanoramaCaptureManager::UpdateQueueStatus_Locked()
+{
+    CachedStatus.PendingFrameCount = FrameQueue.Num();
+    CachedStatus.PendingFrameBytes = FrameQueue.GetQueuedBytes();
+    CachedStatus.FrameQueueBudgetBytes = FrameQueue.GetMaxBytes();
     CachedStatus.DroppedFrames = FrameQueue.GetDroppedCount();
-    const int32 Capacity = FrameQueue.GetCapacity();
-    CachedStatus.RingBufferFill = (Capacity > 0) ? static_cast<float>(Occupancy) / static_cast<float>(Capacity) : 0.f;
-    if (Frame.IsValid())
+    CachedStatus.RingBufferFill = FrameQueue.GetFillRatio();
+    if (SpillFile)
+    {
+        CachedStatus.SpilledFrames = SpillFile->GetSpilledCount();
+        CachedStatus.SpillBytesInUse = SpillFile->GetUsedBytes();
+    }
+    if (FramePool)
+    {
+        CachedStatus.FramePoolHits = FramePool->GetHitCount();
+        CachedStatus.FramePoolMisses = FramePool->GetMissCount();
+    }
+    if (LatencyTracker)
     {
-        CachedStatus.LastVideoPTS = Frame->TimestampSeconds;
+        LatencyTracker->FillStatus(CachedStatus);
     }
 }
 
@@ -736,11 +1042,7 @@ void FPanoramaCaptureManager::ResetStatus()
     CachedStatus.bUsingFallback = bHasFallenBack;
     CachedStatus.LastWarning = LastWarningMessage;
     CachedStatus.EffectiveVideoSettings = CurrentVideoSettings;
-    const int32 Occupancy = FrameQueue.Num();
-    CachedStatus.PendingFrameCount = Occupancy;
-    CachedStatus.DroppedFrames = FrameQueue.GetDroppedCount();
-    const int32 Capacity = FrameQueue.GetCapacity();
-    CachedStatus.RingBufferFill = (Capacity > 0) ? static_cast<float>(Occupancy) / static_cast<float>(Capacity) : 0.f;
+    UpdateQueueStatus_Locked();
 }
 
 bool FPanoramaCaptureManager::PerformPreflightChecks()
@@ -759,6 +1061,34 @@ bool FPanoramaCaptureManager::PerformPreflightChecks()
         }
     }
 
+    if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::EXRSequence && !PanoramaCapture::EXR::IsSupported())
+    {
+        PushWarningMessage(TEXT("OpenEXR unavailable on this platform - writing a PNG sequence instead."));
+        CurrentVideoSettings.OutputFormat = EPanoramaOutputFormat::PNGSequence;
+        bHasFallenBack = true;
+        bAllGood = false;
+    }
+
+    // Intermediate frames are only readable by the finalize step, so without ffmpeg they would be a dead end.
+    if (CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::IntermediateSequence && !(Muxer.IsValid() && Muxer->IsFFmpegAvailable()))
+    {
+        PushWarningMessage(TEXT("ffmpeg unavailable to read back lossless intermediates - writing a PNG sequence instead."));
+        CurrentVideoSettings.OutputFormat = EPanoramaOutputFormat::PNGSequence;
+        bHasFallenBack = true;
+        bAllGood = false;
+    }
+
+    // The equirect pass hands PQ output BT.2020 light scaled for the CPU P010 converter, the only stage that applies
+    // the curve. Any other output would store that clipped and still be tagged HDR10, so it is captured as SDR instead.
+    if (CurrentVideoSettings.Gamma == EPanoramaGamma::PQ
+        && !(CurrentVideoSettings.OutputFormat == EPanoramaOutputFormat::NVENC && CurrentVideoSettings.ColorFormat == EPanoramaColorFormat::P010))
+    {
+        PushWarningMessage(TEXT("HDR10 (PQ) requires NVENC with P010 output - capturing sRGB instead."));
+        CurrentVideoSettings.Gamma = EPanoramaGamma::SRGB;
+        bHasFallenBack = true;
+        bAllGood = false;
+    }
+
     if (Muxer.IsValid() && !Muxer->IsFFmpegAvailable())
     {
         PushWarningMessage(TEXT("ffmpeg executable missing - automatic muxing will be skipped."));
@@ -1,8 +1,10 @@
 #include "PanoramaCaptureNVENC.h"
 #include "PanoramaCaptureFrame.h"
+#include "PanoramaCaptureFramePool.h"
 #include "PanoramaCaptureLog.h"
 #include "PanoramaCaptureColorConversion.h"
 
+#include "HAL/PlatformTime.h"
 #include "HAL/PlatformFilemanager.h"
 #include "Misc/Paths.h"
 #include "RHI.h"
@@ -17,6 +19,22 @@
 
 using namespace PanoramaCapture::Color;
 
+namespace
+{
+    TArray<uint8> AcquireByteBuffer(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& Pool)
+    {
+        return Pool.IsValid() ? Pool->AcquireByteBuffer() : TArray<uint8>();
+    }
+
+    void RecyclePayload(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& Pool, FPanoramaFramePayload&& Payload)
+    {
+        if (Pool.IsValid())
+        {
+            Pool->Recycle(MoveTemp(Payload));
+        }
+    }
+}
+
 FPanoramaNVENCEncoder::FNVENCAPI::FNVENCAPI()
     : bLoaded(false)
 {
@@ -140,6 +158,11 @@ void FPanoramaNVENCEncoder::InitializeEncoderResources(const FPanoramicVideoSett
         UE_LOG(LogPanoramaCapture, Warning, TEXT("P010 output selected without HEVC - NVENC hardware path will fall back to CPU encoding."));
     }
 
+    if (Settings.Gamma == EPanoramaGamma::PQ && Settings.ColorFormat != EPanoramaColorFormat::P010)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("HDR10 (PQ) output selected without P010 - the stream will not be 10-bit HDR10."));
+    }
+
     if (!NVENCAPI.IsValid() || !NVENCAPI->bLoaded)
     {
         UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC API not available - falling back to CPU color conversion."));
@@ -279,28 +302,35 @@ bool FPanoramaNVENCEncoder::EncodeFrame(const TSharedPtr<FPanoramaFrame, ESPMode
         return false;
     }
 
-    if (bSupportsZeroCopy && Frame->NVENCTexture.IsValid())
+    if (bSupportsZeroCopy && Frame->GetGPUTexture())
     {
-        const bool bResult = EncodeFrameZeroCopy(Frame);
-        Frame->LinearPixels.Reset();
-        Frame->PlanarVideo.Reset();
-        return bResult;
+        return EncodeFrameZeroCopy(Frame);
     }
 
-    FIntPoint OutputResolution = Frame->Resolution;
-    TArray<uint8> EncodedPayload;
-    if (!ConvertFrameToRawPayload(Frame, EncodedPayload, OutputResolution))
+    TArray<uint8> Payload;
+    const FPanoramaConvertedPayload* Converted = Frame->GetConverted();
+    if (Converted && Converted->ColorFormat == CachedSettings.ColorFormat)
     {
-        return false;
+        // The render thread already converted into the final packed layout; the buffer moves on to the encoded stage.
+        FPanoramaFramePayload Taken = Frame->TakePayload();
+        Payload = MoveTemp(Taken.Get<FPanoramaConvertedPayload>().Bytes);
+    }
+    else
+    {
+        Payload = AcquireByteBuffer(FramePool);
+        FIntPoint OutputResolution = Frame->Resolution;
+        if (!ConvertFrameToRawPayload(Frame, Payload, OutputResolution))
+        {
+            return false;
+        }
+        RecyclePayload(FramePool, Frame->TakePayload());
     }
 
-    Frame->EncodedVideo = MoveTemp(EncodedPayload);
-    Frame->LinearPixels.Reset();
-    Frame->PlanarVideo.Reset();
     Frame->bIsStereo = false;
-    Frame->Resolution = OutputResolution;
-    Frame->ColorFormat = CachedSettings.ColorFormat;
-    WritePacketToDisk(Frame->EncodedVideo);
+    Frame->SetEncoded(MoveTemp(Payload), Frame->Resolution, CachedSettings.ColorFormat);
+    Frame->Timings.ConvertedCycles = FPlatformTime::Cycles64();
+    WritePacketToDisk(Frame->GetEncoded()->Bytes);
+    Frame->Timings.WrittenCycles = FPlatformTime::Cycles64();
     ++EncodedFrameCount;
     EncodedResolution = Frame->Resolution;
     LastVideoPTS = Frame->TimestampSeconds;
@@ -320,44 +350,39 @@ TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> FPanoramaNVENCEncoder::EncodeSte
         return nullptr;
     }
 
-    if (bSupportsZeroCopy && LeftFrame->NVENCTexture.IsValid())
+    if (bSupportsZeroCopy && LeftFrame->GetGPUTexture())
     {
-        if (EncodeFrameZeroCopy(LeftFrame))
-        {
-            LeftFrame->LinearPixels.Reset();
-            LeftFrame->PlanarVideo.Reset();
-            RightFrame->LinearPixels.Reset();
-            RightFrame->PlanarVideo.Reset();
-            return LeftFrame;
-        }
-        return nullptr;
+        // The left eye's texture already holds both eyes; the right eye carries no payload.
+        return EncodeFrameZeroCopy(LeftFrame) ? LeftFrame : nullptr;
     }
 
-    TArray<uint8> EncodedPayload;
+    TArray<uint8> Payload = AcquireByteBuffer(FramePool);
     FIntPoint CombinedResolution = FIntPoint::ZeroValue;
-    if (!ConvertStereoToRawPayload(LeftFrame, RightFrame, EncodedPayload, CombinedResolution))
+    if (!ConvertStereoToRawPayload(LeftFrame, RightFrame, Payload, CombinedResolution))
     {
         return nullptr;
     }
 
-    LeftFrame->EncodedVideo = MoveTemp(EncodedPayload);
-    LeftFrame->LinearPixels.Reset();
-    LeftFrame->PlanarVideo.Reset();
-    RightFrame->LinearPixels.Reset();
-    RightFrame->PlanarVideo.Reset();
+    RecyclePayload(FramePool, LeftFrame->TakePayload());
+    RecyclePayload(FramePool, RightFrame->TakePayload());
     LeftFrame->bIsStereo = true;
-    LeftFrame->Resolution = CombinedResolution;
-    LeftFrame->ColorFormat = CachedSettings.ColorFormat;
-    RightFrame->ColorFormat = CachedSettings.ColorFormat;
-    RightFrame->Resolution = CombinedResolution;
     LeftFrame->TimestampSeconds = FMath::Min(LeftFrame->TimestampSeconds, RightFrame->TimestampSeconds);
-    WritePacketToDisk(LeftFrame->EncodedVideo);
+    LeftFrame->SetEncoded(MoveTemp(Payload), CombinedResolution, CachedSettings.ColorFormat);
+    LeftFrame->Timings.ConvertedCycles = FPlatformTime::Cycles64();
+    WritePacketToDisk(LeftFrame->GetEncoded()->Bytes);
+    LeftFrame->Timings.WrittenCycles = FPlatformTime::Cycles64();
     ++EncodedFrameCount;
     EncodedResolution = CombinedResolution;
     LastVideoPTS = LeftFrame->TimestampSeconds;
     return LeftFrame;
 }
 
+void FPanoramaNVENCEncoder::SetFramePool(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool)
+{
+    FScopeLock Lock(&CriticalSection);
+    FramePool = InFramePool;
+}
+
 void FPanoramaNVENCEncoder::Flush()
 {
     FScopeLock Lock(&CriticalSection);
@@ -400,7 +425,8 @@ bool FPanoramaNVENCEncoder::EncodeFrameZeroCopy(const TSharedPtr<FPanoramaFrame,
         return false;
     }
 
-    if (!Frame->NVENCTexture.IsValid())
+    const FPanoramaGPUTexturePayload* GPUTexture = Frame->GetGPUTexture();
+    if (!GPUTexture || !GPUTexture->Texture.IsValid())
     {
         return false;
     }
@@ -413,14 +439,14 @@ bool FPanoramaNVENCEncoder::EncodeFrameZeroCopy(const TSharedPtr<FPanoramaFrame,
 
     EnsureRawFile();
 
-    void* NativeResource = Frame->NVENCTexture->GetNativeResource();
+    void* NativeResource = GPUTexture->Texture->GetNativeResource();
     if (!NativeResource)
     {
         UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC zero-copy submission failed: native texture resource missing."));
         return false;
     }
 
-    const FIntPoint InputResolution = Frame->NVENCResolution;
+    const FIntPoint InputResolution = Frame->Resolution;
     if (InputResolution.X <= 0 || InputResolution.Y <= 0)
     {
         UE_LOG(LogPanoramaCapture, Warning, TEXT("NVENC zero-copy submission failed: invalid resolution %dx%d."), InputResolution.X, InputResolution.Y);
@@ -502,10 +528,11 @@ bool FPanoramaNVENCEncoder::EncodeFrameZeroCopy(const TSharedPtr<FPanoramaFrame,
         return false;
     }
 
-    Frame->EncodedVideo.SetNumUninitialized(LockParams.bitstreamSizeInBytes);
+    TArray<uint8> Bitstream = AcquireByteBuffer(FramePool);
+    Bitstream.SetNumUninitialized(LockParams.bitstreamSizeInBytes);
     if (LockParams.bitstreamSizeInBytes > 0 && LockParams.bitstreamBufferPtr)
     {
-        FMemory::Memcpy(Frame->EncodedVideo.GetData(), LockParams.bitstreamBufferPtr, LockParams.bitstreamSizeInBytes);
+        FMemory::Memcpy(Bitstream.GetData(), LockParams.bitstreamBufferPtr, LockParams.bitstreamSizeInBytes);
     }
 
     NVENCAPI->FunctionList.nvEncUnlockBitstream(EncoderInstance, CreateParams.bitstreamBuffer);
@@ -513,14 +540,17 @@ bool FPanoramaNVENCEncoder::EncodeFrameZeroCopy(const TSharedPtr<FPanoramaFrame,
     NVENCAPI->FunctionList.nvEncUnmapInputResource(EncoderInstance, MapParams.mappedResource);
     NVENCAPI->FunctionList.nvEncUnregisterResource(EncoderInstance, RegisterParams.registeredResource);
 
-    WritePacketToDisk(Frame->EncodedVideo);
+    // The bitstream replaces the texture payload, so the frame stops holding the GPU texture once it is encoded.
+    Frame->bIsStereo = CachedSettings.CaptureMode == EPanoramaCaptureMode::Stereo;
+    Frame->SetEncoded(MoveTemp(Bitstream), InputResolution, CachedSettings.ColorFormat);
+    const TArray<uint8>& Encoded = Frame->GetEncoded()->Bytes;
+    Frame->Timings.ConvertedCycles = FPlatformTime::Cycles64();
+    WritePacketToDisk(Encoded);
+    Frame->Timings.WrittenCycles = FPlatformTime::Cycles64();
     ++EncodedFrameCount;
     EncodedResolution = InputResolution;
     LastVideoPTS = Frame->TimestampSeconds;
-    Frame->bIsStereo = CachedSettings.CaptureMode == EPanoramaCaptureMode::Stereo;
-    Frame->Resolution = InputResolution;
-    Frame->ColorFormat = CachedSettings.ColorFormat;
-    return Frame->EncodedVideo.Num() > 0;
+    return Encoded.Num() > 0;
 #else
     UE_UNUSED(Frame);
     return false;
@@ -536,50 +566,23 @@ bool FPanoramaNVENCEncoder::ConvertFrameToRawPayload(const TSharedPtr<FPanoramaF
 
     OutResolution = Frame->Resolution;
 
+    const FConversionParallelism Parallelism = FConversionParallelism::FromSettings(CachedSettings);
     switch (CachedSettings.ColorFormat)
     {
     case EPanoramaColorFormat::NV12:
-    {
-        const int32 Width = Frame->Resolution.X;
-        const int32 Height = Frame->Resolution.Y;
-        const int32 ExpectedBytes = Width * Height + (Width * Height) / 2;
-        if (Frame->PlanarVideo.Num() == ExpectedBytes)
-        {
-            OutData = Frame->PlanarVideo;
-            return true;
-        }
-        FNV12PlaneBuffers Planes;
-        if (!ConvertLinearToNV12Planes(Frame->LinearPixels, Frame->Resolution, CachedSettings.Gamma, Planes))
-        {
-            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to convert frame to NV12 (resolution %dx%d)"), Frame->Resolution.X, Frame->Resolution.Y);
-            return false;
-        }
-        CollapsePlanesToNV12(Planes, OutData);
-        return true;
-    }
     case EPanoramaColorFormat::P010:
     {
-        const int32 Width = Frame->Resolution.X;
-        const int32 Height = Frame->Resolution.Y;
-        const int32 ExpectedSamples = Width * Height + (Width * Height) / 2;
-        const int32 ExpectedBytes = ExpectedSamples * sizeof(uint16);
-        if (Frame->PlanarVideo.Num() == ExpectedBytes)
+        const int32 BytesPerSample = (CachedSettings.ColorFormat == EPanoramaColorFormat::P010) ? sizeof(uint16) : sizeof(uint8);
+        if (!ConvertLinearToPackedPlanar(Frame->GetReadbackPixels(), Frame->Resolution, CachedSettings.ColorFormat, CachedSettings.Gamma, CachedSettings.YUVMatrix, OutData, Parallelism))
         {
-            OutData = Frame->PlanarVideo;
-            return true;
-        }
-        FP010PlaneBuffers Planes;
-        if (!ConvertLinearToP010Planes(Frame->LinearPixels, Frame->Resolution, CachedSettings.Gamma, Planes))
-        {
-            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to convert frame to P010 (resolution %dx%d)"), Frame->Resolution.X, Frame->Resolution.Y);
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to convert frame to %s (resolution %dx%d)"), BytesPerSample == 1 ? TEXT("NV12") : TEXT("P010"), Frame->Resolution.X, Frame->Resolution.Y);
             return false;
         }
-        CollapsePlanesToP010(Planes, OutData);
         return true;
     }
     case EPanoramaColorFormat::BGRA8:
     {
-        if (!ConvertLinearToBGRAPayload(Frame->LinearPixels, Frame->Resolution, CachedSettings.Gamma, OutData))
+        if (!ConvertLinearToBGRAPayload(Frame->GetReadbackPixels(), Frame->Resolution, CachedSettings.Gamma, OutData, Parallelism))
         {
             UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to convert frame to BGRA payload (resolution %dx%d)"), Frame->Resolution.X, Frame->Resolution.Y);
             return false;
@@ -607,278 +610,16 @@ bool FPanoramaNVENCEncoder::ConvertStereoToRawPayload(const TSharedPtr<FPanorama
     }
 
     const FIntPoint BaseResolution = LeftFrame->Resolution;
-    const bool bSideBySide = CachedSettings.StereoLayout == EPanoramaStereoLayout::SideBySide;
-    OutResolution = bSideBySide ? FIntPoint(BaseResolution.X * 2, BaseResolution.Y) : FIntPoint(BaseResolution.X, BaseResolution.Y * 2);
-
-    switch (CachedSettings.ColorFormat)
-    {
-    case EPanoramaColorFormat::NV12:
-    {
-        const int32 Width = BaseResolution.X;
-        const int32 Height = BaseResolution.Y;
-        const int32 PlaneYBytes = Width * Height;
-        const int32 PlaneUVBytes = (Width * Height) / 2;
-
-        const bool bHasPlanar = LeftFrame->PlanarVideo.Num() == (PlaneYBytes + PlaneUVBytes) && RightFrame->PlanarVideo.Num() == (PlaneYBytes + PlaneUVBytes);
-        if (bHasPlanar)
-        {
-            const uint8* LeftY = LeftFrame->PlanarVideo.GetData();
-            const uint8* LeftUV = LeftY + PlaneYBytes;
-            const uint8* RightY = RightFrame->PlanarVideo.GetData();
-            const uint8* RightUV = RightY + PlaneYBytes;
-
-            if (bSideBySide)
-            {
-                const int32 CombinedWidth = Width * 2;
-                const int32 CombinedYBytes = CombinedWidth * Height;
-                const int32 CombinedUVBytes = CombinedWidth * (Height / 2);
-                OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-
-                uint8* DestY = OutData.GetData();
-                for (int32 Row = 0; Row < Height; ++Row)
-                {
-                    uint8* DestRow = DestY + Row * CombinedWidth;
-                    const uint8* LeftRow = LeftY + Row * Width;
-                    const uint8* RightRow = RightY + Row * Width;
-                    FMemory::Memcpy(DestRow, LeftRow, Width);
-                    FMemory::Memcpy(DestRow + Width, RightRow, Width);
-                }
-
-                uint8* DestUV = DestY + CombinedYBytes;
-                for (int32 Row = 0; Row < Height / 2; ++Row)
-                {
-                    uint8* DestRow = DestUV + Row * CombinedWidth;
-                    const uint8* LeftRow = LeftUV + Row * Width;
-                    const uint8* RightRow = RightUV + Row * Width;
-                    FMemory::Memcpy(DestRow, LeftRow, Width);
-                    FMemory::Memcpy(DestRow + Width, RightRow, Width);
-                }
-            }
-            else
-            {
-                const int32 CombinedYBytes = PlaneYBytes * 2;
-                const int32 CombinedUVBytes = PlaneUVBytes * 2;
-                OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-                uint8* DestPtr = OutData.GetData();
-                FMemory::Memcpy(DestPtr, LeftY, PlaneYBytes);
-                FMemory::Memcpy(DestPtr + PlaneYBytes, RightY, PlaneYBytes);
-                uint8* DestUV = DestPtr + CombinedYBytes;
-                FMemory::Memcpy(DestUV, LeftUV, PlaneUVBytes);
-                FMemory::Memcpy(DestUV + PlaneUVBytes, RightUV, PlaneUVBytes);
-            }
-            return true;
-        }
-
-        FNV12PlaneBuffers LeftPlanes;
-        FNV12PlaneBuffers RightPlanes;
-        if (!ConvertLinearToNV12Planes(LeftFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, LeftPlanes))
-        {
-            return false;
-        }
-        if (!ConvertLinearToNV12Planes(RightFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, RightPlanes))
-        {
-            return false;
-        }
+    OutResolution = GetStereoResolution(BaseResolution, CachedSettings.StereoLayout);
 
-        if (bSideBySide)
-        {
-            const int32 CombinedWidth = Width * 2;
-            const int32 CombinedYBytes = CombinedWidth * Height;
-            const int32 CombinedUVBytes = CombinedWidth * (Height / 2);
-            OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-
-            uint8* DestY = OutData.GetData();
-            for (int32 Row = 0; Row < Height; ++Row)
-            {
-                uint8* DestRow = DestY + Row * CombinedWidth;
-                const uint8* LeftRow = LeftPlanes.YPlane.GetData() + Row * Width;
-                const uint8* RightRow = RightPlanes.YPlane.GetData() + Row * Width;
-                FMemory::Memcpy(DestRow, LeftRow, Width);
-                FMemory::Memcpy(DestRow + Width, RightRow, Width);
-            }
-
-            uint8* DestUV = DestY + CombinedYBytes;
-            for (int32 Row = 0; Row < Height / 2; ++Row)
-            {
-                uint8* DestRow = DestUV + Row * CombinedWidth;
-                const uint8* LeftRow = LeftPlanes.UVPlane.GetData() + Row * Width;
-                const uint8* RightRow = RightPlanes.UVPlane.GetData() + Row * Width;
-                FMemory::Memcpy(DestRow, LeftRow, Width);
-                FMemory::Memcpy(DestRow + Width, RightRow, Width);
-            }
-            return true;
-        }
-
-        const int32 CombinedYBytes = (LeftPlanes.YPlane.Num() + RightPlanes.YPlane.Num());
-        const int32 CombinedUVBytes = (LeftPlanes.UVPlane.Num() + RightPlanes.UVPlane.Num());
-        OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-
-        uint8* DestPtr = OutData.GetData();
-        FMemory::Memcpy(DestPtr, LeftPlanes.YPlane.GetData(), LeftPlanes.YPlane.Num());
-        FMemory::Memcpy(DestPtr + LeftPlanes.YPlane.Num(), RightPlanes.YPlane.GetData(), RightPlanes.YPlane.Num());
-
-        uint8* DestUV = DestPtr + CombinedYBytes;
-        FMemory::Memcpy(DestUV, LeftPlanes.UVPlane.GetData(), LeftPlanes.UVPlane.Num());
-        FMemory::Memcpy(DestUV + LeftPlanes.UVPlane.Num(), RightPlanes.UVPlane.GetData(), RightPlanes.UVPlane.Num());
-        return true;
-    }
-    case EPanoramaColorFormat::P010:
+    // Both eyes are converted straight into their half of the combined payload; no per-eye buffers or row copies.
+    const FConversionParallelism Parallelism = FConversionParallelism::FromSettings(CachedSettings);
+    if (!ConvertStereoLinearToPayload(LeftFrame->GetReadbackPixels(), RightFrame->GetReadbackPixels(), BaseResolution, CachedSettings.StereoLayout, CachedSettings.ColorFormat, CachedSettings.Gamma, CachedSettings.YUVMatrix, OutData, Parallelism))
     {
-        const int32 Width = BaseResolution.X;
-        const int32 Height = BaseResolution.Y;
-        const int32 PlaneYBytes = Width * Height * sizeof(uint16);
-        const int32 PlaneUVBytes = (Width * Height / 2) * sizeof(uint16);
-        const bool bHasPlanar = LeftFrame->PlanarVideo.Num() == (PlaneYBytes + PlaneUVBytes) && RightFrame->PlanarVideo.Num() == (PlaneYBytes + PlaneUVBytes);
-        if (bHasPlanar)
-        {
-            const uint8* LeftY = LeftFrame->PlanarVideo.GetData();
-            const uint8* LeftUV = LeftY + PlaneYBytes;
-            const uint8* RightY = RightFrame->PlanarVideo.GetData();
-            const uint8* RightUV = RightY + PlaneYBytes;
-
-            if (bSideBySide)
-            {
-                const int32 CombinedWidth = Width * 2;
-                const int32 CombinedYBytes = CombinedWidth * Height * sizeof(uint16);
-                const int32 CombinedUVBytes = CombinedWidth * (Height / 2) * sizeof(uint16);
-                OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-
-                uint8* DestY = OutData.GetData();
-                for (int32 Row = 0; Row < Height; ++Row)
-                {
-                    uint8* DestRow = DestY + Row * CombinedWidth * sizeof(uint16);
-                    const uint8* LeftRow = LeftY + Row * Width * sizeof(uint16);
-                    const uint8* RightRow = RightY + Row * Width * sizeof(uint16);
-                    FMemory::Memcpy(DestRow, LeftRow, Width * sizeof(uint16));
-                    FMemory::Memcpy(DestRow + Width * sizeof(uint16), RightRow, Width * sizeof(uint16));
-                }
-
-                uint8* DestUV = DestY + CombinedYBytes;
-                for (int32 Row = 0; Row < Height / 2; ++Row)
-                {
-                    uint8* DestRow = DestUV + Row * CombinedWidth * sizeof(uint16);
-                    const uint8* LeftRow = LeftUV + Row * Width * sizeof(uint16);
-                    const uint8* RightRow = RightUV + Row * Width * sizeof(uint16);
-                    FMemory::Memcpy(DestRow, LeftRow, Width * sizeof(uint16));
-                    FMemory::Memcpy(DestRow + Width * sizeof(uint16), RightRow, Width * sizeof(uint16));
-                }
-            }
-            else
-            {
-                const int32 CombinedYBytes = PlaneYBytes * 2;
-                const int32 CombinedUVBytes = PlaneUVBytes * 2;
-                OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-                uint8* DestPtr = OutData.GetData();
-                FMemory::Memcpy(DestPtr, LeftY, PlaneYBytes);
-                FMemory::Memcpy(DestPtr + PlaneYBytes, RightY, PlaneYBytes);
-                uint8* DestUV = DestPtr + CombinedYBytes;
-                FMemory::Memcpy(DestUV, LeftUV, PlaneUVBytes);
-                FMemory::Memcpy(DestUV + PlaneUVBytes, RightUV, PlaneUVBytes);
-            }
-            return true;
-        }
-
-        FP010PlaneBuffers LeftPlanes;
-        FP010PlaneBuffers RightPlanes;
-        if (!ConvertLinearToP010Planes(LeftFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, LeftPlanes))
-        {
-            return false;
-        }
-        if (!ConvertLinearToP010Planes(RightFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, RightPlanes))
-        {
-            return false;
-        }
-
-        if (bSideBySide)
-        {
-            const int32 CombinedWidth = Width * 2;
-            const int32 CombinedYBytes = CombinedWidth * Height * sizeof(uint16);
-            const int32 CombinedUVBytes = CombinedWidth * (Height / 2) * sizeof(uint16);
-            OutData.SetNumUninitialized(CombinedYBytes + CombinedUVBytes);
-
-            uint8* DestY = OutData.GetData();
-            for (int32 Row = 0; Row < Height; ++Row)
-            {
-                uint8* DestRow = DestY + Row * CombinedWidth * sizeof(uint16);
-                const uint16* LeftRow = LeftPlanes.YPlane.GetData() + Row * Width;
-                const uint16* RightRow = RightPlanes.YPlane.GetData() + Row * Width;
-                FMemory::Memcpy(DestRow, LeftRow, Width * sizeof(uint16));
-                FMemory::Memcpy(DestRow + Width * sizeof(uint16), RightRow, Width * sizeof(uint16));
-            }
-
-            uint8* DestUV = DestY + CombinedYBytes;
-            for (int32 Row = 0; Row < Height / 2; ++Row)
-            {
-                uint8* DestRow = DestUV + Row * CombinedWidth * sizeof(uint16);
-                const uint16* LeftRow = LeftPlanes.UVPlane.GetData() + Row * Width;
-                const uint16* RightRow = RightPlanes.UVPlane.GetData() + Row * Width;
-                FMemory::Memcpy(DestRow, LeftRow, Width * sizeof(uint16));
-                FMemory::Memcpy(DestRow + Width * sizeof(uint16), RightRow, Width * sizeof(uint16));
-            }
-            return true;
-        }
-
-        const int32 CombinedYElements = LeftPlanes.YPlane.Num() + RightPlanes.YPlane.Num();
-        const int32 CombinedUVElements = LeftPlanes.UVPlane.Num() + RightPlanes.UVPlane.Num();
-        const int32 TotalBytes = (CombinedYElements + CombinedUVElements) * sizeof(uint16);
-        OutData.SetNumUninitialized(TotalBytes);
-
-        uint8* DestPtr = OutData.GetData();
-        const int32 LeftYBytes = LeftPlanes.YPlane.Num() * sizeof(uint16);
-        const int32 RightYBytes = RightPlanes.YPlane.Num() * sizeof(uint16);
-        FMemory::Memcpy(DestPtr, LeftPlanes.YPlane.GetData(), LeftYBytes);
-        FMemory::Memcpy(DestPtr + LeftYBytes, RightPlanes.YPlane.GetData(), RightYBytes);
-
-        uint8* DestUV = DestPtr + (LeftYBytes + RightYBytes);
-        const int32 LeftUVBytes = LeftPlanes.UVPlane.Num() * sizeof(uint16);
-        const int32 RightUVBytes = RightPlanes.UVPlane.Num() * sizeof(uint16);
-        FMemory::Memcpy(DestUV, LeftPlanes.UVPlane.GetData(), LeftUVBytes);
-        FMemory::Memcpy(DestUV + LeftUVBytes, RightPlanes.UVPlane.GetData(), RightUVBytes);
-        return true;
-    }
-    case EPanoramaColorFormat::BGRA8:
-    {
-        TArray<uint8> LeftPixels;
-        TArray<uint8> RightPixels;
-        if (!ConvertLinearToBGRAPayload(LeftFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, LeftPixels))
-        {
-            return false;
-        }
-        if (!ConvertLinearToBGRAPayload(RightFrame->LinearPixels, BaseResolution, CachedSettings.Gamma, RightPixels))
-        {
-            return false;
-        }
-
-        const int32 Width = BaseResolution.X;
-        const int32 Height = BaseResolution.Y;
-        const int32 BytesPerPixel = 4;
-        if (bSideBySide)
-        {
-            const int32 CombinedWidth = Width * 2;
-            OutData.SetNumUninitialized(CombinedWidth * Height * BytesPerPixel);
-            uint8* DestPtr = OutData.GetData();
-            for (int32 Row = 0; Row < Height; ++Row)
-            {
-                const uint8* LeftRow = LeftPixels.GetData() + Row * Width * BytesPerPixel;
-                const uint8* RightRow = RightPixels.GetData() + Row * Width * BytesPerPixel;
-                uint8* DestRow = DestPtr + Row * CombinedWidth * BytesPerPixel;
-                FMemory::Memcpy(DestRow, LeftRow, Width * BytesPerPixel);
-                FMemory::Memcpy(DestRow + Width * BytesPerPixel, RightRow, Width * BytesPerPixel);
-            }
-        }
-        else
-        {
-            OutData.SetNumUninitialized(LeftPixels.Num() + RightPixels.Num());
-            FMemory::Memcpy(OutData.GetData(), LeftPixels.GetData(), LeftPixels.Num());
-            FMemory::Memcpy(OutData.GetData() + LeftPixels.Num(), RightPixels.GetData(), RightPixels.Num());
-        }
-        return true;
-    }
-    default:
-        break;
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to convert stereo pair (eye resolution %dx%d, format %d)"), BaseResolution.X, BaseResolution.Y, static_cast<int32>(CachedSettings.ColorFormat));
+        return false;
     }
-
-    return false;
+    return true;
 }
 
 void FPanoramaNVENCEncoder::WritePacketToDisk(const TArray<uint8>& PacketData)
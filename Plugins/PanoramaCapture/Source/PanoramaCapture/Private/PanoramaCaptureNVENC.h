@@ -12,6 +12,7 @@
 #endif
 
 struct FPanoramaFrame;
+class FPanoramaFramePool;
 
 /** Lightweight wrapper around NVENC hardware encoder. */
 class FPanoramaNVENCEncoder
@@ -35,6 +36,9 @@ public:
 
     void Flush();
 
+    /** Pool the converted and encoded payload buffers are drawn from and displaced readback buffers return to. */
+    void SetFramePool(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool);
+
     bool IsInitialized() const { return bInitialized; }
     bool SupportsZeroCopy() const { return bInitialized && bSupportsZeroCopy; }
     bool HasHardware() const;
@@ -66,6 +70,7 @@ private:
     int64 EncodedFrameCount;
     FIntPoint EncodedResolution;
     double LastVideoPTS;
+    TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe> FramePool;
 
 #if PANORAMA_WITH_NVENC
     struct FNVENCAPI
@@ -0,0 +1,448 @@
+#include "PanoramaCapturePNGWriter.h"
+#include "PanoramaCaptureScratchArena.h"
+#include "PanoramaCaptureLog.h"
+#include "Async/ParallelFor.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+    static constexpr int32 GBytesPerPixel = 4 * sizeof(uint16);
+
+    /** Deflate can refer back this far, so each band is primed with this much of the data before it. */
+    static constexpr int32 GDeflateWindowBytes = 32 * 1024;
+
+    /** Room for the sync flush marker and block headers beyond compressBound. */
+    static constexpr int64 GBandOutputMargin = 64;
+
+    static constexpr uint8 GPNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    /** Length, type and CRC around every chunk payload. */
+    static constexpr int64 GChunkOverhead = 12;
+
+    static_assert(PLATFORM_LITTLE_ENDIAN, "Row byte swapping assumes little-endian samples");
+
+    void WriteBigEndian32(uint8* Destination, uint32 Value)
+    {
+        Destination[0] = static_cast<uint8>(Value >> 24);
+        Destination[1] = static_cast<uint8>(Value >> 16);
+        Destination[2] = static_cast<uint8>(Value >> 8);
+        Destination[3] = static_cast<uint8>(Value);
+    }
+
+    /** Copies one row of native uint16 samples into the big-endian byte order PNG filters operate on. */
+    void SwapRowToBigEndian(const uint16* Source, uint8* Destination, int32 NumSamples)
+    {
+        for (int32 Index = 0; Index < NumSamples; ++Index)
+        {
+            const uint16 Sample = Source[Index];
+            Destination[Index * 2] = static_cast<uint8>(Sample >> 8);
+            Destination[Index * 2 + 1] = static_cast<uint8>(Sample);
+        }
+    }
+
+    FORCEINLINE uint8 PaethPredictor(int32 Left, int32 Above, int32 UpperLeft)
+    {
+        const int32 Estimate = Left + Above - UpperLeft;
+        const int32 DistanceLeft = FMath::Abs(Estimate - Left);
+        const int32 DistanceAbove = FMath::Abs(Estimate - Above);
+        const int32 DistanceUpperLeft = FMath::Abs(Estimate - UpperLeft);
+        if (DistanceLeft <= DistanceAbove && DistanceLeft <= DistanceUpperLeft)
+        {
+            return static_cast<uint8>(Left);
+        }
+        return static_cast<uint8>(DistanceAbove <= DistanceUpperLeft ? Above : UpperLeft);
+    }
+
+    template <EPanoramaPNGRowFilter Filter>
+    FORCEINLINE uint8 FilterByte(const uint8* Row, const uint8* PreviousRow, int32 Index)
+    {
+        const int32 Left = Index >= GBytesPerPixel ? Row[Index - GBytesPerPixel] : 0;
+        const int32 Above = PreviousRow[Index];
+        const int32 UpperLeft = Index >= GBytesPerPixel ? PreviousRow[Index - GBytesPerPixel] : 0;
+        switch (Filter)
+        {
+        case EPanoramaPNGRowFilter::Sub:
+            return static_cast<uint8>(Row[Index] - Left);
+        case EPanoramaPNGRowFilter::Up:
+            return static_cast<uint8>(Row[Index] - Above);
+        case EPanoramaPNGRowFilter::Average:
+            return static_cast<uint8>(Row[Index] - ((Left + Above) >> 1));
+        case EPanoramaPNGRowFilter::Paeth:
+            return static_cast<uint8>(Row[Index] - PaethPredictor(Left, Above, UpperLeft));
+        default:
+            return Row[Index];
+        }
+    }
+
+    /** One loop per filter type, so the fixed-filter profiles run a branch-free loop the compiler can vectorize. */
+    template <EPanoramaPNGRowFilter Filter>
+    void FilterRowWith(const uint8* Row, const uint8* PreviousRow, int32 RowBytes, uint8* Destination)
+    {
+        Destination[0] = static_cast<uint8>(Filter);
+        for (int32 Index = 0; Index < RowBytes; ++Index)
+        {
+            Destination[Index + 1] = FilterByte<Filter>(Row, PreviousRow, Index);
+        }
+    }
+
+    /** The libpng heuristic: the filter whose output has the smallest sum of bytes read as signed magnitudes. */
+    EPanoramaPNGRowFilter ChooseAdaptiveFilter(const uint8* Row, const uint8* PreviousRow, int32 RowBytes)
+    {
+        auto Magnitude = [](int32 Value) -> uint64
+        {
+            return static_cast<uint64>(FMath::Abs(static_cast<int32>(static_cast<int8>(static_cast<uint8>(Value)))));
+        };
+
+        constexpr int32 NumFilters = 5;
+        uint64 Sums[NumFilters] = {};
+        for (int32 Index = 0; Index < RowBytes; ++Index)
+        {
+            const int32 Value = Row[Index];
+            const int32 Left = Index >= GBytesPerPixel ? Row[Index - GBytesPerPixel] : 0;
+            const int32 Above = PreviousRow[Index];
+            const int32 UpperLeft = Index >= GBytesPerPixel ? PreviousRow[Index - GBytesPerPixel] : 0;
+            Sums[0] += Magnitude(Value);
+            Sums[1] += Magnitude(Value - Left);
+            Sums[2] += Magnitude(Value - Above);
+            Sums[3] += Magnitude(Value - ((Left + Above) >> 1));
+            Sums[4] += Magnitude(Value - PaethPredictor(Left, Above, UpperLeft));
+        }
+
+        int32 BestFilter = 0;
+        for (int32 FilterIndex = 1; FilterIndex < NumFilters; ++FilterIndex)
+        {
+            if (Sums[FilterIndex] < Sums[BestFilter])
+            {
+                BestFilter = FilterIndex;
+            }
+        }
+        return static_cast<EPanoramaPNGRowFilter>(BestFilter);
+    }
+
+    void FilterRow(EPanoramaPNGRowFilter Filter, const uint8* Row, const uint8* PreviousRow, int32 RowBytes, uint8* Destination)
+    {
+        if (Filter == EPanoramaPNGRowFilter::Adaptive)
+        {
+            Filter = ChooseAdaptiveFilter(Row, PreviousRow, RowBytes);
+        }
+
+        switch (Filter)
+        {
+        case EPanoramaPNGRowFilter::Sub:
+            FilterRowWith<EPanoramaPNGRowFilter::Sub>(Row, PreviousRow, RowBytes, Destination);
+            break;
+        case EPanoramaPNGRowFilter::Up:
+            FilterRowWith<EPanoramaPNGRowFilter::Up>(Row, PreviousRow, RowBytes, Destination);
+            break;
+        case EPanoramaPNGRowFilter::Average:
+            FilterRowWith<EPanoramaPNGRowFilter::Average>(Row, PreviousRow, RowBytes, Destination);
+            break;
+        case EPanoramaPNGRowFilter::Paeth:
+            FilterRowWith<EPanoramaPNGRowFilter::Paeth>(Row, PreviousRow, RowBytes, Destination);
+            break;
+        default:
+            FilterRowWith<EPanoramaPNGRowFilter::None>(Row, PreviousRow, RowBytes, Destination);
+            break;
+        }
+    }
+
+    /** zlib stream header for a 32 KB window, with the level hint zlib itself would write. */
+    void WriteZlibHeader(uint8* Destination, int32 CompressionLevel)
+    {
+        const uint32 LevelFlags = CompressionLevel < 2 ? 0 : (CompressionLevel < 6 ? 1 : (CompressionLevel == 6 ? 2 : 3));
+        uint32 Header = (0x78u << 8) | (LevelFlags << 6);
+        Header += 31 - (Header % 31);
+        Destination[0] = static_cast<uint8>(Header >> 8);
+        Destination[1] = static_cast<uint8>(Header);
+    }
+
+    struct FDeflateBand
+    {
+        int64 InputOffset = 0;
+        int64 InputBytes = 0;
+        uint8* Output = nullptr;
+        int64 OutputCapacity = 0;
+        int64 OutputBytes = 0;
+        uLong Adler = 0;
+        bool bSuccess = false;
+    };
+}
+
+FPanoramaPNGWriteOptions FPanoramaPNGWriteOptions::FromProfile(EPanoramaPNGProfile Profile)
+{
+    FPanoramaPNGWriteOptions Options;
+    switch (Profile)
+    {
+    case EPanoramaPNGProfile::Fastest:
+        // Up needs no per-byte decision and vectorizes; level 1 runs deflate's fast matcher without lazy evaluation.
+        Options.CompressionLevel = 1;
+        Options.Filter = EPanoramaPNGRowFilter::Up;
+        break;
+    case EPanoramaPNGProfile::Archival:
+        // Fewer bands mean fewer sync flush markers and dictionary restarts, worth it when size matters most.
+        Options.CompressionLevel = 9;
+        Options.Filter = EPanoramaPNGRowFilter::Adaptive;
+        Options.BandBytes = 4 * 1024 * 1024;
+        break;
+    default:
+        Options.CompressionLevel = 6;
+        Options.Filter = EPanoramaPNGRowFilter::Adaptive;
+        break;
+    }
+    return Options;
+}
+
+FPanoramaPNGWriter::~FPanoramaPNGWriter()
+{
+    FreeStreams();
+}
+
+bool FPanoramaPNGWriter::EncodeRGBA16(TArrayView<const uint16> Pixels, const FIntPoint& Resolution, const FPanoramaPNGWriteOptions& Options, FPanoramaScratchArena& Scratch, TArray64<uint8>& OutPNG)
+{
+    const int32 Width = Resolution.X;
+    const int32 Height = Resolution.Y;
+    if (Width <= 0 || Height <= 0 || Pixels.Num() < static_cast<int64>(Width) * Height * 4)
+    {
+        return false;
+    }
+
+    const int32 CompressionLevel = FMath::Clamp(Options.CompressionLevel, 0, 9);
+    const EParallelForFlags ParallelFlags = Options.bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+    const int32 RowBytes = Width * GBytesPerPixel;
+    const int64 FilteredRowBytes = static_cast<int64>(RowBytes) + 1;
+    const int32 RowsPerBand = static_cast<int32>(FMath::Clamp<int64>(Options.BandBytes / FilteredRowBytes, 1, Height));
+    const int32 NumBands = FMath::DivideAndRoundUp(Height, RowsPerBand);
+
+    // Everything the parallel phases write is carved out here, since the arena is owned by this thread only.
+    uint8* Filtered = static_cast<uint8*>(Scratch.Allocate(FilteredRowBytes * Height));
+    uint8* RowScratch = static_cast<uint8*>(Scratch.Allocate(static_cast<int64>(RowBytes) * 2 * NumBands));
+    TArrayView<FDeflateBand> Bands = Scratch.AllocateArray<FDeflateBand>(NumBands);
+    if (!Filtered || !RowScratch || Bands.Num() != NumBands)
+    {
+        return false;
+    }
+
+    for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+    {
+        const int32 FirstRow = BandIndex * RowsPerBand;
+        const int32 NumRows = FMath::Min(RowsPerBand, Height - FirstRow);
+        FDeflateBand& Band = Bands[BandIndex];
+        Band = FDeflateBand();
+        Band.InputOffset = FirstRow * FilteredRowBytes;
+        Band.InputBytes = NumRows * FilteredRowBytes;
+        Band.OutputCapacity = static_cast<int64>(compressBound(static_cast<uLong>(Band.InputBytes))) + GBandOutputMargin;
+        Band.Output = static_cast<uint8*>(Scratch.Allocate(Band.OutputCapacity));
+        if (!Band.Output)
+        {
+            return false;
+        }
+    }
+
+    // Phase 1: filter. Each band swaps its rows to big endian through two private row buffers; the row above the band
+    // is swapped again rather than shared, so bands need nothing from each other.
+    const EPanoramaPNGRowFilter Filter = Options.Filter;
+    ParallelFor(NumBands, [&](int32 BandIndex)
+    {
+        uint8* CurrentRow = RowScratch + static_cast<int64>(RowBytes) * 2 * BandIndex;
+        uint8* PreviousRow = CurrentRow + RowBytes;
+        const int32 FirstRow = BandIndex * RowsPerBand;
+        const int32 EndRow = FMath::Min(FirstRow + RowsPerBand, Height);
+        if (FirstRow > 0)
+        {
+            SwapRowToBigEndian(Pixels.GetData() + static_cast<int64>(FirstRow - 1) * Width * 4, PreviousRow, Width * 4);
+        }
+        else
+        {
+            FMemory::Memzero(PreviousRow, RowBytes);
+        }
+
+        for (int32 Row = FirstRow; Row < EndRow; ++Row)
+        {
+            SwapRowToBigEndian(Pixels.GetData() + static_cast<int64>(Row) * Width * 4, CurrentRow, Width * 4);
+            FilterRow(Filter, CurrentRow, PreviousRow, RowBytes, Filtered + Row * FilteredRowBytes);
+            Swap(CurrentRow, PreviousRow);
+        }
+    }, ParallelFlags);
+
+    // Phase 2: deflate every band as raw deflate. Sync flushes end each band on a byte boundary without a final block,
+    // so the outputs concatenate into one stream; the dictionary keeps matches across band edges as good as serial.
+    ParallelFor(NumBands, [&](int32 BandIndex)
+    {
+        FDeflateBand& Band = Bands[BandIndex];
+        const bool bLastBand = BandIndex == NumBands - 1;
+        const uint8* Input = Filtered + Band.InputOffset;
+        Band.Adler = adler32(adler32(0L, Z_NULL, 0), Input, static_cast<uInt>(Band.InputBytes));
+
+        z_stream_s* Stream = AcquireStream(CompressionLevel);
+        if (!Stream)
+        {
+            return;
+        }
+
+        bool bStreamOk = true;
+        if (Band.InputOffset > 0)
+        {
+            const int64 DictionaryBytes = FMath::Min<int64>(Band.InputOffset, GDeflateWindowBytes);
+            bStreamOk = deflateSetDictionary(Stream, Input - DictionaryBytes, static_cast<uInt>(DictionaryBytes)) == Z_OK;
+        }
+
+        if (bStreamOk)
+        {
+            Stream->next_in = const_cast<Bytef*>(Input);
+            Stream->avail_in = static_cast<uInt>(Band.InputBytes);
+            Stream->next_out = Band.Output;
+            Stream->avail_out = static_cast<uInt>(Band.OutputCapacity);
+            const int32 Result = deflate(Stream, bLastBand ? Z_FINISH : Z_SYNC_FLUSH);
+
+            // The output is sized past the worst case, so one call must consume everything and leave room to spare.
+            Band.bSuccess = bLastBand ? Result == Z_STREAM_END : (Result == Z_OK && Stream->avail_in == 0 && Stream->avail_out > 0);
+            Band.OutputBytes = Band.OutputCapacity - Stream->avail_out;
+        }
+
+        ReleaseStream(Stream);
+    }, ParallelFlags);
+
+    // Stitch: one IDAT per band, the zlib header ahead of the first and the combined Adler-32 after the last.
+    uLong Adler = Bands[0].Adler;
+    int64 TotalBytes = sizeof(GPNGSignature) + (GChunkOverhead + 13) + GChunkOverhead;
+    for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+    {
+        const FDeflateBand& Band = Bands[BandIndex];
+        if (!Band.bSuccess)
+        {
+            UE_LOG(LogPanoramaCapture, Warning, TEXT("PNG deflate failed on band %d of %d"), BandIndex, NumBands);
+            return false;
+        }
+        if (BandIndex > 0)
+        {
+            Adler = adler32_combine(Adler, Band.Adler, static_cast<z_off_t>(Band.InputBytes));
+        }
+        TotalBytes += GChunkOverhead + Band.OutputBytes;
+    }
+    TotalBytes += 2 + 4;
+
+    OutPNG.SetNumUninitialized(TotalBytes, EAllowShrinking::No);
+    uint8* Cursor = OutPNG.GetData();
+    TArray<TPair<int64, int64>, TInlineAllocator<64>> Chunks;
+
+    auto BeginChunk = [&](const char* Type, int64 DataBytes)
+    {
+        WriteBigEndian32(Cursor, static_cast<uint32>(DataBytes));
+        FMemory::Memcpy(Cursor + 4, Type, 4);
+        Chunks.Emplace(Cursor + 4 - OutPNG.GetData(), DataBytes + 4);
+        Cursor += 8;
+    };
+    auto EndChunk = [&]()
+    {
+        Cursor += 4;
+    };
+
+    FMemory::Memcpy(Cursor, GPNGSignature, sizeof(GPNGSignature));
+    Cursor += sizeof(GPNGSignature);
+
+    BeginChunk("IHDR", 13);
+    WriteBigEndian32(Cursor, static_cast<uint32>(Width));
+    WriteBigEndian32(Cursor + 4, static_cast<uint32>(Height));
+    Cursor[8] = 16;
+    Cursor[9] = 6;
+    Cursor[10] = 0;
+    Cursor[11] = 0;
+    Cursor[12] = 0;
+    Cursor += 13;
+    EndChunk();
+
+    for (int32 BandIndex = 0; BandIndex < NumBands; ++BandIndex)
+    {
+        const FDeflateBand& Band = Bands[BandIndex];
+        const bool bFirstBand = BandIndex == 0;
+        const bool bLastBand = BandIndex == NumBands - 1;
+        BeginChunk("IDAT", Band.OutputBytes + (bFirstBand ? 2 : 0) + (bLastBand ? 4 : 0));
+        if (bFirstBand)
+        {
+            WriteZlibHeader(Cursor, CompressionLevel);
+            Cursor += 2;
+        }
+        FMemory::Memcpy(Cursor, Band.Output, Band.OutputBytes);
+        Cursor += Band.OutputBytes;
+        if (bLastBand)
+        {
+            WriteBigEndian32(Cursor, static_cast<uint32>(Adler));
+            Cursor += 4;
+        }
+        EndChunk();
+    }
+
+    BeginChunk("IEND", 0);
+    EndChunk();
+    check(Cursor == OutPNG.GetData() + TotalBytes);
+
+    // Chunk CRCs cover the type and payload; the big IDATs are independent, so they are checksummed in parallel too.
+    uint8* FileData = OutPNG.GetData();
+    ParallelFor(Chunks.Num(), [&Chunks, FileData](int32 ChunkIndex)
+    {
+        const int64 Offset = Chunks[ChunkIndex].Key;
+        const int64 NumBytes = Chunks[ChunkIndex].Value;
+        const uLong Crc = crc32(crc32(0L, Z_NULL, 0), FileData + Offset, static_cast<uInt>(NumBytes));
+        WriteBigEndian32(FileData + Offset + NumBytes, static_cast<uint32>(Crc));
+    }, ParallelFlags);
+
+    return true;
+}
+
+z_stream_s* FPanoramaPNGWriter::AcquireStream(int32 CompressionLevel)
+{
+    {
+        FScopeLock Lock(&StreamCriticalSection);
+        if (StreamLevel != CompressionLevel)
+        {
+            for (z_stream_s* Stream : IdleStreams)
+            {
+                deflateEnd(Stream);
+                delete Stream;
+            }
+            IdleStreams.Reset();
+            StreamLevel = CompressionLevel;
+        }
+
+        if (IdleStreams.Num() > 0)
+        {
+            z_stream_s* Stream = IdleStreams.Pop();
+            if (deflateReset(Stream) == Z_OK)
+            {
+                return Stream;
+            }
+            deflateEnd(Stream);
+            delete Stream;
+        }
+    }
+
+    // Negative window bits give raw deflate: the zlib header and checksum are written once for the whole image.
+    z_stream_s* Stream = new z_stream_s();
+    if (deflateInit2(Stream, CompressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        delete Stream;
+        return nullptr;
+    }
+    return Stream;
+}
+
+void FPanoramaPNGWriter::ReleaseStream(z_stream_s* Stream)
+{
+    FScopeLock Lock(&StreamCriticalSection);
+    IdleStreams.Add(Stream);
+}
+
+void FPanoramaPNGWriter::FreeStreams()
+{
+    FScopeLock Lock(&StreamCriticalSection);
+    for (z_stream_s* Stream : IdleStreams)
+    {
+        deflateEnd(Stream);
+        delete Stream;
+    }
+    IdleStreams.Empty();
+    StreamLevel = -1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "PanoramaCaptureTypes.h"
+
+class FPanoramaScratchArena;
+struct z_stream_s;
+
+/** PNG row filter. The first five values are the filter type bytes of the PNG specification. */
+enum class EPanoramaPNGRowFilter : uint8
+{
+    None = 0,
+    Sub = 1,
+    Up = 2,
+    Average = 3,
+    Paeth = 4,
+    /** Per row, the filter with the smallest sum of absolute signed bytes, as libpng does by default. */
+    Adaptive = 5
+};
+
+struct FPanoramaPNGWriteOptions
+{
+    /** zlib level, 0 (stored) to 9. */
+    int32 CompressionLevel = 6;
+
+    EPanoramaPNGRowFilter Filter = EPanoramaPNGRowFilter::Adaptive;
+
+    /** Filtered bytes per independently deflated band; rounded to whole rows. */
+    int32 BandBytes = 1024 * 1024;
+
+    /** Filter and deflate bands on task graph workers. */
+    bool bParallel = true;
+
+    static FPanoramaPNGWriteOptions FromProfile(EPanoramaPNGProfile Profile);
+};
+
+/**
+ * Native 16-bit RGBA PNG encoder that splits one image across cores, pigz style. Rows are filtered in parallel, the
+ * filtered data is cut into row bands that are raw-deflated concurrently (each primed with the previous 32 KB as a
+ * dictionary and ended with a sync flush so the pieces concatenate), and the bands are stitched into one zlib stream
+ * with a combined Adler-32, written as consecutive IDAT chunks. Output is a standard PNG. Deflate streams are kept
+ * between images; one writer may only encode one image at a time.
+ */
+class FPanoramaPNGWriter
+{
+public:
+    ~FPanoramaPNGWriter();
+
+    /**
+     * Encodes Resolution.X * Resolution.Y native-endian RGBA16 pixels into a complete PNG file in OutPNG, which keeps
+     * its allocation across calls. Filtered rows and deflate output are staged in Scratch.
+     */
+    bool EncodeRGBA16(TArrayView<const uint16> Pixels, const FIntPoint& Resolution, const FPanoramaPNGWriteOptions& Options, FPanoramaScratchArena& Scratch, TArray64<uint8>& OutPNG);
+
+private:
+    z_stream_s* AcquireStream(int32 CompressionLevel);
+    void ReleaseStream(z_stream_s* Stream);
+    void FreeStreams();
+
+    /** Idle raw-deflate streams, all initialized at StreamLevel. Guards against concurrent band tasks. */
+    FCriticalSection StreamCriticalSection;
+    TArray<z_stream_s*> IdleStreams;
+    int32 StreamLevel = -1;
+};
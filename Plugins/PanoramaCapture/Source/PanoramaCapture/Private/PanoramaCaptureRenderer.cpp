@@ -1,7 +1,9 @@
 #include "PanoramaCaptureRenderer.h"
 #include "PanoramaCaptureComponent.h"
 #include "PanoramaCaptureFrame.h"
+#include "PanoramaCaptureFramePool.h"
 #include "PanoramaCaptureColorConversion.h"
+#include "PanoramaCaptureTransferLUT.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "Components/SceneCaptureComponent2D.h"
 #include "RenderGraphBuilder.h"
@@ -14,6 +16,12 @@
 #include "Misc/App.h"
 #include "HAL/PlatformTime.h"
 
+namespace
+{
+    /** Equirect shader mode that writes unclamped scene-linear light instead of applying EPanoramaGamma. */
+    static constexpr int32 GSceneLinearGammaMode = 3;
+}
+
 class FPanoramaEquirectCS : public FGlobalShader
 {
     DECLARE_GLOBAL_SHADER(FPanoramaEquirectCS);
@@ -24,6 +32,7 @@ class FPanoramaEquirectCS : public FGlobalShader
         SHADER_PARAMETER(int32, EyeIndex)
         SHADER_PARAMETER(int32, GammaMode)
         SHADER_PARAMETER(float, Padding)
+        SHADER_PARAMETER(float, HDRScale)
         SHADER_PARAMETER_RDG_TEXTURE(Texture2D, FacePX)
         SHADER_PARAMETER_RDG_TEXTURE(Texture2D, FaceNX)
         SHADER_PARAMETER_RDG_TEXTURE(Texture2D, FacePY)
@@ -59,6 +68,7 @@ FPanoramaCaptureRenderer::FPanoramaCaptureRenderer()
     , PreviewIntervalSeconds(1.0f / 30.0f)
     , LastPreviewSubmitSeconds(0.0)
     , bPreviewUpdatesEnabled(true)
+    , NextFrameId(1)
 {
     bRenderCommandQueued = false;
 }
@@ -95,7 +105,12 @@ void FPanoramaCaptureRenderer::SetOutputTargets(UTextureRenderTarget2D* LeftTarg
     }
 }
 
-void FPanoramaCaptureRenderer::CaptureFrame(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady)
+void FPanoramaCaptureRenderer::SetFramePool(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool)
+{
+    FramePool = InFramePool;
+}
+
+void FPanoramaCaptureRenderer::CaptureFrame(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady)
 {
     if (!bInitialized || bRenderCommandQueued)
     {
@@ -111,7 +126,7 @@ void FPanoramaCaptureRenderer::CaptureFrame(UPanoramaCaptureComponent* Component
     DispatchRenderCommand(Component, VideoSettings, CaptureStartTimeSeconds, bEnableNVENCZeroCopy, MoveTemp(OnFrameReady));
 }
 
-void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady)
+void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady)
 {
     UTextureRenderTarget2D* MonoTextureTarget = MonoTarget.Get();
     if (!MonoTextureTarget)
@@ -196,6 +211,7 @@ void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent*
     }
 
     const double Timestamp = FPlatformTime::Seconds() - CaptureStartTimeSeconds;
+    const uint64 FrameId = NextFrameId++;
 
     bool bLocalPreviewEnabled = false;
     {
@@ -203,7 +219,7 @@ void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent*
         bLocalPreviewEnabled = bPreviewUpdatesEnabled;
     }
 
-    ENQUEUE_RENDER_COMMAND(DispatchPanoramaEquirect)([this, VideoSettings, MonoTargetRHI, StereoTargetRHI, PreviewTargetRHI, LeftFaceTextures, RightFaceTextures, Timestamp, bEnableNVENCZeroCopy, Callback = MoveTemp(OnFrameReady), bLocalPreviewEnabled](FRHICommandListImmediate& RHICmdList) mutable
+    ENQUEUE_RENDER_COMMAND(DispatchPanoramaEquirect)([this, VideoSettings, MonoTargetRHI, StereoTargetRHI, PreviewTargetRHI, LeftFaceTextures, RightFaceTextures, Timestamp, FrameId, bEnableNVENCZeroCopy, Callback = MoveTemp(OnFrameReady), bLocalPreviewEnabled, Pool = FramePool](FRHICommandListImmediate& RHICmdList) mutable
     {
         if (!MonoTargetRHI.IsValid())
         {
@@ -308,9 +324,10 @@ void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent*
             }
         }
 
-        auto ReadLinearPixels = [&RHICmdList](const FTexture2DRHIRef& SourceTexture, TArray<FFloat16Color>& OutPixels)
+        // Readback goes into a recycled pool buffer when one is idle; whether ReadSurfaceFloatData keeps its capacity
+        // depends on the RHI.
+        auto PopulateReadback = [&RHICmdList, &Pool](FPanoramaFrame& Frame, const FTexture2DRHIRef& SourceTexture)
         {
-            OutPixels.Reset();
             if (!SourceTexture.IsValid())
             {
                 return;
@@ -322,94 +339,88 @@ void FPanoramaCaptureRenderer::DispatchRenderCommand(UPanoramaCaptureComponent*
                 return;
             }
 
+            TArray<FFloat16Color> Pixels = Pool.IsValid() ? Pool->AcquirePixelBuffer() : TArray<FFloat16Color>();
             const FIntRect ReadRect(0, 0, Size.X, Size.Y);
-            RHICmdList.ReadSurfaceFloatData(SourceTexture, ReadRect, OutPixels, CubeFace_MAX, 0, 0);
+            RHICmdList.ReadSurfaceFloatData(SourceTexture, ReadRect, Pixels, CubeFace_MAX, 0, 0);
+            Frame.Timings.ReadbackCycles = FPlatformTime::Cycles64();
+            Frame.SetReadback(MoveTemp(Pixels), Size);
         };
 
-        auto PopulatePlanarPayload = [&VideoSettings](const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame)
+        auto PopulatePlanarPayload = [&VideoSettings, &Pool](FPanoramaFrame& Frame)
         {
-            if (!Frame.IsValid())
+            // Stereo pairs are converted together by the encoder directly into the combined layout.
+            if (VideoSettings.OutputFormat != EPanoramaOutputFormat::NVENC || VideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo)
             {
                 return;
             }
 
-            if (VideoSettings.OutputFormat != EPanoramaOutputFormat::NVENC)
+            const FPanoramaReadbackPayload* Readback = Frame.GetReadback();
+            if (!Readback)
             {
                 return;
             }
 
-            switch (VideoSettings.ColorFormat)
+            const PanoramaCapture::Color::FConversionParallelism Parallelism = PanoramaCapture::Color::FConversionParallelism::FromSettings(VideoSettings);
+            TArray<uint8> Planar = Pool.IsValid() ? Pool->AcquireByteBuffer() : TArray<uint8>();
+            if (PanoramaCapture::Color::ConvertLinearToPackedPlanar(Readback->Pixels, Frame.Resolution, VideoSettings.ColorFormat, VideoSettings.Gamma, VideoSettings.YUVMatrix, Planar, Parallelism))
             {
-            case EPanoramaColorFormat::NV12:
-            {
-                PanoramaCapture::Color::FNV12PlaneBuffers Planes;
-                if (PanoramaCapture::Color::ConvertLinearToNV12Planes(Frame->LinearPixels, Frame->Resolution, VideoSettings.Gamma, Planes))
-                {
-                    PanoramaCapture::Color::CollapsePlanesToNV12(Planes, Frame->PlanarVideo);
-                }
-                break;
-            }
-            case EPanoramaColorFormat::P010:
-            {
-                PanoramaCapture::Color::FP010PlaneBuffers Planes;
-                if (PanoramaCapture::Color::ConvertLinearToP010Planes(Frame->LinearPixels, Frame->Resolution, VideoSettings.Gamma, Planes))
+                // The readback buffer leaves the frame as the converted payload replaces it.
+                FPanoramaFramePayload Pixels = Frame.TakePayload();
+                Frame.SetConverted(MoveTemp(Planar), Frame.Resolution, VideoSettings.ColorFormat);
+                if (Pool.IsValid())
                 {
-                    PanoramaCapture::Color::CollapsePlanesToP010(Planes, Frame->PlanarVideo);
+                    Pool->Recycle(MoveTemp(Pixels));
                 }
-                break;
-            }
-            default:
-                break;
             }
+        };
 
-            if (Frame->PlanarVideo.Num() > 0)
-            {
-                Frame->LinearPixels.Reset();
-            }
+        auto AcquireFrame = [&Pool]()
+        {
+            return Pool.IsValid() ? Pool->Acquire() : MakeShared<FPanoramaFrame, ESPMode::ThreadSafe>();
         };
 
         if (Callback)
         {
-            TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> LeftFrame = MakeShared<FPanoramaFrame, ESPMode::ThreadSafe>();
+            const bool bZeroCopyReady = bWantsZeroCopyBGRA && NVENCCombinedRHI.IsValid();
+            const bool bNeedsReadback = VideoSettings.OutputFormat != EPanoramaOutputFormat::NVENC || !bZeroCopyReady;
+
+            TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> LeftFrame = AcquireFrame();
             LeftFrame->EyeIndex = 0;
+            LeftFrame->FrameId = FrameId;
             LeftFrame->TimestampSeconds = Timestamp;
-            LeftFrame->Format = MonoTargetRHI->GetFormat();
             LeftFrame->bIsStereo = VideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo;
-            LeftFrame->Texture = MonoTargetRHI;
             LeftFrame->Resolution = FIntPoint(MonoTargetRHI->GetSizeX(), MonoTargetRHI->GetSizeY());
-            LeftFrame->ColorFormat = VideoSettings.ColorFormat;
-            if (VideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence || !bWantsZeroCopyBGRA || !NVENCCombinedRHI.IsValid())
+            if (bNeedsReadback)
             {
-                ReadLinearPixels(MonoTargetRHI, LeftFrame->LinearPixels);
+                PopulateReadback(*LeftFrame, MonoTargetRHI);
+                if (!bWantsZeroCopyBGRA)
+                {
+                    PopulatePlanarPayload(*LeftFrame);
+                }
             }
-            if (!bWantsZeroCopyBGRA)
+            else
             {
-                PopulatePlanarPayload(LeftFrame);
+                // The left eye carries the combined texture for both eyes.
+                LeftFrame->Timings.ReadbackCycles = FPlatformTime::Cycles64();
+                LeftFrame->SetGPUTexture(NVENCCombinedRHI, FIntPoint(NVENCCombinedRHI->GetSizeX(), NVENCCombinedRHI->GetSizeY()));
             }
-            LeftFrame->NVENCTexture = (bWantsZeroCopyBGRA && NVENCCombinedRHI.IsValid()) ? NVENCCombinedRHI : nullptr;
-            LeftFrame->NVENCResolution = (bWantsZeroCopyBGRA && NVENCCombinedRHI.IsValid()) ? FIntPoint(NVENCCombinedRHI->GetSizeX(), NVENCCombinedRHI->GetSizeY()) : LeftFrame->Resolution;
-            Callback(LeftFrame);
 
+            // Both eyes are handed over together so the queue can admit or drop the capture as a unit.
+            TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> RightFrame;
             if (VideoSettings.CaptureMode == EPanoramaCaptureMode::Stereo && OutputRight)
             {
-                TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> RightFrame = MakeShared<FPanoramaFrame, ESPMode::ThreadSafe>();
+                RightFrame = AcquireFrame();
                 RightFrame->EyeIndex = 1;
+                RightFrame->FrameId = FrameId;
                 RightFrame->TimestampSeconds = Timestamp;
-                RightFrame->Format = StereoTargetRHI.IsValid() ? StereoTargetRHI->GetFormat() : PF_FloatRGBA;
                 RightFrame->bIsStereo = true;
-                RightFrame->Texture = StereoTargetRHI;
                 RightFrame->Resolution = StereoTargetRHI.IsValid() ? FIntPoint(StereoTargetRHI->GetSizeX(), StereoTargetRHI->GetSizeY()) : LeftFrame->Resolution;
-                RightFrame->ColorFormat = VideoSettings.ColorFormat;
-                if (VideoSettings.OutputFormat == EPanoramaOutputFormat::PNGSequence || !bWantsZeroCopyBGRA || !NVENCCombinedRHI.IsValid())
-                {
-                    ReadLinearPixels(StereoTargetRHI, RightFrame->LinearPixels);
-                }
-                if (!bWantsZeroCopyBGRA)
+                if (bNeedsReadback)
                 {
-                    PopulatePlanarPayload(RightFrame);
+                    PopulateReadback(*RightFrame, StereoTargetRHI);
                 }
-                Callback(RightFrame);
             }
+            Callback(LeftFrame, RightFrame);
         }
 
         bRenderCommandQueued = false;
@@ -426,10 +437,12 @@ void AddPanoramaEquirectPass(FRDGBuilder& GraphBuilder, const TArray<FRDGTexture
     FPanoramaEquirectCS::FParameters* Parameters = GraphBuilder.AllocParameters<FPanoramaEquirectCS::FParameters>();
     Parameters->OutputResolution = OutputTexture->Desc.Extent;
     Parameters->EyeIndex = EyeIndex;
-    Parameters->GammaMode = static_cast<int32>(Settings.Gamma);
+    // EXR frames carry the scene's full range; the muxer applies Gamma's transfer when it encodes them.
+    Parameters->GammaMode = Settings.OutputFormat == EPanoramaOutputFormat::EXRSequence ? GSceneLinearGammaMode : static_cast<int32>(Settings.Gamma);
     const float MaxExtent = static_cast<float>(FMath::Max(OutputTexture->Desc.Extent.X, OutputTexture->Desc.Extent.Y));
     const float SeamFix = (MaxExtent > 0.f) ? FMath::Clamp(Settings.SeamFixTexels / MaxExtent, 0.0f, 0.25f) : 0.0f;
     Parameters->Padding = SeamFix;
+    Parameters->HDRScale = static_cast<float>(Settings.HDRPaperWhiteNits / PanoramaCapture::Color::TransferLUT::PQInputNits);
     Parameters->FacePX = FaceTextures[0];
     Parameters->FaceNX = FaceTextures[1];
     Parameters->FacePY = FaceTextures[2];
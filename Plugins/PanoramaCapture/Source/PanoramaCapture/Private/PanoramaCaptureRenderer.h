@@ -7,6 +7,7 @@
 class UPanoramaCaptureComponent;
 class UTextureRenderTarget2D;
 struct FPanoramaFrame;
+class FPanoramaFramePool;
 
 /** Responsible for issuing scene capture updates and dispatching the equirect compute shader. */
 class FRDGBuilder;
@@ -22,12 +23,16 @@ public:
 
     bool IsInitialized() const { return bInitialized; }
 
-    void CaptureFrame(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady);
+    /** Called back on the render thread with the left eye (or mono frame) and, for stereo, the right eye of the same capture. */
+    void CaptureFrame(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady);
 
     void SetOutputTargets(UTextureRenderTarget2D* LeftTarget, UTextureRenderTarget2D* RightTarget, UTextureRenderTarget2D* PreviewTarget, float PreviewInterval, bool bPreviewEnabled);
 
+    /** Pool captured frames are drawn from. Without one every capture allocates fresh frames. */
+    void SetFramePool(const TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe>& InFramePool);
+
 private:
-    void DispatchRenderCommand(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady);
+    void DispatchRenderCommand(UPanoramaCaptureComponent* Component, const FPanoramicVideoSettings& VideoSettings, double CaptureStartTimeSeconds, bool bEnableNVENCZeroCopy, TFunction<void(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>&)> OnFrameReady);
 
     bool bInitialized;
     TAtomic<bool> bRenderCommandQueued;
@@ -39,6 +44,10 @@ private:
     double LastPreviewSubmitSeconds;
     bool bPreviewUpdatesEnabled;
     FCriticalSection PreviewTimingCS;
+    TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe> FramePool;
+
+    /** ID given to the next dispatched capture. Game thread only. */
+    uint64 NextFrameId;
 };
 
 void AddPanoramaEquirectPass(FRDGBuilder& GraphBuilder, const TArray<FRDGTextureRef>& FaceTextures, FRDGTextureRef OutputTexture, const FPanoramicVideoSettings& Settings, int32 EyeIndex);
@@ -0,0 +1,69 @@
+#include "PanoramaCaptureScratchArena.h"
+
+namespace
+{
+    /** Regrown blocks are rounded up so small size jitter between frames does not regrow them again. */
+    constexpr int64 GBlockGranularity = 1024 * 1024;
+}
+
+FPanoramaScratchArena::~FPanoramaScratchArena()
+{
+    Release();
+}
+
+void* FPanoramaScratchArena::Allocate(int64 NumBytes, uint32 Alignment)
+{
+    if (NumBytes <= 0)
+    {
+        return nullptr;
+    }
+
+    FrameBytes = Align(FrameBytes, static_cast<int64>(Alignment)) + NumBytes;
+
+    const int64 Offset = Align(BlockUsed, static_cast<int64>(Alignment));
+    if (Block && Offset + NumBytes <= BlockSize)
+    {
+        BlockUsed = Offset + NumBytes;
+        return Block + Offset;
+    }
+
+    void* Overflow = FMemory::Malloc(static_cast<SIZE_T>(NumBytes), Alignment);
+    OverflowAllocations.Add(Overflow);
+    return Overflow;
+}
+
+void FPanoramaScratchArena::Reset()
+{
+    if (OverflowAllocations.Num() > 0)
+    {
+        for (void* Overflow : OverflowAllocations)
+        {
+            FMemory::Free(Overflow);
+        }
+        OverflowAllocations.Reset();
+
+        // The block base is DefaultAlignment aligned, so FrameBytes is exactly what the same frame needs next time.
+        FMemory::Free(Block);
+        BlockSize = Align(FrameBytes, GBlockGranularity);
+        Block = static_cast<uint8*>(FMemory::Malloc(static_cast<SIZE_T>(BlockSize), DefaultAlignment));
+        ++GrowCount;
+    }
+
+    BlockUsed = 0;
+    FrameBytes = 0;
+}
+
+void FPanoramaScratchArena::Release()
+{
+    for (void* Overflow : OverflowAllocations)
+    {
+        FMemory::Free(Overflow);
+    }
+    OverflowAllocations.Empty();
+
+    FMemory::Free(Block);
+    Block = nullptr;
+    BlockSize = 0;
+    BlockUsed = 0;
+    FrameBytes = 0;
+}
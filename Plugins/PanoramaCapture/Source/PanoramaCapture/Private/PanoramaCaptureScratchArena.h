@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Linear allocator for the transient buffers of one frame (PNG staging, stereo packing). Allocations bump an offset
+ * through a single block and are all released together by Reset once the frame is done. A frame that outgrows the
+ * block is served from overflow allocations, and the next Reset regrows the block to that frame's high-water mark, so
+ * steady-state frames never touch the heap. Not thread safe: each thread that processes frames owns its own arena.
+ */
+class FPanoramaScratchArena
+{
+public:
+    FPanoramaScratchArena() = default;
+    ~FPanoramaScratchArena();
+
+    FPanoramaScratchArena(const FPanoramaScratchArena&) = delete;
+    FPanoramaScratchArena& operator=(const FPanoramaScratchArena&) = delete;
+
+    /** Uninitialized memory valid until the next Reset, or null when NumBytes is not positive. */
+    void* Allocate(int64 NumBytes, uint32 Alignment = DefaultAlignment);
+
+    template <typename ElementType>
+    TArrayView<ElementType> AllocateArray(int32 Num)
+    {
+        ElementType* Data = static_cast<ElementType*>(Allocate(static_cast<int64>(Num) * sizeof(ElementType), FMath::Max<uint32>(alignof(ElementType), DefaultAlignment)));
+        return Data ? TArrayView<ElementType>(Data, Num) : TArrayView<ElementType>();
+    }
+
+    /** Ends the frame: every allocation is released and the block grows if the frame overflowed it. */
+    void Reset();
+
+    /** Frees all memory, for the end of a capture session. */
+    void Release();
+
+    int64 GetCapacity() const { return BlockSize; }
+
+    /** Times the block was regrown; constant once the capture reaches steady state. */
+    int32 GetGrowCount() const { return GrowCount; }
+
+private:
+    static constexpr uint32 DefaultAlignment = 64;
+
+    uint8* Block = nullptr;
+    int64 BlockSize = 0;
+    int64 BlockUsed = 0;
+
+    /** Size a single block would need for everything allocated since the last Reset, alignment included. */
+    int64 FrameBytes = 0;
+
+    TArray<void*> OverflowAllocations;
+    int32 GrowCount = 0;
+};
@@ -0,0 +1,324 @@
+#include "PanoramaCaptureSpillFile.h"
+#include "PanoramaCaptureFrame.h"
+#include "PanoramaCaptureFramePool.h"
+#include "PanoramaCaptureLog.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+FPanoramaSpillRegion::~FPanoramaSpillRegion()
+{
+    if (TSharedPtr<FPanoramaSpillFile, ESPMode::ThreadSafe> PinnedFile = File.Pin())
+    {
+        PinnedFile->Release(EndPosition);
+    }
+}
+
+FPanoramaSpillFile::~FPanoramaSpillFile()
+{
+    Close();
+}
+
+bool FPanoramaSpillFile::Open(const FString& InFilePath, int64 InSizeBytes)
+{
+    Close();
+    if (InSizeBytes <= 0)
+    {
+        return false;
+    }
+
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(InFilePath), true);
+
+#if PLATFORM_WINDOWS
+    // Mapped pages are file backed, so the OS can write them out instead of growing the process working set. The file
+    // is deleted with its last handle, even if the process dies mid-capture.
+    HANDLE File = ::CreateFileW(*InFilePath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to create spill file %s (error %u)"), *InFilePath, ::GetLastError());
+        return false;
+    }
+
+    // Preallocate so a burst never waits on the file system growing the file.
+    LARGE_INTEGER FileSize;
+    FileSize.QuadPart = InSizeBytes;
+    if (!::SetFilePointerEx(File, FileSize, nullptr, FILE_BEGIN) || !::SetEndOfFile(File))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to preallocate %lld bytes for spill file %s (error %u)"), InSizeBytes, *InFilePath, ::GetLastError());
+        ::CloseHandle(File);
+        return false;
+    }
+
+    HANDLE Mapping = ::CreateFileMappingW(File, nullptr, PAGE_READWRITE, FileSize.HighPart, FileSize.LowPart, nullptr);
+    void* View = Mapping ? ::MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    if (!View)
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to map spill file %s (error %u)"), *InFilePath, ::GetLastError());
+        if (Mapping)
+        {
+            ::CloseHandle(Mapping);
+        }
+        ::CloseHandle(File);
+        return false;
+    }
+
+    FileHandle = File;
+    MappingHandle = Mapping;
+    MappedData = static_cast<uint8*>(View);
+#else
+    FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*InFilePath, false, true));
+    if (!FileHandle.IsValid() || !FileHandle->Seek(InSizeBytes - 1))
+    {
+        UE_LOG(LogPanoramaCapture, Warning, TEXT("Failed to create spill file %s"), *InFilePath);
+        FileHandle.Reset();
+        return false;
+    }
+    const uint8 LastByte = 0;
+    FileHandle->Write(&LastByte, 1);
+#endif
+
+    FScopeLock Lock(&CriticalSection);
+    FilePath = InFilePath;
+    SizeBytes = InSizeBytes;
+    WritePosition = 0;
+    ReadPosition = 0;
+    Reservations.Reset();
+    SpilledCount.Store(0, EMemoryOrder::Relaxed);
+    UE_LOG(LogPanoramaCapture, Log, TEXT("Frame queue spill file %s (%lld MB)"), *FilePath, SizeBytes / (1024 * 1024));
+    return true;
+}
+
+void FPanoramaSpillFile::Close()
+{
+    {
+        FScopeLock Lock(&CriticalSection);
+        SizeBytes = 0;
+        WritePosition = 0;
+        ReadPosition = 0;
+        Reservations.Reset();
+    }
+
+#if PLATFORM_WINDOWS
+    if (MappedData)
+    {
+        ::UnmapViewOfFile(MappedData);
+        MappedData = nullptr;
+    }
+    if (MappingHandle)
+    {
+        ::CloseHandle(MappingHandle);
+        MappingHandle = nullptr;
+    }
+    if (FileHandle)
+    {
+        // FILE_FLAG_DELETE_ON_CLOSE removes the file with the last handle.
+        ::CloseHandle(FileHandle);
+        FileHandle = nullptr;
+    }
+#else
+    if (FileHandle.IsValid())
+    {
+        FileHandle.Reset();
+        IFileManager::Get().Delete(*FilePath, false, true, true);
+    }
+#endif
+    FilePath.Reset();
+}
+
+bool FPanoramaSpillFile::IsOpen() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return SizeBytes > 0;
+}
+
+int64 FPanoramaSpillFile::GetUsedBytes() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return static_cast<int64>(WritePosition - ReadPosition);
+}
+
+bool FPanoramaSpillFile::SpillFrame(FPanoramaFrame& Frame, FPanoramaFramePool* Pool)
+{
+    const void* Data = nullptr;
+    int64 NumBytes = 0;
+    FPanoramaSpilledPayload Spilled;
+    if (const FPanoramaReadbackPayload* Readback = Frame.GetReadback())
+    {
+        Data = Readback->Pixels.GetData();
+        NumBytes = Readback->Pixels.Num() * static_cast<int64>(sizeof(FFloat16Color));
+        Spilled.SourceStage = EPanoramaFrameStage::Readback;
+    }
+    else if (const FPanoramaConvertedPayload* Converted = Frame.GetConverted())
+    {
+        Data = Converted->Bytes.GetData();
+        NumBytes = Converted->Bytes.Num();
+        Spilled.SourceStage = EPanoramaFrameStage::Converted;
+        Spilled.ColorFormat = Converted->ColorFormat;
+    }
+    else if (const FPanoramaEncodedPayload* Encoded = Frame.GetEncoded())
+    {
+        Data = Encoded->Bytes.GetData();
+        NumBytes = Encoded->Bytes.Num();
+        Spilled.SourceStage = EPanoramaFrameStage::Encoded;
+        Spilled.ColorFormat = Encoded->ColorFormat;
+    }
+
+    if (NumBytes <= 0)
+    {
+        return false;
+    }
+
+    Spilled.Region = Reserve(NumBytes);
+    if (!Spilled.Region.IsValid())
+    {
+        return false;
+    }
+    if (!WriteBytes(Spilled.Region->Offset, Data, NumBytes))
+    {
+        return false;
+    }
+
+    FPanoramaFramePayload InMemory = Frame.TakePayload();
+    Frame.SetSpilled(MoveTemp(Spilled));
+    if (Pool)
+    {
+        Pool->Recycle(MoveTemp(InMemory));
+    }
+    SpilledCount.AddExchange(1);
+    return true;
+}
+
+bool FPanoramaSpillFile::RestoreFrame(FPanoramaFrame& Frame, FPanoramaFramePool* Pool)
+{
+    const FPanoramaSpilledPayload* Spilled = Frame.GetSpilled();
+    if (!Spilled || !Spilled->Region.IsValid())
+    {
+        return false;
+    }
+
+    const FPanoramaSpillRegion& Region = *Spilled->Region;
+    const FIntPoint Resolution = Frame.Resolution;
+    if (Spilled->SourceStage == EPanoramaFrameStage::Readback)
+    {
+        TArray<FFloat16Color> Pixels = Pool ? Pool->AcquirePixelBuffer() : TArray<FFloat16Color>();
+        Pixels.SetNumUninitialized(static_cast<int32>(Region.NumBytes / sizeof(FFloat16Color)));
+        if (!ReadBytes(Region.Offset, Pixels.GetData(), Region.NumBytes))
+        {
+            return false;
+        }
+        Frame.SetReadback(MoveTemp(Pixels), Resolution);
+        return true;
+    }
+
+    TArray<uint8> Bytes = Pool ? Pool->AcquireByteBuffer() : TArray<uint8>();
+    Bytes.SetNumUninitialized(static_cast<int32>(Region.NumBytes));
+    if (!ReadBytes(Region.Offset, Bytes.GetData(), Region.NumBytes))
+    {
+        return false;
+    }
+
+    // Replacing the spilled payload drops the region reference, which frees the file range.
+    const EPanoramaColorFormat ColorFormat = Spilled->ColorFormat;
+    if (Spilled->SourceStage == EPanoramaFrameStage::Converted)
+    {
+        Frame.SetConverted(MoveTemp(Bytes), Resolution, ColorFormat);
+    }
+    else
+    {
+        Frame.SetEncoded(MoveTemp(Bytes), Resolution, ColorFormat);
+    }
+    return true;
+}
+
+TSharedPtr<FPanoramaSpillRegion, ESPMode::ThreadSafe> FPanoramaSpillFile::Reserve(int64 NumBytes)
+{
+    FScopeLock Lock(&CriticalSection);
+    if (SizeBytes <= 0 || NumBytes > SizeBytes)
+    {
+        return nullptr;
+    }
+
+    // A payload never wraps around the end of the file; the tail that does not fit is skipped.
+    uint64 Start = WritePosition;
+    const int64 StartOffset = static_cast<int64>(Start % static_cast<uint64>(SizeBytes));
+    if (StartOffset + NumBytes > SizeBytes)
+    {
+        Start += static_cast<uint64>(SizeBytes - StartOffset);
+    }
+    const uint64 End = Start + static_cast<uint64>(NumBytes);
+    if (End - ReadPosition > static_cast<uint64>(SizeBytes))
+    {
+        return nullptr;
+    }
+
+    WritePosition = End;
+    Reservations.Add({ End, false });
+
+    TSharedPtr<FPanoramaSpillRegion, ESPMode::ThreadSafe> Region = MakeShared<FPanoramaSpillRegion, ESPMode::ThreadSafe>();
+    Region->File = AsShared();
+    Region->Offset = static_cast<int64>(Start % static_cast<uint64>(SizeBytes));
+    Region->NumBytes = NumBytes;
+    Region->EndPosition = End;
+    return Region;
+}
+
+void FPanoramaSpillFile::Release(uint64 EndPosition)
+{
+    FScopeLock Lock(&CriticalSection);
+    for (FReservation& Reservation : Reservations)
+    {
+        if (Reservation.EndPosition == EndPosition)
+        {
+            Reservation.bReleased = true;
+            break;
+        }
+    }
+
+    // Only the oldest reservations can be handed back; a later one waits for everything before it.
+    int32 NumFreed = 0;
+    while (NumFreed < Reservations.Num() && Reservations[NumFreed].bReleased)
+    {
+        ReadPosition = Reservations[NumFreed].EndPosition;
+        ++NumFreed;
+    }
+    if (NumFreed > 0)
+    {
+        Reservations.RemoveAt(0, NumFreed);
+    }
+}
+
+bool FPanoramaSpillFile::WriteBytes(int64 Offset, const void* Data, int64 NumBytes)
+{
+#if PLATFORM_WINDOWS
+    if (!MappedData)
+    {
+        return false;
+    }
+    FMemory::Memcpy(MappedData + Offset, Data, NumBytes);
+    return true;
+#else
+    FScopeLock Lock(&IOCriticalSection);
+    return FileHandle.IsValid() && FileHandle->Seek(Offset) && FileHandle->Write(static_cast<const uint8*>(Data), NumBytes);
+#endif
+}
+
+bool FPanoramaSpillFile::ReadBytes(int64 Offset, void* Data, int64 NumBytes)
+{
+#if PLATFORM_WINDOWS
+    if (!MappedData)
+    {
+        return false;
+    }
+    FMemory::Memcpy(Data, MappedData + Offset, NumBytes);
+    return true;
+#else
+    FScopeLock Lock(&IOCriticalSection);
+    return FileHandle.IsValid() && FileHandle->Seek(Offset) && FileHandle->Read(static_cast<uint8*>(Data), NumBytes);
+#endif
+}
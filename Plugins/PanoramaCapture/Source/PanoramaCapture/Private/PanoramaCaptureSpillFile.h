@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Atomic.h"
+
+struct FPanoramaFrame;
+class FPanoramaFramePool;
+class FPanoramaSpillFile;
+class IFileHandle;
+
+/** A reserved range of the spill file. Destroying it, on any thread, gives the range back to the file. */
+struct FPanoramaSpillRegion
+{
+    ~FPanoramaSpillRegion();
+
+    TWeakPtr<FPanoramaSpillFile, ESPMode::ThreadSafe> File;
+    int64 Offset = 0;
+    int64 NumBytes = 0;
+
+    /** Logical write position just past this region; regions are returned to the file in this order. */
+    uint64 EndPosition = 0;
+};
+
+/**
+ * Overflow tier behind the frame queue: a preallocated scratch file, memory mapped on Windows, used as a circular
+ * byte log. The render thread moves a frame's CPU payload into the file when the in-memory budget is full, and the
+ * consumer moves it back into a pooled buffer after dequeuing. The frame stays in the queue as a header only, so the
+ * queue order is the read-back order. Regions are reserved in write order and freed in the same order; a region
+ * released early is held until every older region is released too. Thread safe.
+ */
+class FPanoramaSpillFile : public TSharedFromThis<FPanoramaSpillFile, ESPMode::ThreadSafe>
+{
+public:
+    ~FPanoramaSpillFile();
+
+    /** Creates and preallocates the file. Returns false, leaving the tier closed, when it cannot be created or mapped. */
+    bool Open(const FString& InFilePath, int64 InSizeBytes);
+
+    /** Unmaps and deletes the file. Regions still held by frames are then unreadable. */
+    void Close();
+
+    bool IsOpen() const;
+
+    /**
+     * Moves the frame's readback, converted or encoded payload into the file, replacing it with a spilled payload that
+     * costs no queue memory. The displaced buffer goes to Pool. Returns false when the frame has no CPU payload or the
+     * file has no contiguous room for it.
+     */
+    bool SpillFrame(FPanoramaFrame& Frame, FPanoramaFramePool* Pool);
+
+    /** Reads a spilled payload back into a buffer from Pool and restores the stage it was spilled from. */
+    bool RestoreFrame(FPanoramaFrame& Frame, FPanoramaFramePool* Pool);
+
+    int64 GetSizeBytes() const { return SizeBytes; }
+
+    /** Bytes reserved by spilled payloads that have not been released yet, including wrap-around padding. */
+    int64 GetUsedBytes() const;
+
+    /** Payloads spilled since the file was opened. */
+    int32 GetSpilledCount() const { return SpilledCount.Load(EMemoryOrder::Relaxed); }
+
+private:
+    friend struct FPanoramaSpillRegion;
+
+    TSharedPtr<FPanoramaSpillRegion, ESPMode::ThreadSafe> Reserve(int64 NumBytes);
+    void Release(uint64 EndPosition);
+    bool WriteBytes(int64 Offset, const void* Data, int64 NumBytes);
+    bool ReadBytes(int64 Offset, void* Data, int64 NumBytes);
+
+    struct FReservation
+    {
+        uint64 EndPosition = 0;
+        bool bReleased = false;
+    };
+
+    FString FilePath;
+    int64 SizeBytes = 0;
+
+    /** Guards the positions and reservations; payload copies happen outside it. */
+    mutable FCriticalSection CriticalSection;
+    uint64 WritePosition = 0;
+    uint64 ReadPosition = 0;
+    TArray<FReservation> Reservations;
+    TAtomic<int32> SpilledCount{ 0 };
+
+#if PLATFORM_WINDOWS
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+    uint8* MappedData = nullptr;
+#else
+    /** Positional fallback where no writable mapping is available; Seek and Read/Write run under IOCriticalSection. */
+    TUniquePtr<IFileHandle> FileHandle;
+    FCriticalSection IOCriticalSection;
+#endif
+};
@@ -0,0 +1,126 @@
+#include "PanoramaCaptureTransferLUT.h"
+#include "PanoramaCaptureColorKernels.h"
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+namespace TransferLUT
+{
+namespace
+{
+    constexpr int32 NumHalfValues = 65536;
+
+    /** Every half value in bit order, decoded once through the shared batch decoder. */
+    const TArray<float>& GetAllHalfValues()
+    {
+        static const TArray<float> Values = []()
+        {
+            // Four consecutive bit patterns form one FFloat16Color, so the whole range decodes as a pixel span.
+            TArray<FFloat16Color> Patterns;
+            Patterns.SetNumUninitialized(NumHalfValues / 4);
+            uint16* PatternBits = reinterpret_cast<uint16*>(Patterns.GetData());
+            for (int32 Bits = 0; Bits < NumHalfValues; ++Bits)
+            {
+                PatternBits[Bits] = static_cast<uint16>(Bits);
+            }
+
+            TArray<float> Decoded;
+            Decoded.SetNumUninitialized(NumHalfValues);
+            Kernels::DecodeHalfColors(Patterns.GetData(), Patterns.Num(), Decoded.GetData());
+            return Decoded;
+        }();
+        return Values;
+    }
+
+    template <typename CodeType, typename EncodeFunction>
+    TArray<CodeType> BuildTable(EncodeFunction Encode)
+    {
+        const TArray<float>& HalfValues = GetAllHalfValues();
+
+        TArray<CodeType> Table;
+        // Padding keeps a 4-byte load at the last index inside the allocation.
+        Table.SetNumZeroed(NumHalfValues + 4 / sizeof(CodeType));
+        for (int32 Bits = 0; Bits < NumHalfValues; ++Bits)
+        {
+            Table[Bits] = Encode(HalfValues[Bits]);
+        }
+        return Table;
+    }
+
+    double EncodeSRGB(float LinearValue)
+    {
+        const double Value = FMath::Clamp(LinearValue, 0.0f, 1.0f);
+        return Value <= 0.0031308 ? Value * 12.92 : 1.055 * FMath::Pow(Value, 1.0 / 2.4) - 0.055;
+    }
+
+    double EncodePQ(float LinearValue)
+    {
+        constexpr double M1 = 2610.0 / 16384.0;
+        constexpr double M2 = 2523.0 / 4096.0 * 128.0;
+        constexpr double C1 = 3424.0 / 4096.0;
+        constexpr double C2 = 2413.0 / 4096.0 * 32.0;
+        constexpr double C3 = 2392.0 / 4096.0 * 32.0;
+
+        const double Luminance = FMath::Clamp(static_cast<double>(LinearValue) * PQInputNits / 10000.0, 0.0, 1.0);
+        const double Power = FMath::Pow(Luminance, M1);
+        return FMath::Pow((C1 + C2 * Power) / (1.0 + C3 * Power), M2);
+    }
+}
+
+const uint8* GetSRGB8()
+{
+    static const TArray<uint8> Table = BuildTable<uint8>([](float Value)
+    {
+        return FLinearColor(Value, Value, Value, 1.0f).GetClamped().ToFColorSRGB().R;
+    });
+    return Table.GetData();
+}
+
+const uint16* GetSRGB12()
+{
+    static const TArray<uint16> Table = BuildTable<uint16>([](float Value)
+    {
+        return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(EncodeSRGB(Value) * 4095.0), 0, 4095));
+    });
+    return Table.GetData();
+}
+
+const uint16* GetPQ12()
+{
+    static const TArray<uint16> Table = BuildTable<uint16>([](float Value)
+    {
+        return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(EncodePQ(Value) * 4095.0), 0, 4095));
+    });
+    return Table.GetData();
+}
+
+const uint8* GetLinear8()
+{
+    static const TArray<uint8> Table = BuildTable<uint8>([](float Value)
+    {
+        return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(FMath::Clamp(Value, 0.0f, 1.0f) * 255.0f), 0, 255));
+    });
+    return Table.GetData();
+}
+
+const uint16* GetLinear12()
+{
+    static const TArray<uint16> Table = BuildTable<uint16>([](float Value)
+    {
+        return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(FMath::Clamp(Value, 0.0f, 1.0f) * 4095.0f), 0, 4095));
+    });
+    return Table.GetData();
+}
+
+const uint16* GetLinear16()
+{
+    static const TArray<uint16> Table = BuildTable<uint16>([](float Value)
+    {
+        return static_cast<uint16>(FMath::Clamp(Value * 65535.0f, 0.0f, 65535.0f));
+    });
+    return Table.GetData();
+}
+}
+}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace PanoramaCapture
+{
+namespace Color
+{
+/**
+ * 64K-entry transfer tables indexed by the raw FFloat16 bits. Each table is built once on first use and maps a
+ * half-float channel straight to its quantized, transfer-encoded code so the per-pixel loops never touch pow().
+ * Every table is padded so a 32-bit gather at the last index stays in bounds.
+ */
+namespace TransferLUT
+{
+    /** sRGB-encoded 8-bit code, identical to FLinearColor::GetClamped().ToFColorSRGB(). */
+    const uint8* GetSRGB8();
+
+    /** sRGB-encoded full-range 12-bit code (0-4095), the RGB input of the fixed-point YUV matrix. */
+    const uint16* GetSRGB12();
+
+    /** Linear value clamped to [0, 1] and rounded to an 8-bit code. */
+    const uint8* GetLinear8();
+
+    /** Linear value clamped to [0, 1] and rounded to a 12-bit code. */
+    const uint16* GetLinear12();
+
+    /** Luminance in nits of a linear 1.0 at the input of GetPQ12. The equirect shader scales PQ output to this unit. */
+    constexpr double PQInputNits = 100.0;
+
+    /** SMPTE ST 2084 (PQ) encoded full-range 12-bit code for linear light in units of PQInputNits, clamped at 10000 nits. */
+    const uint16* GetPQ12();
+
+    /** Linear value clamped and truncated to 16 bits, as used for PNG staging. */
+    const uint16* GetLinear16();
+}
+}
+}
@@ -3,47 +3,223 @@
 #include "CoreMinimal.h"
 #include "RHIResources.h"
 #include "Math/Float16Color.h"
+#include "Misc/TVariant.h"
 #include "PanoramaCaptureTypes.h"
 
-/** Representation of a frame captured from the render thread. */
+struct FPanoramaSpillRegion;
+
+/** Pipeline stage of a frame's payload. Values follow the alternatives of FPanoramaFramePayload. */
+enum class EPanoramaFrameStage : uint8
+{
+    Empty,
+    /** Half-float pixels read back from the equirect target (PNG output and the CPU conversion path). */
+    Readback,
+    /** Combined BGRA8 texture left on the GPU for NVENC zero-copy submission. */
+    GPUTexture,
+    /** Raw NV12/P010/BGRA payload produced by CPU conversion. */
+    Converted,
+    /** Payload handed to the raw stream: converted bytes or an NVENC bitstream. */
+    Encoded,
+    /** Written to disk as its own file (PNG sequence). */
+    Persisted,
+    /** CPU payload parked in the frame queue's spill file until the consumer reads it back. */
+    Spilled
+};
+
+struct FPanoramaReadbackPayload
+{
+    TArray<FFloat16Color> Pixels;
+};
+
+struct FPanoramaGPUTexturePayload
+{
+    FTextureRHIRef Texture;
+};
+
+struct FPanoramaConvertedPayload
+{
+    TArray<uint8> Bytes;
+    EPanoramaColorFormat ColorFormat = EPanoramaColorFormat::NV12;
+};
+
+struct FPanoramaEncodedPayload
+{
+    TArray<uint8> Bytes;
+    EPanoramaColorFormat ColorFormat = EPanoramaColorFormat::NV12;
+};
+
+struct FPanoramaPersistedPayload
+{
+    FString FilePath;
+};
+
+struct FPanoramaSpilledPayload
+{
+    /** Releasing the last reference frees the file range. */
+    TSharedPtr<FPanoramaSpillRegion, ESPMode::ThreadSafe> Region;
+
+    /** Stage (Readback, Converted or Encoded) the payload is restored to. */
+    EPanoramaFrameStage SourceStage = EPanoramaFrameStage::Empty;
+    EPanoramaColorFormat ColorFormat = EPanoramaColorFormat::NV12;
+};
+
+/**
+ * FPlatformTime::Cycles64 stamps of a frame's progress through the pipeline; zero until the frame reaches the stage.
+ * The manager turns them into the per-stage latency histograms published in FPanoramicCaptureStatus.
+ */
+struct FPanoramaFrameTimings
+{
+    /** GPU readback (or zero-copy texture hand-off) finished on the render thread. */
+    uint64 ReadbackCycles = 0;
+
+    /** Admitted to the frame queue; includes any wait for queue space. */
+    uint64 EnqueueCycles = 0;
+
+    /** Claimed by the frame worker. */
+    uint64 DequeueCycles = 0;
+
+    /** Payload ready to write: converted/encoded for video, compressed for PNG. */
+    uint64 ConvertedCycles = 0;
+
+    /** Written to the raw stream or to its own file. */
+    uint64 WrittenCycles = 0;
+};
+
+/** Exactly one payload is live per frame; alternatives are in EPanoramaFrameStage order. */
+using FPanoramaFramePayload = TVariant<FEmptyVariantState, FPanoramaReadbackPayload, FPanoramaGPUTexturePayload, FPanoramaConvertedPayload, FPanoramaEncodedPayload, FPanoramaPersistedPayload, FPanoramaSpilledPayload>;
+
+/**
+ * Representation of a frame captured from the render thread. A frame moves through the stages readback (or GPU
+ * texture), converted, encoded and persisted; each Set* call moves the new payload in and destroys the previous one,
+ * and TakePayload hands the live payload to the caller, so a buffer is only ever owned by one stage.
+ */
 struct FPanoramaFrame
 {
     FPanoramaFrame()
         : TimestampSeconds(0.0)
+        , FrameId(0)
         , EyeIndex(0)
         , bIsStereo(false)
-        , Format(PF_FloatRGBA)
         , Resolution(FIntPoint::ZeroValue)
-        , ColorFormat(EPanoramaColorFormat::NV12)
     {
     }
 
     double TimestampSeconds;
+
+    /** Monotonically increasing capture ID, shared by both eyes of a stereo capture. */
+    uint64 FrameId;
+
     int32 EyeIndex;
+
+    /** True for both eyes of a stereo capture, and for a payload that already packs both eyes. */
     bool bIsStereo;
-    EPixelFormat Format;
 
-    FTextureRHIRef Texture;
+    /** Pixel dimensions of the live payload; the combined layout once both eyes are packed together. */
     FIntPoint Resolution;
 
-    /** Raw half float pixels captured from the render thread for PNG output. */
-    TArray<FFloat16Color> LinearPixels;
+    FPanoramaFrameTimings Timings;
+
+    EPanoramaFrameStage GetStage() const
+    {
+        return static_cast<EPanoramaFrameStage>(Payload.GetIndex());
+    }
+
+    FPanoramaReadbackPayload* GetReadback() { return Payload.TryGet<FPanoramaReadbackPayload>(); }
+    const FPanoramaReadbackPayload* GetReadback() const { return Payload.TryGet<FPanoramaReadbackPayload>(); }
+    const FPanoramaGPUTexturePayload* GetGPUTexture() const { return Payload.TryGet<FPanoramaGPUTexturePayload>(); }
+    FPanoramaConvertedPayload* GetConverted() { return Payload.TryGet<FPanoramaConvertedPayload>(); }
+    const FPanoramaConvertedPayload* GetConverted() const { return Payload.TryGet<FPanoramaConvertedPayload>(); }
+    const FPanoramaEncodedPayload* GetEncoded() const { return Payload.TryGet<FPanoramaEncodedPayload>(); }
+    const FPanoramaPersistedPayload* GetPersisted() const { return Payload.TryGet<FPanoramaPersistedPayload>(); }
+    const FPanoramaSpilledPayload* GetSpilled() const { return Payload.TryGet<FPanoramaSpilledPayload>(); }
+
+    /** Readback pixels, or an empty array when the frame is at any other stage. */
+    const TArray<FFloat16Color>& GetReadbackPixels() const
+    {
+        static const TArray<FFloat16Color> NoPixels;
+        const FPanoramaReadbackPayload* Readback = GetReadback();
+        return Readback ? Readback->Pixels : NoPixels;
+    }
+
+    void SetReadback(TArray<FFloat16Color>&& Pixels, const FIntPoint& InResolution)
+    {
+        Resolution = InResolution;
+        Payload.Emplace<FPanoramaReadbackPayload>(FPanoramaReadbackPayload{ MoveTemp(Pixels) });
+    }
+
+    void SetGPUTexture(const FTextureRHIRef& Texture, const FIntPoint& InResolution)
+    {
+        Resolution = InResolution;
+        Payload.Emplace<FPanoramaGPUTexturePayload>(FPanoramaGPUTexturePayload{ Texture });
+    }
+
+    void SetConverted(TArray<uint8>&& Bytes, const FIntPoint& InResolution, EPanoramaColorFormat ColorFormat)
+    {
+        Resolution = InResolution;
+        Payload.Emplace<FPanoramaConvertedPayload>(FPanoramaConvertedPayload{ MoveTemp(Bytes), ColorFormat });
+    }
+
+    void SetEncoded(TArray<uint8>&& Bytes, const FIntPoint& InResolution, EPanoramaColorFormat ColorFormat)
+    {
+        Resolution = InResolution;
+        Payload.Emplace<FPanoramaEncodedPayload>(FPanoramaEncodedPayload{ MoveTemp(Bytes), ColorFormat });
+    }
 
-    /** GPU-resident texture prepared for NVENC zero-copy submission (BGRA8). */
-    FTextureRHIRef NVENCTexture;
+    void SetPersisted(const FString& FilePath, const FIntPoint& InResolution)
+    {
+        Resolution = InResolution;
+        Payload.Emplace<FPanoramaPersistedPayload>(FPanoramaPersistedPayload{ FilePath });
+    }
 
-    /** Resolution of the NVENC-ready texture. May differ from the float equirect target in stereo mode. */
-    FIntPoint NVENCResolution = FIntPoint::ZeroValue;
+    /** Keeps Resolution: the spilled payload still describes the same pixels. */
+    void SetSpilled(FPanoramaSpilledPayload&& Spilled)
+    {
+        Payload.Emplace<FPanoramaSpilledPayload>(MoveTemp(Spilled));
+    }
 
-    /** Location of an intermediate file written by the worker (PNG sequence). */
-    FString DiskFilePath;
+    /** Moves the live payload out, typically to recycle its buffer, and leaves the frame empty. */
+    FPanoramaFramePayload TakePayload()
+    {
+        FPanoramaFramePayload Taken = MoveTemp(Payload);
+        Payload.Emplace<FEmptyVariantState>();
+        return Taken;
+    }
+
+    /** Restores the defaults so the frame pool can hand the frame out again. The pool recycles the payload first. */
+    void ResetForReuse()
+    {
+        TimestampSeconds = 0.0;
+        FrameId = 0;
+        EyeIndex = 0;
+        bIsStereo = false;
+        Resolution = FIntPoint::ZeroValue;
+        Timings = FPanoramaFrameTimings();
+        Payload.Emplace<FEmptyVariantState>();
+    }
 
-    /** Encoded elementary stream payload for hardware encoder output. */
-    TArray<uint8> EncodedVideo;
+    /** CPU memory held by the live payload; what the frame queue charges against its memory budget. Spilled payloads hold none. */
+    int64 GetPayloadBytes() const
+    {
+        return GetPayloadBytes(Payload);
+    }
 
-    /** Color format used when producing EncodedVideo or NVENCTexture. */
-    EPanoramaColorFormat ColorFormat;
+    static int64 GetPayloadBytes(const FPanoramaFramePayload& InPayload)
+    {
+        if (const FPanoramaReadbackPayload* Readback = InPayload.TryGet<FPanoramaReadbackPayload>())
+        {
+            return static_cast<int64>(Readback->Pixels.GetAllocatedSize());
+        }
+        if (const FPanoramaConvertedPayload* Converted = InPayload.TryGet<FPanoramaConvertedPayload>())
+        {
+            return static_cast<int64>(Converted->Bytes.GetAllocatedSize());
+        }
+        if (const FPanoramaEncodedPayload* Encoded = InPayload.TryGet<FPanoramaEncodedPayload>())
+        {
+            return static_cast<int64>(Encoded->Bytes.GetAllocatedSize());
+        }
+        return 0;
+    }
 
-    /** Optional planar payload generated on the GPU (NV12/P010) before NVENC submission. */
-    TArray<uint8> PlanarVideo;
+private:
+    FPanoramaFramePayload Payload;
 };
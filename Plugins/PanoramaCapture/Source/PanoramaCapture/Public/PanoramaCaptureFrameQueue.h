@@ -1,66 +1,209 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Templates/Atomic.h"
 
-/** Lock-free ring buffer queue for video frames. */
+/**
+ * Lock-free bounded ring buffer for video frames with a single producer (the render thread). DequeueBulk is normally
+ * called by one consumer (the frame worker, or the game thread when no worker is running); the producer may also
+ * dequeue to evict the oldest frame, so each slot carries a sequence number and the tail is claimed with a
+ * compare-exchange. Num, GetQueuedBytes and GetDroppedCount may be read from any thread and are approximate while
+ * the producer and consumer are active.
+ *
+ * Besides the frame count, the queue can be bounded by a byte budget: every item is charged the size the producer
+ * reports for it, and admission fails once the queued bytes would exceed the budget.
+ *
+ * Items are admitted, dequeued and evicted in units of one item or a pair (the two eyes of a stereo capture).
+ */
 template <typename ElementType>
 class TPanoramaFrameQueue
 {
 public:
-    explicit TPanoramaFrameQueue(int32 InCapacity = 120)
-        : Capacity(FMath::Max(1, InCapacity))
+    using FElementPtr = TSharedPtr<ElementType, ESPMode::ThreadSafe>;
+
+    explicit TPanoramaFrameQueue(int32 InCapacity = 120, int64 InMaxBytes = 0)
     {
-        Storage.SetNumZeroed(Capacity);
+        Configure(InCapacity, InMaxBytes);
     }
 
-    bool Enqueue(const TSharedPtr<ElementType, ESPMode::ThreadSafe>& Item)
+    TPanoramaFrameQueue(const TPanoramaFrameQueue&) = delete;
+    TPanoramaFrameQueue& operator=(const TPanoramaFrameQueue&) = delete;
+
+    /**
+     * Empties the queue, then sets the frame capacity and the byte budget (zero disables the budget). Neither the
+     * producer nor the consumer may be running.
+     */
+    void Configure(int32 InCapacity, int64 InMaxBytes)
     {
-        FScopeLock Lock(&CriticalSection);
-        const int32 NextHead = (Head + 1) % Capacity;
-        if (NextHead == Tail)
+        Reset();
+
+        // Positions run freely and are masked into a power-of-two slot array; a slot's sequence says whether it is
+        // free for position P (Sequence == P) or holds the item for position P (Sequence == P + 1).
+        Capacity = FMath::Max(1, InCapacity);
+        MaxBytes = FMath::Max<int64>(0, InMaxBytes);
+        NumSlots = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(Capacity));
+        IndexMask = NumSlots - 1;
+        Slots = MakeUnique<FSlot[]>(NumSlots);
+
+        const uint64 Position = Head.Value.Load(EMemoryOrder::Relaxed);
+        for (uint64 Offset = 0; Offset < NumSlots; ++Offset)
+        {
+            Slots[(Position + Offset) & IndexMask].Sequence.Store(Position + Offset, EMemoryOrder::Relaxed);
+        }
+    }
+
+    /**
+     * Producer only. Never blocks; returns false when the ring is full or ItemBytes would exceed the byte budget.
+     * A single item larger than the whole budget is still admitted into an empty queue.
+     */
+    bool TryEnqueue(const FElementPtr& Item, int64 ItemBytes = 0)
+    {
+        return TryEnqueuePair(Item, ItemBytes, nullptr, 0);
+    }
+
+    /**
+     * Producer only. Admits First and Second as one unit (both or neither) that dequeuers also only take whole, so
+     * evicting or draining never separates them. A null Second enqueues First alone.
+     */
+    bool TryEnqueuePair(const FElementPtr& First, int64 FirstBytes, const FElementPtr& Second, int64 SecondBytes)
+    {
+        const int32 UnitSize = Second.IsValid() ? 2 : 1;
+        const int64 UnitBytes = FirstBytes + (Second.IsValid() ? SecondBytes : 0);
+        const uint64 CurrentHead = Head.Value.Load(EMemoryOrder::Relaxed);
+        const uint64 CurrentTail = Tail.Value.Load();
+        if (CurrentHead - CurrentTail + UnitSize > static_cast<uint64>(Capacity))
         {
-            ++Dropped;
             return false;
         }
+        if (MaxBytes > 0 && CurrentHead != CurrentTail && QueuedBytes.Value.Load(EMemoryOrder::Relaxed) + UnitBytes > MaxBytes)
+        {
+            return false;
+        }
+
+        // The slots may still be finishing a dequeue of the positions one lap behind.
+        for (int32 Offset = 0; Offset < UnitSize; ++Offset)
+        {
+            if (Slots[(CurrentHead + Offset) & IndexMask].Sequence.Load() != CurrentHead + Offset)
+            {
+                return false;
+            }
+        }
 
-        Storage[Head] = Item;
-        Head = NextHead;
-        ++Count;
+        FSlot& FirstSlot = Slots[CurrentHead & IndexMask];
+        FirstSlot.Item = First;
+        FirstSlot.Bytes = FirstBytes;
+        FirstSlot.bLinkedToNext.Store(UnitSize > 1, EMemoryOrder::Relaxed);
+        QueuedBytes.Value.AddExchange(UnitBytes);
+        if (UnitSize > 1)
+        {
+            // Publish the second slot first: a dequeuer that sees the first one ready then also sees its partner.
+            FSlot& SecondSlot = Slots[(CurrentHead + 1) & IndexMask];
+            SecondSlot.Item = Second;
+            SecondSlot.Bytes = SecondBytes;
+            SecondSlot.bLinkedToNext.Store(false, EMemoryOrder::Relaxed);
+            SecondSlot.Sequence.Store(CurrentHead + 2);
+        }
+        FirstSlot.Sequence.Store(CurrentHead + 1);
+        Head.Value.Store(CurrentHead + UnitSize);
         return true;
     }
 
-    TSharedPtr<ElementType, ESPMode::ThreadSafe> Dequeue()
+    /** Producer only. True when the ring has room for a unit of UnitSize items by count, whatever the byte budget. */
+    bool HasFreeSlots(int32 UnitSize) const
     {
-        FScopeLock Lock(&CriticalSection);
-        if (Tail == Head)
+        const uint64 CurrentHead = Head.Value.Load(EMemoryOrder::Relaxed);
+        const uint64 CurrentTail = Tail.Value.Load();
+        return CurrentHead - CurrentTail + UnitSize <= static_cast<uint64>(Capacity);
+    }
+
+    /** Producer only. Drop-newest admission: counts a drop when the item does not fit. */
+    bool Enqueue(const FElementPtr& Item, int64 ItemBytes = 0)
+    {
+        return EnqueuePair(Item, ItemBytes, nullptr, 0);
+    }
+
+    /** Producer only. Drop-newest admission of a unit; a unit that does not fit counts as one drop. */
+    bool EnqueuePair(const FElementPtr& First, int64 FirstBytes, const FElementPtr& Second, int64 SecondBytes)
+    {
+        if (TryEnqueuePair(First, FirstBytes, Second, SecondBytes))
+        {
+            return true;
+        }
+        RecordDrop();
+        return false;
+    }
+
+    /** Producer only. Drop-oldest admission: evicts queued units, counting each as a drop, until the item fits. */
+    bool EnqueueEvictingOldest(const FElementPtr& Item, int64 ItemBytes = 0)
+    {
+        return EnqueuePairEvictingOldest(Item, ItemBytes, nullptr, 0);
+    }
+
+    /** Producer only. Drop-oldest admission of a unit. Fails, counting a drop, only if the unit exceeds the capacity. */
+    bool EnqueuePairEvictingOldest(const FElementPtr& First, int64 FirstBytes, const FElementPtr& Second, int64 SecondBytes)
+    {
+        if ((Second.IsValid() ? 2 : 1) > Capacity)
+        {
+            RecordDrop();
+            return false;
+        }
+        while (!TryEnqueuePair(First, FirstBytes, Second, SecondBytes))
         {
-            return nullptr;
+            if (DiscardOldestUnit())
+            {
+                RecordDrop();
+            }
         }
+        return true;
+    }
 
-        const TSharedPtr<ElementType, ESPMode::ThreadSafe> Item = Storage[Tail];
-        Storage[Tail].Reset();
-        Tail = (Tail + 1) % Capacity;
-        --Count;
-        return Item;
+    /**
+     * Dequeues whole units in queue order with a single claim of the tail, appending them to OutItems, until MaxCount
+     * items are reached. A unit that would cross MaxCount is left for the next call unless it is the first one, so
+     * the count may exceed MaxCount by one. Returns the number of items dequeued; zero when the ring is empty.
+     */
+    template <typename AllocatorType>
+    int32 DequeueBulk(TArray<FElementPtr, AllocatorType>& OutItems, int32 MaxCount)
+    {
+        uint64 Start = 0;
+        const int32 NumClaimed = ClaimReadyUnits(Start, MaxCount);
+        OutItems.Reserve(OutItems.Num() + NumClaimed);
+        int64 ReleasedBytes = 0;
+        for (int32 Index = 0; Index < NumClaimed; ++Index)
+        {
+            const uint64 Position = Start + Index;
+            FSlot& Slot = Slots[Position & IndexMask];
+            OutItems.Add(MoveTemp(Slot.Item));
+            ReleasedBytes += Slot.Bytes;
+            Slot.Sequence.Store(Position + NumSlots);
+        }
+        QueuedBytes.Value.SubExchange(ReleasedBytes);
+        return NumClaimed;
     }
 
+    /** Consumer only. Releases every queued frame and clears the drop counter. */
     void Reset()
     {
-        FScopeLock Lock(&CriticalSection);
-        for (int32 Index = 0; Index < Capacity; ++Index)
+        if (Slots)
         {
-            Storage[Index].Reset();
+            while (DiscardOldestUnit())
+            {
+            }
         }
-        Head = 0;
-        Tail = 0;
-        Count = 0;
-        Dropped = 0;
+        Dropped.Value.Store(0, EMemoryOrder::Relaxed);
+    }
+
+    /** Counts a frame the caller gave up on, for example after a blocking enqueue timed out. */
+    void RecordDrop()
+    {
+        Dropped.Value.AddExchange(1);
     }
 
     int32 Num() const
     {
-        FScopeLock Lock(&CriticalSection);
-        return Count;
+        const uint64 CurrentTail = Tail.Value.Load(EMemoryOrder::Relaxed);
+        const uint64 CurrentHead = Head.Value.Load(EMemoryOrder::Relaxed);
+        return CurrentHead > CurrentTail ? static_cast<int32>(FMath::Min<uint64>(CurrentHead - CurrentTail, Capacity)) : 0;
     }
 
     int32 GetCapacity() const
@@ -68,18 +211,130 @@ public:
         return Capacity;
     }
 
+    /** Sum of the sizes charged for the queued items. */
+    int64 GetQueuedBytes() const
+    {
+        return FMath::Max<int64>(0, QueuedBytes.Value.Load(EMemoryOrder::Relaxed));
+    }
+
+    /** Byte budget, or zero when only the frame count bounds the queue. */
+    int64 GetMaxBytes() const
+    {
+        return MaxBytes;
+    }
+
+    /** Fill ratio (0-1) by frame count or by bytes, whichever is fuller. */
+    float GetFillRatio() const
+    {
+        float Fill = static_cast<float>(Num()) / static_cast<float>(Capacity);
+        if (MaxBytes > 0)
+        {
+            Fill = FMath::Max(Fill, static_cast<float>(static_cast<double>(GetQueuedBytes()) / static_cast<double>(MaxBytes)));
+        }
+        return FMath::Min(Fill, 1.0f);
+    }
+
     int32 GetDroppedCount() const
     {
-        FScopeLock Lock(&CriticalSection);
-        return Dropped;
+        return Dropped.Value.Load(EMemoryOrder::Relaxed);
     }
 
 private:
-    mutable FCriticalSection CriticalSection;
-    TArray<TSharedPtr<ElementType, ESPMode::ThreadSafe>> Storage;
-    int32 Head = 0;
-    int32 Tail = 0;
-    int32 Count = 0;
+    struct FSlot
+    {
+        TAtomic<uint64> Sequence{ 0 };
+        FElementPtr Item;
+        int64 Bytes = 0;
+
+        /** Set on the first slot of a pair. Atomic because a dequeuer may inspect it while racing for the slot. */
+        TAtomic<bool> bLinkedToNext{ false };
+    };
+
+    /** Number of slots in the unit starting at Position when all of them are ready, otherwise zero. */
+    int32 GetReadyUnitSize(uint64 Position) const
+    {
+        const FSlot& Slot = Slots[Position & IndexMask];
+        if (Slot.Sequence.Load() != Position + 1)
+        {
+            return 0;
+        }
+        if (!Slot.bLinkedToNext.Load(EMemoryOrder::Relaxed))
+        {
+            return 1;
+        }
+        return Slots[(Position + 1) & IndexMask].Sequence.Load() == Position + 2 ? 2 : 0;
+    }
+
+    /** Claims whole ready units from the tail, up to MaxCount items but at least one unit. Returns the item count. */
+    int32 ClaimReadyUnits(uint64& OutStart, int32 MaxCount)
+    {
+        uint64 CurrentTail = Tail.Value.Load(EMemoryOrder::Relaxed);
+        for (;;)
+        {
+            int32 NumReady = 0;
+            for (;;)
+            {
+                const int32 UnitSize = GetReadyUnitSize(CurrentTail + NumReady);
+                if (UnitSize == 0 || (NumReady > 0 && NumReady + UnitSize > MaxCount))
+                {
+                    break;
+                }
+                NumReady += UnitSize;
+                if (NumReady >= MaxCount)
+                {
+                    break;
+                }
+            }
+
+            if (NumReady == 0)
+            {
+                const int64 Lag = static_cast<int64>(Slots[CurrentTail & IndexMask].Sequence.Load() - (CurrentTail + 1));
+                if (Lag <= 0)
+                {
+                    // Empty, or a unit whose partner is not visible yet.
+                    return 0;
+                }
+                // Another dequeuer claimed this position first.
+                CurrentTail = Tail.Value.Load(EMemoryOrder::Relaxed);
+                continue;
+            }
+
+            if (Tail.Value.CompareExchange(CurrentTail, CurrentTail + NumReady))
+            {
+                OutStart = CurrentTail;
+                return NumReady;
+            }
+        }
+    }
+
+    /** Dequeues the oldest unit and releases its items. Returns false when the ring is empty. */
+    bool DiscardOldestUnit()
+    {
+        TArray<FElementPtr, TInlineAllocator<2>> Discarded;
+        return DequeueBulk(Discarded, 1) > 0;
+    }
+
+    /** Keeps each counter on its own cache line so the producer and consumer do not false-share. */
+    template <typename ValueType>
+    struct alignas(PLATFORM_CACHE_LINE_SIZE) TPaddedAtomic
+    {
+        TAtomic<ValueType> Value{ 0 };
+    };
+
+    TUniquePtr<FSlot[]> Slots;
+    uint64 NumSlots = 0;
+    uint64 IndexMask = 0;
     int32 Capacity = 0;
-    int32 Dropped = 0;
+    int64 MaxBytes = 0;
+
+    /** Written by the producer only. */
+    TPaddedAtomic<uint64> Head;
+
+    /** Claimed by whichever thread dequeues. */
+    TPaddedAtomic<uint64> Tail;
+
+    /** Added to by the producer and subtracted from by dequeuers. */
+    TPaddedAtomic<int64> QueuedBytes;
+
+    TPaddedAtomic<int32> Dropped;
 };
@@ -3,12 +3,18 @@
 #include "CoreMinimal.h"
 #include "PanoramaCaptureTypes.h"
 #include "PanoramaCaptureFrameQueue.h"
+#include "Math/Float16Color.h"
 #include "HAL/ThreadSafeBool.h"
+#include "Templates/Atomic.h"
 
 class FPanoramaCaptureRenderer;
 class FPanoramaAudioRecorder;
 class FPanoramaFFmpegMuxer;
 class FPanoramaNVENCEncoder;
+class FPanoramaFramePool;
+class FPanoramaSpillFile;
+class FPanoramaLatencyTracker;
+class FPanoramaImageEncodePool;
 class UPanoramaCaptureComponent;
 class FRunnableThread;
 class FEvent;
@@ -31,7 +37,8 @@ public:
     void StartCapture();
     void StopCapture();
 
-    void EnqueueFrame_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
+    /** Queues a capture; RightFrame is the right eye of a stereo capture, null in mono. */
+    void EnqueueFrame_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame);
 
     FPanoramicCaptureStatus GetStatus() const;
     int32 GetRingBufferCapacity() const;
@@ -56,16 +63,41 @@ private:
     void ProcessPendingAudio();
 
     void ProcessPendingFrames_Worker();
-    bool HandlePNGFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
-    bool HandleStereoPNGPair(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame);
+    EPanoramaBackpressurePolicy ResolveBackpressurePolicy();
+    /** Spills both eyes of a capture or neither; returns false, with the payloads back in memory, when either does not fit. */
+    bool SpillPair_RenderThread(FPanoramaFrame& LeftFrame, FPanoramaFrame* RightFrame);
+    /** Sets the enqueue stamp on both eyes; call before every attempt to queue them. */
+    void StampEnqueue(FPanoramaFrame& LeftFrame, FPanoramaFrame* RightFrame);
+    bool EnqueueBlocking_RenderThread(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, int64 LeftBytes, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame, int64 RightBytes);
+    /** Opens the spill tier when enabled and sizes the queue for it. Called at capture start, before the workers. */
+    void ConfigureFrameQueueForCapture();
+    void CloseSpillFile();
+    /** Reads a spilled payload back from the spill file. Consumer thread only. */
+    void RestoreSpilledFrame(FPanoramaFrame& Frame);
+    /** Wakes a render thread blocked on a full queue. Called by whichever thread dequeued. */
+    void NotifyQueueSpace();
+    /** Pairs stereo eyes by FrameId and writes each complete capture. Consumer thread only. */
+    void HandleStereoEye(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
+    /** Hands a frame, or both eyes of a stereo pair, to the sequence encoders under a pending file name; waits while every encoder slot is taken. */
+    void SubmitSequenceFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame);
+    /** Renames frames the sequence encoders have written to the next file index and passes them to the muxer in capture order. Returns how many were handled. */
+    int32 FlushCompletedSequenceFrames();
+    /** Waits for every sequence frame in flight and flushes it to the muxer. */
+    void FinishSequenceEncoding();
     bool HandleNVENCFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
     TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> HandleStereoNVENCPair(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& LeftFrame, const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& RightFrame);
-    bool SavePNGToDisk(const FString& Filename, const TArray<FFloat16Color>& Pixels, const FIntPoint& Resolution);
-    FString BuildPNGFilePath(int32 FrameIndex) const;
+    FString BuildSequenceFilePath(const TCHAR* BaseName, int32 FrameIndex) const;
+    /** Every output but NVENC writes one file per capture through SequenceEncoder. */
+    bool IsImageSequenceOutput() const;
 
     void NotifyStatus_GameThread();
-    void UpdateStatusAfterVideoFrame(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
+    /** Notes the PTS of a frame handed to the muxer and records its stage latencies; published with the next status update. Consumer thread only. */
+    void RecordVideoFrameWritten(const TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe>& Frame);
+    /** Publishes queue state and the latest written PTS once per drained batch. */
+    void UpdateStatusAfterVideoFrames();
     void UpdateStatusAfterAudioPacket(const FPanoramaAudioPacket& Packet);
+    /** Copies queue occupancy, bytes, drops, frame pool counters and stage latencies into CachedStatus. StatusCriticalSection must be held. */
+    void UpdateQueueStatus_Locked();
     void ResetStatus();
     bool PerformPreflightChecks();
     bool VerifyDiskCapacity();
@@ -92,14 +124,37 @@ private:
     FDelegateHandle TickHandle;
 
     TPanoramaFrameQueue<FPanoramaFrame> FrameQueue;
+    TSharedPtr<FPanoramaFramePool, ESPMode::ThreadSafe> FramePool;
+
+    /** Overflow tier behind FrameQueue; null unless bSpillToDisk is set and the file could be created. */
+    TSharedPtr<FPanoramaSpillFile, ESPMode::ThreadSafe> SpillFile;
+    EPanoramaBackpressurePolicy ActiveBackpressurePolicy;
+
+    /** Per-stage latency histograms, reset at capture start. Recorded lock free from the render thread and the worker. */
+    TUniquePtr<FPanoramaLatencyTracker> LatencyTracker;
+
+    /** Signaled after a dequeue while the render thread waits for queue space under BlockProducer. */
+    FEvent* QueueSpaceEvent;
+    TAtomic<bool> bProducerWaitingForSpace;
+
+    /** False once the frame worker is stopping, so a blocked render thread gives up instead of waiting forever. */
+    TAtomic<bool> bBlockingEnqueueAllowed;
     TWeakObjectPtr<UPanoramaCaptureComponent> OwnerComponent;
 
     TUniquePtr<FFrameProcessor> FrameProcessor;
     TUniquePtr<FRunnableThread> FrameProcessorThread;
 
+    /** Left eye waiting for the right eye with the same FrameId. */
     TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> PendingLeftFrame;
-    TSharedPtr<FPanoramaFrame, ESPMode::ThreadSafe> PendingNVENCLeftFrame;
+    /** Index of the next sequence file handed to the muxer; frames that fail to encode never take one. */
     int32 FrameCounter;
+    /** Index of the next pending name given to the sequence encoders. */
+    int32 PendingSequenceIndex;
+    double PendingVideoPTS;
+    bool bHasPendingVideoPTS;
+
+    /** Encoder threads for image sequence output, running only while such a capture is active. */
+    TUniquePtr<FPanoramaImageEncodePool> SequenceEncoder;
 
     TWeakObjectPtr<UTextureRenderTarget2D> MonoTargetWeak;
     TWeakObjectPtr<UTextureRenderTarget2D> StereoTargetWeak;
@@ -14,14 +14,29 @@ UENUM(BlueprintType)
 enum class EPanoramaOutputFormat : uint8
 {
     PNGSequence,
-    NVENC
+    NVENC,
+    /**
+     * Half-float OpenEXR frames holding unclamped scene-linear light, kept after muxing for compositing. The muxed
+     * movie applies Gamma's transfer to them.
+     */
+    EXRSequence UMETA(DisplayName = "EXR Sequence"),
+    /**
+     * Losslessly compressed half-float frames that write far faster than PNG, decoded and piped to ffmpeg when the
+     * capture stops and deleted once muxed. For takes that are transcoded right away.
+     */
+    IntermediateSequence UMETA(DisplayName = "Lossless Intermediate")
 };
 
 UENUM(BlueprintType)
 enum class EPanoramaGamma : uint8
 {
     SRGB,
-    Linear
+    Linear,
+    /**
+     * HDR10: BT.2020 primaries, SMPTE ST 2084 (PQ) transfer and BT.2020 YCbCr. Only NVENC with P010 output applies the
+     * curve; any other output falls back to SRGB when the capture starts.
+     */
+    PQ UMETA(DisplayName = "HDR10 (PQ)")
 };
 
 UENUM(BlueprintType)
@@ -47,6 +62,67 @@ enum class EPanoramaColorFormat : uint8
     BGRA8
 };
 
+/** RGB to YCbCr matrix used by the CPU NV12/P010 converter. */
+UENUM(BlueprintType)
+enum class EPanoramaYUVMatrix : uint8
+{
+    /** BT.2020 for PQ (HDR10) output, BT.709 otherwise; matches the container color tags. */
+    Auto,
+    BT709,
+    BT2020
+};
+
+/** How the capture queue decides whether another frame fits. */
+UENUM(BlueprintType)
+enum class EPanoramaFrameQueueMode : uint8
+{
+    /** Holds up to MaxQueuedFrames frames regardless of their size. */
+    FrameCount,
+    /** Admits frames while their payloads fit in FrameQueueBudgetMB; MaxQueuedFrames still caps the frame count. */
+    MemoryBudget
+};
+
+/** What the capture does when the frame queue cannot take another frame. */
+UENUM(BlueprintType)
+enum class EPanoramaBackpressurePolicy : uint8
+{
+    /** BlockProducer when the engine runs on a fixed time step (offline renders), DropNewest otherwise. */
+    Auto,
+    /** Discard the frame that did not fit. Never stalls the game. */
+    DropNewest,
+    /** Discard the oldest queued frames to make room for the new one. Never stalls the game. */
+    DropOldest,
+    /** Stall the render thread until the frame worker frees space or BackpressureTimeoutMs passes. */
+    BlockProducer,
+    /** Skip captures on the game thread while the queue is fuller than QueueHighWaterMark. */
+    ThrottleCapture
+};
+
+/** Compression effort for PNG sequence frames. */
+UENUM(BlueprintType)
+enum class EPanoramaPNGProfile : uint8
+{
+    /** zlib level 1 with the Up filter on every row. Several times faster; for intermediates that are deleted after muxing. */
+    Fastest,
+    /** zlib level 6 with per-row adaptive filtering, the usual PNG default. */
+    Balanced,
+    /** zlib level 9 with adaptive filtering and larger deflate bands. Smallest files, for sequences that are kept. */
+    Archival
+};
+
+/** Compression for EXR sequence frames. All but DWAA are lossless. */
+UENUM(BlueprintType)
+enum class EPanoramaEXRCompression : uint8
+{
+    None,
+    /** Deflate over 16-line blocks. Fast to read back in compositing packages. */
+    ZIP,
+    /** Wavelet coding; the best lossless ratio on noisy rendered images. */
+    PIZ,
+    /** Lossy DCT coding of the color channels at a fraction of the size; alpha stays lossless. */
+    DWAA
+};
+
 USTRUCT(BlueprintType)
 struct FPanoramicVideoSettings
 {
@@ -62,9 +138,25 @@ struct FPanoramicVideoSettings
         , CaptureMode(EPanoramaCaptureMode::Mono)
         , Gamma(EPanoramaGamma::SRGB)
         , ColorFormat(EPanoramaColorFormat::NV12)
+        , YUVMatrix(EPanoramaYUVMatrix::Auto)
+        , HDRPaperWhiteNits(203.0f)
         , StereoLayout(EPanoramaStereoLayout::TopBottom)
         , SeamFixTexels(1.0f)
         , RateControlPreset(EPanoramaRateControlPreset::Default)
+        , bParallelColorConversion(true)
+        , ColorConversionStripRows(64)
+        , MaxColorConversionThreads(0)
+        , FrameQueueMode(EPanoramaFrameQueueMode::MemoryBudget)
+        , MaxQueuedFrames(120)
+        , FrameQueueBudgetMB(4096)
+        , BackpressurePolicy(EPanoramaBackpressurePolicy::Auto)
+        , BackpressureTimeoutMs(0)
+        , QueueHighWaterMark(0.75f)
+        , bSpillToDisk(false)
+        , SpillFileSizeMB(16384)
+        , SequenceEncodeWorkers(0)
+        , PNGProfile(EPanoramaPNGProfile::Balanced)
+        , EXRCompression(EPanoramaEXRCompression::PIZ)
     {
     }
 
@@ -95,6 +187,14 @@ struct FPanoramicVideoSettings
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
     EPanoramaColorFormat ColorFormat;
 
+    /** YCbCr matrix for NV12/P010 output. PQ output always uses BT.2020. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
+    EPanoramaYUVMatrix YUVMatrix;
+
+    /** Luminance in nits that linear 1.0 maps to when Gamma is PQ. 203 is the BT.2408 reference white. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video", meta = (ClampMin = "1.0", ClampMax = "10000.0"))
+    float HDRPaperWhiteNits;
+
     /** Layout for stereo output when CaptureMode is Stereo. */
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
     EPanoramaStereoLayout StereoLayout;
@@ -106,6 +206,77 @@ struct FPanoramicVideoSettings
     /** NVENC rate control preset exposed in the UI. */
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video")
     EPanoramaRateControlPreset RateControlPreset;
+
+    /** Split CPU color conversion (NV12/P010/BGRA) into row strips processed on worker threads. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance")
+    bool bParallelColorConversion;
+
+    /** Rows per conversion strip; rounded up to an even count. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "2", EditCondition = "bParallelColorConversion"))
+    int32 ColorConversionStripRows;
+
+    /** Upper bound on strips converted concurrently. Zero uses every task graph worker. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "0", EditCondition = "bParallelColorConversion"))
+    int32 MaxColorConversionThreads;
+
+    /** Whether the queue between the render thread and the frame worker is bounded by frame count or by memory. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance")
+    EPanoramaFrameQueueMode FrameQueueMode;
+
+    /** Maximum number of frames (eyes count separately in stereo) waiting for the frame worker in memory. Spilled frames come on top. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "2"))
+    int32 MaxQueuedFrames;
+
+    /** Memory the queued frame payloads may hold, in megabytes. An 8K RGBA16F eye is about 236 MB. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "256", EditCondition = "FrameQueueMode == EPanoramaFrameQueueMode::MemoryBudget"))
+    int32 FrameQueueBudgetMB;
+
+    /** Behavior when the frame queue is full. Offline renders should block; live previews should drop or throttle. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance")
+    EPanoramaBackpressurePolicy BackpressurePolicy;
+
+    /** Longest the render thread waits for queue space under BlockProducer before dropping. Zero waits indefinitely. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "0", EditCondition = "BackpressurePolicy == EPanoramaBackpressurePolicy::BlockProducer"))
+    int32 BackpressureTimeoutMs;
+
+    /** Queue fill ratio above which ThrottleCapture skips captures. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "0.1", ClampMax = "1.0", EditCondition = "BackpressurePolicy == EPanoramaBackpressurePolicy::ThrottleCapture"))
+    float QueueHighWaterMark;
+
+    /**
+     * Parks frames that do not fit in the memory budget in a preallocated, memory-mapped scratch file instead of
+     * blocking; the worker reads them back in capture order. MemoryBudget mode with blocking backpressure only (Auto
+     * blocks fixed-timestep renders), since the payload is copied into the file on the render thread, about 236 MB per
+     * 8K eye, which can stall it for tens of milliseconds, and longer once the OS has to flush the mapped pages to a
+     * slow drive.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (EditCondition = "FrameQueueMode == EPanoramaFrameQueueMode::MemoryBudget && (BackpressurePolicy == EPanoramaBackpressurePolicy::Auto || BackpressurePolicy == EPanoramaBackpressurePolicy::BlockProducer)"))
+    bool bSpillToDisk;
+
+    /** Size of the spill file in megabytes, allocated up front when capture starts. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "256", EditCondition = "bSpillToDisk"))
+    int32 SpillFileSizeMB;
+
+    /** Directory for the spill file, ideally on a fast NVMe drive. Empty uses the capture output directory. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (EditCondition = "bSpillToDisk"))
+    FString SpillDirectory;
+
+    /**
+     * Threads writing image sequence frames concurrently; files still reach the muxer in capture order. Zero uses every
+     * core but two. Frames in flight hold their readback plus encoding buffers of a few times its size; in memory budget
+     * mode they are charged to FrameQueueBudgetMB, which caps the workers at what half the budget can hold, and
+     * otherwise the workers are capped at what a quarter of physical memory can hold.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (ClampMin = "0", EditCondition = "OutputFormat != EPanoramaOutputFormat::NVENC"))
+    int32 SequenceEncodeWorkers;
+
+    /** Trades file size for encode time. Sequences that only feed the muxer are best written with Fastest. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video|Performance", meta = (EditCondition = "OutputFormat == EPanoramaOutputFormat::PNGSequence"))
+    EPanoramaPNGProfile PNGProfile;
+
+    /** Compression of EXR sequence frames. Line blocks of each frame are compressed on OpenEXR's worker threads. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Video", meta = (EditCondition = "OutputFormat == EPanoramaOutputFormat::EXRSequence"))
+    EPanoramaEXRCompression EXRCompression;
 };
 
 USTRUCT(BlueprintType)
@@ -130,6 +301,28 @@ struct FPanoramicAudioSettings
     bool bCaptureAudio;
 };
 
+/** Latency percentiles of one pipeline stage since capture start, in milliseconds. */
+USTRUCT(BlueprintType)
+struct FPanoramaLatencyStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    float P50Ms = 0.f;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    float P95Ms = 0.f;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    float P99Ms = 0.f;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    float MaxMs = 0.f;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int32 SampleCount = 0;
+};
+
 USTRUCT(BlueprintType)
 struct FPanoramicCaptureStatus
 {
@@ -144,6 +337,10 @@ struct FPanoramicCaptureStatus
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
     int32 DroppedFrames = 0;
 
+    /** Captures skipped on the game thread by the ThrottleCapture policy. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int32 ThrottledFrames = 0;
+
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
     float CurrentCaptureTimeSeconds = 0.f;
 
@@ -155,10 +352,54 @@ struct FPanoramicCaptureStatus
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
     double LastAudioPTS = 0.0;
 
-    /** Ring buffer fill ratio (0-1). */
+    /** Bytes held by the payloads of the frames waiting in the queue. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int64 PendingFrameBytes = 0;
+
+    /** Memory budget of the frame queue in bytes, or zero when it is bounded by frame count only. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int64 FrameQueueBudgetBytes = 0;
+
+    /** Frames whose payload overflowed into the spill file since capture start. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int32 SpilledFrames = 0;
+
+    /** Bytes of the spill file currently holding frames that wait for the worker. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int64 SpillBytesInUse = 0;
+
+    /** Payload buffers served from the frame pool since capture start. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int32 FramePoolHits = 0;
+
+    /** Payload buffers the pool had to allocate because no idle buffer was available. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
+    int32 FramePoolMisses = 0;
+
+    /** Ring buffer fill ratio (0-1), by frame count or by bytes, whichever is fuller. */
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
     float RingBufferFill = 0.f;
 
+    /** Readback completion to queue admission: render-thread conversion, spilling and any wait for queue space. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status|Latency")
+    FPanoramaLatencyStats SubmitLatency;
+
+    /** Time frames spend in the queue (and spill file) before the worker claims them. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status|Latency")
+    FPanoramaLatencyStats QueueLatency;
+
+    /** Dequeue to a write-ready payload: spill restore, conversion, encoding or PNG compression. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status|Latency")
+    FPanoramaLatencyStats ConversionLatency;
+
+    /** Write-ready payload to bytes handed to the raw stream or PNG file. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status|Latency")
+    FPanoramaLatencyStats WriteLatency;
+
+    /** Readback completion to write done. */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status|Latency")
+    FPanoramaLatencyStats EndToEndLatency;
+
     /** True when NVENC hardware encoding is active. */
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Status")
     bool bUsingNVENC = false;
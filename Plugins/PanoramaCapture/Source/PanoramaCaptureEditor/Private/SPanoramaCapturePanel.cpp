@@ -15,12 +15,45 @@
 #include "Widgets/Notifications/SProgressBar.h"
 #include "Internationalization/Internationalization.h"
 
+namespace
+{
+    FString GetOutputFormatLabel(EPanoramaOutputFormat Format)
+    {
+        switch (Format)
+        {
+        case EPanoramaOutputFormat::NVENC:
+            return TEXT("NVENC Hardware");
+        case EPanoramaOutputFormat::EXRSequence:
+            return TEXT("EXR Sequence");
+        case EPanoramaOutputFormat::IntermediateSequence:
+            return TEXT("Lossless Intermediate");
+        default:
+            return TEXT("PNG Sequence");
+        }
+    }
+
+    FString GetGammaLabel(EPanoramaGamma Gamma)
+    {
+        switch (Gamma)
+        {
+        case EPanoramaGamma::Linear:
+            return TEXT("Linear");
+        case EPanoramaGamma::PQ:
+            return TEXT("HDR10 (PQ)");
+        default:
+            return TEXT("sRGB");
+        }
+    }
+}
+
 void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
 {
     bRequestPreviewToggle = true;
 
     OutputFormatOptions = {
         MakeShared<EPanoramaOutputFormat>(EPanoramaOutputFormat::PNGSequence),
+        MakeShared<EPanoramaOutputFormat>(EPanoramaOutputFormat::EXRSequence),
+        MakeShared<EPanoramaOutputFormat>(EPanoramaOutputFormat::IntermediateSequence),
         MakeShared<EPanoramaOutputFormat>(EPanoramaOutputFormat::NVENC)
     };
     CaptureModeOptions = {
@@ -29,7 +62,8 @@ void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
     };
     GammaOptions = {
         MakeShared<EPanoramaGamma>(EPanoramaGamma::SRGB),
-        MakeShared<EPanoramaGamma>(EPanoramaGamma::Linear)
+        MakeShared<EPanoramaGamma>(EPanoramaGamma::Linear),
+        MakeShared<EPanoramaGamma>(EPanoramaGamma::PQ)
     };
     ColorFormatOptions = {
         MakeShared<EPanoramaColorFormat>(EPanoramaColorFormat::NV12),
@@ -137,7 +171,7 @@ void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
                 .OptionsSource(&OutputFormatOptions)
                 .OnGenerateWidget_Lambda([](TSharedPtr<EPanoramaOutputFormat> Item)
                 {
-                    const FString Label = Item.IsValid() && *Item == EPanoramaOutputFormat::NVENC ? TEXT("NVENC Hardware") : TEXT("PNG Sequence");
+                    const FString Label = Item.IsValid() ? GetOutputFormatLabel(*Item) : FString();
                     return SNew(STextBlock).Text(FText::FromString(Label));
                 })
                 .OnSelectionChanged(this, &SPanoramaCapturePanel::HandleOutputFormatChanged)
@@ -251,7 +285,7 @@ void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
                 .OptionsSource(&GammaOptions)
                 .OnGenerateWidget_Lambda([](TSharedPtr<EPanoramaGamma> Item)
                 {
-                    const FString Label = (Item.IsValid() && *Item == EPanoramaGamma::Linear) ? TEXT("Linear") : TEXT("sRGB");
+                    const FString Label = Item.IsValid() ? GetGammaLabel(*Item) : TEXT("sRGB");
                     return SNew(STextBlock).Text(FText::FromString(Label));
                 })
                 .OnSelectionChanged(this, &SPanoramaCapturePanel::HandleGammaChanged)
@@ -263,7 +297,7 @@ void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
                         {
                             return FText::FromString(TEXT("Gamma"));
                         }
-                        return SelectedComponent->VideoSettings.Gamma == EPanoramaGamma::Linear ? FText::FromString(TEXT("Linear")) : FText::FromString(TEXT("sRGB"));
+                        return FText::FromString(GetGammaLabel(SelectedComponent->VideoSettings.Gamma));
                     })
                 ]
             ]
@@ -481,6 +515,13 @@ void SPanoramaCapturePanel::Construct(const FArguments& InArgs)
         + SVerticalBox::Slot()
         .AutoHeight()
         .Padding(4.f)
+        [
+            SNew(STextBlock)
+            .Text(this, &SPanoramaCapturePanel::GetLatencyStatusText)
+        ]
+        + SVerticalBox::Slot()
+        .AutoHeight()
+        .Padding(4.f)
         [
             SNew(STextBlock)
             .Text(this, &SPanoramaCapturePanel::GetNVENCStatusText)
@@ -572,6 +613,16 @@ FText SPanoramaCapturePanel::GetBufferStatusText() const
     PercentFormat.SetMinimumFractionalDigits(0);
     PercentFormat.SetMaximumFractionalDigits(0);
 
+    if (Status.FrameQueueBudgetBytes > 0)
+    {
+        return FText::Format(NSLOCTEXT("PanoramaCapture", "BufferStatusBudget", "Buffer: {0}/{1} frames, {2} of {3} ({4}% used)"),
+            FText::AsNumber(Occupancy),
+            FText::AsNumber(Capacity),
+            FText::AsMemory(static_cast<uint64>(Status.PendingFrameBytes)),
+            FText::AsMemory(static_cast<uint64>(Status.FrameQueueBudgetBytes)),
+            FText::AsNumber(FillPercent, &PercentFormat));
+    }
+
     return FText::Format(NSLOCTEXT("PanoramaCapture", "BufferStatus", "Buffer: {0}/{1} ({2}% used)"),
         FText::AsNumber(Occupancy),
         FText::AsNumber(Capacity),
@@ -597,6 +648,58 @@ FText SPanoramaCapturePanel::GetPTSStatusText() const
         FText::AsNumber(Delta, &Format));
 }
 
+FText SPanoramaCapturePanel::GetLatencyStatusText() const
+{
+    if (!SelectedComponent.IsValid())
+    {
+        return FText::GetEmpty();
+    }
+
+    const FPanoramicCaptureStatus Status = SelectedComponent->GetCaptureStatus();
+    if (Status.EndToEndLatency.SampleCount == 0)
+    {
+        return NSLOCTEXT("PanoramaCapture", "LatencyNoSamples", "Latency: no frames written yet");
+    }
+
+    FNumberFormattingOptions Format;
+    Format.SetMinimumFractionalDigits(1);
+    Format.SetMaximumFractionalDigits(1);
+
+    auto FormatStage = [&Format](const FText& Label, const FPanoramaLatencyStats& Stats)
+    {
+        return FText::Format(NSLOCTEXT("PanoramaCapture", "LatencyStage", "{0}: p50 {1} | p95 {2} | p99 {3} | max {4} ms"),
+            Label,
+            FText::AsNumber(Stats.P50Ms, &Format),
+            FText::AsNumber(Stats.P95Ms, &Format),
+            FText::AsNumber(Stats.P99Ms, &Format),
+            FText::AsNumber(Stats.MaxMs, &Format));
+    };
+
+    const TPair<FText, const FPanoramaLatencyStats*> Stages[] =
+    {
+        { NSLOCTEXT("PanoramaCapture", "LatencySubmit", "Submit"), &Status.SubmitLatency },
+        { NSLOCTEXT("PanoramaCapture", "LatencyQueue", "Queue"), &Status.QueueLatency },
+        { NSLOCTEXT("PanoramaCapture", "LatencyConversion", "Convert"), &Status.ConversionLatency },
+        { NSLOCTEXT("PanoramaCapture", "LatencyWrite", "Write"), &Status.WriteLatency },
+    };
+
+    // The stage with the highest p95 is where the backlog builds up.
+    constexpr int32 NumStages = UE_ARRAY_COUNT(Stages);
+    TArray<FText> Lines;
+    int32 SlowestStage = 0;
+    for (int32 StageIndex = 0; StageIndex < NumStages; ++StageIndex)
+    {
+        Lines.Add(FormatStage(Stages[StageIndex].Key, *Stages[StageIndex].Value));
+        if (Stages[StageIndex].Value->P95Ms > Stages[SlowestStage].Value->P95Ms)
+        {
+            SlowestStage = StageIndex;
+        }
+    }
+    Lines.Add(FormatStage(NSLOCTEXT("PanoramaCapture", "LatencyEndToEnd", "Total"), Status.EndToEndLatency));
+    Lines.Add(FText::Format(NSLOCTEXT("PanoramaCapture", "LatencySlowest", "Slowest stage (p95): {0}"), Stages[SlowestStage].Key));
+    return FText::Join(FText::FromString(TEXT("\n")), Lines);
+}
+
 FText SPanoramaCapturePanel::GetNVENCStatusText() const
 {
     if (!SelectedComponent.IsValid())
@@ -605,7 +708,7 @@ FText SPanoramaCapturePanel::GetNVENCStatusText() const
     }
 
     const FPanoramicCaptureStatus Status = SelectedComponent->GetCaptureStatus();
-    const FString EncoderLabel = Status.bUsingNVENC ? TEXT("NVENC Hardware") : TEXT("PNG Sequence");
+    const FString EncoderLabel = GetOutputFormatLabel(Status.EffectiveVideoSettings.OutputFormat);
     return FText::Format(NSLOCTEXT("PanoramaCapture", "NVENCStatus", "Video Encoder: {0}"), FText::FromString(EncoderLabel));
 }
 
@@ -651,7 +754,7 @@ FText SPanoramaCapturePanel::GetFormatSummaryText() const
         return FText::FromString(TEXT("Output"));
     }
 
-    return SelectedComponent->VideoSettings.OutputFormat == EPanoramaOutputFormat::NVENC ? FText::FromString(TEXT("NVENC Hardware")) : FText::FromString(TEXT("PNG Sequence"));
+    return FText::FromString(GetOutputFormatLabel(SelectedComponent->VideoSettings.OutputFormat));
 }
 
 FText SPanoramaCapturePanel::GetColorFormatSummaryText() const
@@ -31,6 +31,7 @@ private:
     FText GetStatusText() const;
     FText GetBufferStatusText() const;
     FText GetPTSStatusText() const;
+    FText GetLatencyStatusText() const;
     FText GetNVENCStatusText() const;
     FSlateColor GetBufferWarningColor() const;
     ECheckBoxState GetPreviewCheckState() const;